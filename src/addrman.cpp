@@ -5,31 +5,43 @@
 
 #include <addrman.h>
 
+#include <crypto/siphash.h>
 #include <hash.h>
 #include <logging.h>
 #include <serialize.h>
 
+SaltedNetAddrHasher::SaltedNetAddrHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
 int CAddrInfo::GetTriedBucket(const uint256& nKey, const std::vector<bool> &asmap) const
 {
-    uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetKey()).GetCheapHash();
-    uint64_t hash2 = (CHashWriter(SER_GETHASH, 0) << nKey << GetGroup(asmap) << (hash1 % ADDRMAN_TRIED_BUCKETS_PER_GROUP)).GetCheapHash();
-    int tried_bucket = hash2 % ADDRMAN_TRIED_BUCKET_COUNT;
-    uint32_t mapped_as = GetMappedAS(asmap);
+    const uint32_t mapped_as = GetMappedAS(asmap);
+    int tried_bucket = GetTriedBucket(nKey, GetGroupForAS(mapped_as));
     LogPrint(BCLog::NET, "IP %s mapped to AS%i belongs to tried bucket %i\n", ToStringIP(), mapped_as, tried_bucket);
     return tried_bucket;
 }
 
+int CAddrInfo::GetTriedBucket(const uint256& nKey, const std::vector<unsigned char> &group) const
+{
+    uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetKey()).GetCheapHash();
+    uint64_t hash2 = (CHashWriter(SER_GETHASH, 0) << nKey << group << (hash1 % ADDRMAN_TRIED_BUCKETS_PER_GROUP)).GetCheapHash();
+    return hash2 % ADDRMAN_TRIED_BUCKET_COUNT;
+}
+
 int CAddrInfo::GetNewBucket(const uint256& nKey, const CNetAddr& src, const std::vector<bool> &asmap) const
 {
-    std::vector<unsigned char> vchSourceGroupKey = src.GetGroup(asmap);
-    uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetGroup(asmap) << vchSourceGroupKey).GetCheapHash();
-    uint64_t hash2 = (CHashWriter(SER_GETHASH, 0) << nKey << vchSourceGroupKey << (hash1 % ADDRMAN_NEW_BUCKETS_PER_SOURCE_GROUP)).GetCheapHash();
-    int new_bucket = hash2 % ADDRMAN_NEW_BUCKET_COUNT;
-    uint32_t mapped_as = GetMappedAS(asmap);
+    const uint32_t mapped_as = GetMappedAS(asmap);
+    int new_bucket = GetNewBucket(nKey, GetGroupForAS(mapped_as), src.GetGroup(asmap));
     LogPrint(BCLog::NET, "IP %s mapped to AS%i belongs to new bucket %i\n", ToStringIP(), mapped_as, new_bucket);
     return new_bucket;
 }
 
+int CAddrInfo::GetNewBucket(const uint256& nKey, const std::vector<unsigned char> &group, const std::vector<unsigned char> &source_group) const
+{
+    uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << group << source_group).GetCheapHash();
+    uint64_t hash2 = (CHashWriter(SER_GETHASH, 0) << nKey << source_group << (hash1 % ADDRMAN_NEW_BUCKETS_PER_SOURCE_GROUP)).GetCheapHash();
+    return hash2 % ADDRMAN_NEW_BUCKET_COUNT;
+}
+
 int CAddrInfo::GetBucketPosition(const uint256 &nKey, bool fNew, int nBucket) const
 {
     uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << (fNew ? 'N' : 'K') << nBucket << GetKey()).GetCheapHash();
@@ -73,27 +85,59 @@ double CAddrInfo::GetChance(int64_t nNow) const
 
 CAddrInfo* CAddrMan::Find(const CNetAddr& addr, int* pnId)
 {
-    std::map<CNetAddr, int>::iterator it = mapAddr.find(addr);
+    auto it = mapAddr.find(addr);
     if (it == mapAddr.end())
         return nullptr;
     if (pnId)
         *pnId = (*it).second;
-    std::map<int, CAddrInfo>::iterator it2 = mapInfo.find((*it).second);
+    auto it2 = mapInfo.find((*it).second);
     if (it2 != mapInfo.end())
         return &(*it2).second;
     return nullptr;
 }
 
+std::vector<unsigned char> CAddrMan::GetGroup_(const CNetAddr& addr)
+{
+    if (m_asmap.empty()) return addr.GetGroup(m_asmap);
+
+    auto it = m_mapped_as_cache.find(addr);
+    if (it == m_mapped_as_cache.end()) {
+        if (m_mapped_as_cache.size() >= ADDRMAN_ASMAP_CACHE_SIZE) m_mapped_as_cache.clear();
+        it = m_mapped_as_cache.emplace(addr, addr.GetMappedAS(m_asmap)).first;
+    }
+    return addr.GetGroupForAS(it->second);
+}
+
+int CAddrMan::GetTriedBucket_(const CAddrInfo& info)
+{
+    return info.GetTriedBucket(nKey, GetGroup_(info));
+}
+
+int CAddrMan::GetNewBucket_(const CAddrInfo& info, const CNetAddr& source)
+{
+    return info.GetNewBucket(nKey, GetGroup_(info), GetGroup_(source));
+}
+
+int CAddrMan::FindInNewBucket(int nUBucket, int nId) const
+{
+    // An entry can only be at the position GetBucketPosition() returns, but
+    // comparing the ids of a whole bucket is cheaper than hashing.
+    for (int pos = 0; pos < ADDRMAN_BUCKET_SIZE; pos++) {
+        if (vvNew[nUBucket][pos] == nId) return pos;
+    }
+    return -1;
+}
+
 CAddrInfo* CAddrMan::Create(const CAddress& addr, const CNetAddr& addrSource, int* pnId)
 {
     int nId = nIdCount++;
-    mapInfo[nId] = CAddrInfo(addr, addrSource);
+    CAddrInfo& info = mapInfo.emplace(nId, CAddrInfo(addr, addrSource)).first->second;
     mapAddr[addr] = nId;
-    mapInfo[nId].nRandomPos = vRandom.size();
+    info.nRandomPos = vRandom.size();
     vRandom.push_back(nId);
     if (pnId)
         *pnId = nId;
-    return &mapInfo[nId];
+    return &info;
 }
 
 void CAddrMan::SwapRandom(unsigned int nRndPos1, unsigned int nRndPos2)
@@ -148,9 +192,9 @@ void CAddrMan::ClearNew(int nUBucket, int nUBucketPos)
 void CAddrMan::MakeTried(CAddrInfo& info, int nId)
 {
     // remove the entry from all new buckets
-    for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
-        int pos = info.GetBucketPosition(nKey, true, bucket);
-        if (vvNew[bucket][pos] == nId) {
+    for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT && info.nRefCount > 0; bucket++) {
+        int pos = FindInNewBucket(bucket, nId);
+        if (pos != -1) {
             vvNew[bucket][pos] = -1;
             info.nRefCount--;
         }
@@ -160,7 +204,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
     assert(info.nRefCount == 0);
 
     // which tried bucket to move the entry to
-    int nKBucket = info.GetTriedBucket(nKey, m_asmap);
+    int nKBucket = GetTriedBucket_(info);
     int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
 
     // first make space to add it (the existing tried entry there is moved to new, deleting whatever is there).
@@ -176,7 +220,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId)
         nTried--;
 
         // find which new bucket it belongs to
-        int nUBucket = infoOld.GetNewBucket(nKey, m_asmap);
+        int nUBucket = GetNewBucket_(infoOld);
         int nUBucketPos = infoOld.GetBucketPosition(nKey, true, nUBucket);
         ClearNew(nUBucket, nUBucketPos);
         assert(vvNew[nUBucket][nUBucketPos] == -1);
@@ -227,8 +271,7 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
     int nUBucket = -1;
     for (unsigned int n = 0; n < ADDRMAN_NEW_BUCKET_COUNT; n++) {
         int nB = (n + nRnd) % ADDRMAN_NEW_BUCKET_COUNT;
-        int nBpos = info.GetBucketPosition(nKey, true, nB);
-        if (vvNew[nB][nBpos] == nId) {
+        if (FindInNewBucket(nB, nId) != -1) {
             nUBucket = nB;
             break;
         }
@@ -240,7 +283,7 @@ void CAddrMan::Good_(const CService& addr, bool test_before_evict, int64_t nTime
         return;
 
     // which tried bucket to move the entry to
-    int tried_bucket = info.GetTriedBucket(nKey, m_asmap);
+    int tried_bucket = GetTriedBucket_(info);
     int tried_bucket_pos = info.GetBucketPosition(nKey, false, tried_bucket);
 
     // Will moving this address into tried evict another entry?
@@ -308,7 +351,7 @@ bool CAddrMan::Add_(const CAddress& addr, const CNetAddr& source, int64_t nTimeP
         fNew = true;
     }
 
-    int nUBucket = pinfo->GetNewBucket(nKey, source, m_asmap);
+    int nUBucket = GetNewBucket_(*pinfo, source);
     int nUBucketPos = pinfo->GetBucketPosition(nKey, true, nUBucket);
     if (vvNew[nUBucket][nUBucketPos] != nId) {
         bool fInsert = vvNew[nUBucket][nUBucketPos] == -1;
@@ -446,7 +489,7 @@ int CAddrMan::Check_()
              if (vvTried[n][i] != -1) {
                  if (!setTried.count(vvTried[n][i]))
                      return -11;
-                 if (mapInfo[vvTried[n][i]].GetTriedBucket(nKey, m_asmap) != n)
+                 if (GetTriedBucket_(mapInfo[vvTried[n][i]]) != n)
                      return -17;
                  if (mapInfo[vvTried[n][i]].GetBucketPosition(nKey, false, n) != i)
                      return -18;
@@ -552,7 +595,7 @@ void CAddrMan::ResolveCollisions_()
             CAddrInfo& info_new = mapInfo[id_new];
 
             // Which tried bucket to move the entry to.
-            int tried_bucket = info_new.GetTriedBucket(nKey, m_asmap);
+            int tried_bucket = GetTriedBucket_(info_new);
             int tried_bucket_pos = info_new.GetBucketPosition(nKey, false, tried_bucket);
             if (!info_new.IsValid()) { // id_new may no longer map to a valid address
                 erase_collision = true;
@@ -616,7 +659,7 @@ CAddrInfo CAddrMan::SelectTriedCollision_()
     CAddrInfo& newInfo = mapInfo[id_new];
 
     // which tried bucket to move the entry to
-    int tried_bucket = newInfo.GetTriedBucket(nKey, m_asmap);
+    int tried_bucket = GetTriedBucket_(newInfo);
     int tried_bucket_pos = newInfo.GetBucketPosition(nKey, false, tried_bucket);
 
     int id_old = vvTried[tried_bucket][tried_bucket_pos];
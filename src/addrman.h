@@ -21,6 +21,7 @@
 #include <set>
 #include <stdint.h>
 #include <streams.h>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -75,6 +76,9 @@ public:
     //! Calculate in which "tried" bucket this entry belongs
     int GetTriedBucket(const uint256 &nKey, const std::vector<bool> &asmap) const;
 
+    //! Calculate in which "tried" bucket this entry belongs, given the network group of its address
+    int GetTriedBucket(const uint256 &nKey, const std::vector<unsigned char> &group) const;
+
     //! Calculate in which "new" bucket this entry belongs, given a certain source
     int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const std::vector<bool> &asmap) const;
 
@@ -84,6 +88,9 @@ public:
         return GetNewBucket(nKey, source, asmap);
     }
 
+    //! Calculate in which "new" bucket this entry belongs, given the network groups of its address and of the source
+    int GetNewBucket(const uint256 &nKey, const std::vector<unsigned char> &group, const std::vector<unsigned char> &source_group) const;
+
     //! Calculate in which position of a bucket to store this entry.
     int GetBucketPosition(const uint256 &nKey, bool fNew, int nBucket) const;
 
@@ -94,6 +101,23 @@ public:
     double GetChance(int64_t nNow = GetAdjustedTime()) const;
 };
 
+/** Hasher for tables keyed by the addresses peers tell us about, salted
+ *  so that they can't pick addresses that collide. */
+class SaltedNetAddrHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedNetAddrHasher();
+
+    size_t operator()(const CNetAddr& addr) const noexcept
+    {
+        return addr.GetSaltedHash(k0, k1);
+    }
+};
+
 /** Stochastic address manager
  *
  * Design goals:
@@ -118,6 +142,8 @@ public:
  *      be observable by adversaries.
  *    * Several indexes are kept for high performance. Defining DEBUG_ADDRMAN will introduce frequent (and expensive)
  *      consistency checks for the entire data structure.
+ *    * Entries and the address index are hash tables, and the AS each address maps to is cached, so that
+ *      walking the asmap is not repeated every time a bucket is computed.
  */
 
 //! total number of buckets for tried addresses
@@ -167,6 +193,9 @@ public:
 //! the maximum number of tried addr collisions to store
 #define ADDRMAN_SET_TRIED_COLLISION_SIZE 10
 
+//! the maximum number of asmap lookups to cache
+#define ADDRMAN_ASMAP_CACHE_SIZE 65536
+
 //! the maximum time we'll spend trying to resolve a tried table collision, in seconds
 static const int64_t ADDRMAN_TEST_WINDOW = 40*60; // 40 minutes
 
@@ -185,10 +214,10 @@ private:
     int nIdCount GUARDED_BY(cs);
 
     //! table with information about all nIds
-    std::map<int, CAddrInfo> mapInfo GUARDED_BY(cs);
+    std::unordered_map<int, CAddrInfo> mapInfo GUARDED_BY(cs);
 
     //! find an nId based on its network address
-    std::map<CNetAddr, int> mapAddr GUARDED_BY(cs);
+    std::unordered_map<CNetAddr, int, SaltedNetAddrHasher> mapAddr GUARDED_BY(cs);
 
     //! randomly-ordered vector of all nIds
     std::vector<int> vRandom GUARDED_BY(cs);
@@ -211,6 +240,9 @@ private:
     //! Holds addrs inserted into tried table that collide with existing entries. Test-before-evict discipline used to resolve these collisions.
     std::set<int> m_tried_collisions;
 
+    //! AS that addresses map to in m_asmap, for addresses recently bucketed
+    std::unordered_map<CNetAddr, uint32_t, SaltedNetAddrHasher> m_mapped_as_cache GUARDED_BY(cs);
+
 protected:
     //! secret key to randomize bucket select with
     uint256 nKey;
@@ -221,6 +253,24 @@ protected:
     //! Find an entry.
     CAddrInfo* Find(const CNetAddr& addr, int *pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    //! Network group of an address, using the asmap lookup cache.
+    std::vector<unsigned char> GetGroup_(const CNetAddr& addr) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    //! The "tried" bucket an entry belongs in.
+    int GetTriedBucket_(const CAddrInfo& info) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    //! The "new" bucket an entry belongs in, given a certain source.
+    int GetNewBucket_(const CAddrInfo& info, const CNetAddr& source) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    //! The "new" bucket an entry belongs in, using its default source.
+    int GetNewBucket_(const CAddrInfo& info) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        return GetNewBucket_(info, info.source);
+    }
+
+    //! Position of nId in a "new" bucket, or -1 if it isn't in it.
+    int FindInNewBucket(int nUBucket, int nId) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     //! find an entry, creating it if necessary.
     //! nTime and nServices of the found node are updated, if necessary.
     CAddrInfo* Create(const CAddress &addr, const CNetAddr &addrSource, int *pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -289,6 +339,14 @@ public:
     // Read asmap from provided binary file
     static std::vector<bool> DecodeAsmap(fs::path path);
 
+    //! Set m_asmap, forgetting the lookups cached for the previous one.
+    void SetAsmap(std::vector<bool> asmap)
+    {
+        LOCK(cs);
+        m_asmap = std::move(asmap);
+        m_mapped_as_cache.clear();
+    }
+
 
     /**
      * serialized format:
@@ -333,7 +391,8 @@ public:
 
         int nUBuckets = ADDRMAN_NEW_BUCKET_COUNT ^ (1 << 30);
         s << nUBuckets;
-        std::map<int, int> mapUnkIds;
+        std::unordered_map<int, int> mapUnkIds;
+        mapUnkIds.reserve(mapInfo.size());
         int nIds = 0;
         for (const auto& entry : mapInfo) {
             mapUnkIds[entry.first] = nIds;
@@ -404,6 +463,9 @@ public:
             throw std::ios_base::failure("Corrupt CAddrMan serialization, nTried exceeds limit.");
         }
 
+        mapInfo.reserve(nNew + nTried);
+        mapAddr.reserve(nNew + nTried);
+
         // Deserialize entries from the new table.
         for (int n = 0; n < nNew; n++) {
             CAddrInfo &info = mapInfo[n];
@@ -419,7 +481,7 @@ public:
         for (int n = 0; n < nTried; n++) {
             CAddrInfo info;
             s >> info;
-            int nKBucket = info.GetTriedBucket(nKey, m_asmap);
+            int nKBucket = GetTriedBucket_(info);
             int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
             if (vvTried[nKBucket][nKBucketPos] == -1) {
                 info.nRandomPos = vRandom.size();
@@ -436,7 +498,7 @@ public:
         nTried -= nLost;
 
         // Store positions in the new table buckets to apply later (if possible).
-        std::map<int, int> entryToBucket; // Represents which entry belonged to which bucket when serializing
+        std::vector<int> entryToBucket(nNew); // Represents which entry belonged to which bucket when serializing
 
         for (int bucket = 0; bucket < nUBuckets; bucket++) {
             int nSize = 0;
@@ -472,7 +534,7 @@ public:
                 // In case the new table data cannot be used (nVersion unknown, bucket count wrong or new asmap),
                 // try to give them a reference based on their primary source address.
                 LogPrint(BCLog::ADDRMAN, "Bucketing method was updated, re-bucketing addrman entries from disk\n");
-                bucket = info.GetNewBucket(nKey, m_asmap);
+                bucket = GetNewBucket_(info);
                 nUBucketPos = info.GetBucketPosition(nKey, true, bucket);
                 if (vvNew[bucket][nUBucketPos] == -1) {
                     vvNew[bucket][nUBucketPos] = n;
@@ -483,9 +545,9 @@ public:
 
         // Prune new entries with refcount 0 (as a result of collisions).
         int nLostUnk = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); ) {
+        for (auto it = mapInfo.begin(); it != mapInfo.end(); ) {
             if (it->second.fInTried == false && it->second.nRefCount == 0) {
-                std::map<int, CAddrInfo>::const_iterator itCopy = it++;
+                auto itCopy = it++;
                 Delete(itCopy->first);
                 nLostUnk++;
             } else {
@@ -6,6 +6,7 @@
 #define BITCOIN_BANMAN_H
 
 #include <addrdb.h>
+#include <bantrie.h>
 #include <bloom.h>
 #include <fs.h>
 #include <net_types.h> // For banmap_t
@@ -88,6 +89,8 @@ private:
 
     RecursiveMutex m_cs_banned;
     banmap_t m_banned GUARDED_BY(m_cs_banned);
+    //! The subnets of m_banned, indexed for IsBanned(const CNetAddr&)
+    BanTrie m_banned_index GUARDED_BY(m_cs_banned);
     bool m_is_dirty GUARDED_BY(m_cs_banned);
     CClientUIInterface* m_client_interface = nullptr;
     CBanDB m_ban_db;
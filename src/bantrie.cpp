@@ -0,0 +1,213 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bantrie.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+int Bit(const uint8_t* key, int n)
+{
+    return (key[n >> 3] >> (7 - (n & 7))) & 1;
+}
+
+/** Number of leading bits a and b have in common, up to max_len */
+int CommonPrefixLength(const uint8_t* a, const uint8_t* b, int max_len)
+{
+    int n = 0;
+    while (n < max_len) {
+        uint8_t diff = a[n >> 3] ^ b[n >> 3];
+        if (diff == 0) {
+            n += 8;
+            continue;
+        }
+        while (!(diff & 0x80)) {
+            diff <<= 1;
+            ++n;
+        }
+        break;
+    }
+    return std::min(n, max_len);
+}
+
+/** Whether the first len bits of addr and key are equal */
+bool HasPrefix(const uint8_t* addr, const uint8_t* key, int len)
+{
+    const int bytes = len >> 3;
+    if (memcmp(addr, key, bytes) != 0) return false;
+    const int bits = len & 7;
+    if (bits == 0) return true;
+    const uint8_t mask = 0xff << (8 - bits);
+    return (addr[bytes] & mask) == key[bytes];
+}
+
+} // namespace
+
+BanTrie::BanTrie() : m_root(-1), m_size(0) {}
+
+int32_t BanTrie::NewNode(const uint8_t* key, int len)
+{
+    int32_t index;
+    if (!m_free.empty()) {
+        index = m_free.back();
+        m_free.pop_back();
+    } else {
+        index = m_nodes.size();
+        m_nodes.emplace_back();
+    }
+    Node& node = m_nodes[index];
+    memset(node.key, 0, sizeof(node.key));
+    memcpy(node.key, key, len >> 3);
+    if (len & 7) node.key[len >> 3] = key[len >> 3] & (0xff << (8 - (len & 7)));
+    node.len = len;
+    node.banned = false;
+    node.ban_until = 0;
+    node.child[0] = node.child[1] = -1;
+    return index;
+}
+
+void BanTrie::FreeNode(int32_t index)
+{
+    m_free.push_back(index);
+}
+
+void BanTrie::Insert(const CSubNet& sub_net, int64_t ban_until)
+{
+    if (!sub_net.IsValid()) return;
+    const int len = sub_net.GetPrefixLength();
+    if (len < 0) {
+        for (auto& entry : m_non_prefix) {
+            if (entry.first == sub_net) {
+                entry.second = ban_until;
+                return;
+            }
+        }
+        m_non_prefix.emplace_back(sub_net, ban_until);
+        ++m_size;
+        return;
+    }
+    // The network address is already masked, so bits past len are zero.
+    const std::vector<unsigned char> key = sub_net.GetNetwork().GetAddrBytes();
+
+    // NewNode() may reallocate m_nodes, so nodes are only referred to by index.
+    int32_t parent = -1;
+    int side = 0;
+    int32_t added;
+    while (true) {
+        const int32_t index = Link(parent, side);
+        if (index < 0) {
+            added = NewNode(key.data(), len);
+            Link(parent, side) = added;
+            break;
+        }
+        const int node_len = m_nodes[index].len;
+        const int common = CommonPrefixLength(m_nodes[index].key, key.data(), std::min(node_len, len));
+        if (common == node_len) {
+            if (node_len == len) {
+                Node& node = m_nodes[index];
+                if (!node.banned) ++m_size;
+                node.banned = true;
+                node.ban_until = ban_until;
+                return;
+            }
+            parent = index;
+            side = Bit(key.data(), node_len);
+            continue;
+        }
+        // The subnet and the node's path diverge (or the subnet ends) before
+        // the end of the node's path: put a node at that point, above it.
+        const int32_t split = NewNode(key.data(), common);
+        m_nodes[split].child[Bit(m_nodes[index].key, common)] = index;
+        if (common == len) {
+            added = split;
+        } else {
+            added = NewNode(key.data(), len);
+            m_nodes[split].child[Bit(key.data(), common)] = added;
+        }
+        Link(parent, side) = split;
+        break;
+    }
+    m_nodes[added].banned = true;
+    m_nodes[added].ban_until = ban_until;
+    ++m_size;
+}
+
+void BanTrie::Prune(int32_t index, int32_t parent, int side)
+{
+    const Node& node = m_nodes[index];
+    if (node.banned || (node.child[0] >= 0 && node.child[1] >= 0)) return;
+    Link(parent, side) = node.child[0] >= 0 ? node.child[0] : node.child[1];
+    FreeNode(index);
+}
+
+void BanTrie::Erase(const CSubNet& sub_net)
+{
+    if (!sub_net.IsValid()) return;
+    const int len = sub_net.GetPrefixLength();
+    if (len < 0) {
+        for (auto it = m_non_prefix.begin(); it != m_non_prefix.end(); ++it) {
+            if (it->first == sub_net) {
+                *it = std::move(m_non_prefix.back());
+                m_non_prefix.pop_back();
+                --m_size;
+                return;
+            }
+        }
+        return;
+    }
+    const std::vector<unsigned char> key = sub_net.GetNetwork().GetAddrBytes();
+
+    int32_t grandparent = -1, parent = -1;
+    int parent_side = 0, side = 0;
+    int32_t index = m_root;
+    while (index >= 0) {
+        const Node& node = m_nodes[index];
+        if (node.len > len || !HasPrefix(key.data(), node.key, node.len)) return;
+        if (node.len == len) break;
+        grandparent = parent;
+        parent_side = side;
+        parent = index;
+        side = Bit(key.data(), node.len);
+        index = node.child[side];
+    }
+    if (index < 0 || !m_nodes[index].banned) return;
+    m_nodes[index].banned = false;
+    --m_size;
+    // Nodes that hold no subnet only remain where two paths branch.
+    Prune(index, parent, side);
+    if (parent >= 0) Prune(parent, grandparent, parent_side);
+}
+
+void BanTrie::Clear()
+{
+    m_nodes.clear();
+    m_free.clear();
+    m_root = -1;
+    m_size = 0;
+    m_non_prefix.clear();
+}
+
+bool BanTrie::IsBanned(const CNetAddr& addr, int64_t now) const
+{
+    if (!addr.IsValid()) return false;
+    uint8_t key[16];
+    for (int i = 0; i < 16; ++i) {
+        key[i] = addr.GetByte(15 - i);
+    }
+
+    int32_t index = m_root;
+    while (index >= 0) {
+        const Node& node = m_nodes[index];
+        if (!HasPrefix(key, node.key, node.len)) break;
+        if (node.banned && now < node.ban_until) return true;
+        if (node.len == ADDR_BITS) break;
+        index = node.child[Bit(key, node.len)];
+    }
+    for (const auto& entry : m_non_prefix) {
+        if (now < entry.second && entry.first.Match(addr)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BANTRIE_H
+#define BITCOIN_BANTRIE_H
+
+#include <netaddress.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/** Index of banned subnets, to find whether an address is in any of them.
+ *
+ * Subnets are kept in a path-compressed binary trie over the 16-byte
+ * address. IPv4 and Tor addresses are stored in that same space (IPv4 ones
+ * behind the ::ffff:0:0/96 prefix), so every subnet whose netmask is a
+ * prefix is a node of the trie, and looking an address up only visits the
+ * nodes on its path: at most one per banned subnet containing it, plus one
+ * per branching point, whatever the number of subnets indexed. The rare
+ * subnets with a netmask that isn't a prefix are checked one by one.
+ *
+ * Each subnet carries the time it is banned until. Expired entries are not
+ * removed by lookups; the owner erases them when sweeping the ban list.
+ */
+class BanTrie
+{
+public:
+    BanTrie();
+
+    /** Index a subnet, or update the time it is banned until. Invalid
+     *  subnets never match any address, so they are not indexed. */
+    void Insert(const CSubNet& sub_net, int64_t ban_until);
+    void Erase(const CSubNet& sub_net);
+    void Clear();
+
+    /** Whether addr is in an indexed subnet banned until after now */
+    bool IsBanned(const CNetAddr& addr, int64_t now) const;
+
+    /** Number of subnets indexed */
+    size_t Size() const { return m_size; }
+
+private:
+    static constexpr int ADDR_BITS = 128;
+
+    struct Node {
+        /** Path from the root to this node: the first len bits of key, all other bits zero */
+        uint8_t key[16];
+        uint8_t len;
+        /** Whether a subnet ends here, and until when it is banned */
+        bool banned;
+        int64_t ban_until;
+        /** Index in m_nodes of the children following a 0 and a 1 bit, or -1 */
+        int32_t child[2];
+    };
+
+    int32_t NewNode(const uint8_t* key, int len);
+    void FreeNode(int32_t index);
+    /** The link pointing to a child of parent, or to the root if parent is -1 */
+    int32_t& Link(int32_t parent, int side) { return parent < 0 ? m_root : m_nodes[parent].child[side]; }
+    /** Remove a node that holds no subnet if it has less than two children */
+    void Prune(int32_t index, int32_t parent, int side);
+
+    std::vector<Node> m_nodes;
+    /** Unused slots of m_nodes */
+    std::vector<int32_t> m_free;
+    int32_t m_root;
+    size_t m_size;
+    /** Subnets whose netmask is not a prefix, with the time they are banned until */
+    std::vector<std::pair<CSubNet, int64_t>> m_non_prefix;
+};
+
+#endif // BITCOIN_BANTRIE_H
@@ -0,0 +1,175 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <addrman.h>
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <random.h>
+#include <streams.h>
+
+#include <vector>
+
+/* A "source" is a source address from which we have received a bunch of other addresses. */
+
+static constexpr size_t NUM_SOURCES = 400;
+static constexpr size_t NUM_ADDRESSES_PER_SOURCE = 256;
+
+static std::vector<CAddress> g_sources;
+static std::vector<std::vector<CAddress>> g_addresses;
+
+static CAddress RandomAddress(FastRandomContext& rng)
+{
+    uint8_t ip[4];
+    // Stay clear of the 0/8 and multicast and reserved ranges, most of the rest is routable.
+    ip[0] = 1 + rng.randrange(223);
+    for (int i = 1; i < 4; ++i) ip[i] = rng.randbits(8);
+    CNetAddr addr;
+    addr.SetRaw(NET_IPV4, ip);
+    CAddress ret(CService(addr, 9401), NODE_NETWORK);
+    ret.nTime = GetAdjustedTime() - rng.randrange(7 * 24 * 60 * 60);
+    return ret;
+}
+
+static void CreateAddresses()
+{
+    if (g_sources.size() > 0) { // already created
+        return;
+    }
+
+    FastRandomContext rng(uint256(std::vector<unsigned char>(32, 123)));
+
+    g_sources.resize(NUM_SOURCES);
+    g_addresses.resize(NUM_SOURCES);
+    for (size_t source_i = 0; source_i < NUM_SOURCES; ++source_i) {
+        g_sources[source_i] = RandomAddress(rng);
+        g_addresses[source_i].resize(NUM_ADDRESSES_PER_SOURCE);
+        for (size_t addr_i = 0; addr_i < NUM_ADDRESSES_PER_SOURCE; ++addr_i) {
+            g_addresses[source_i][addr_i] = RandomAddress(rng);
+        }
+    }
+}
+
+static void AddAddressesToAddrMan(CAddrMan& addrman)
+{
+    for (size_t source_i = 0; source_i < NUM_SOURCES; ++source_i) {
+        addrman.Add(g_addresses[source_i], g_sources[source_i]);
+    }
+}
+
+static std::vector<bool> BenchAsmap()
+{
+    std::vector<bool> bits;
+    for (const uint8_t byte : benchmark::data::asmap) {
+        for (int bit = 0; bit < 8; ++bit) bits.push_back((byte >> bit) & 1);
+    }
+    return bits;
+}
+
+static void FillAddrMan(CAddrMan& addrman)
+{
+    CreateAddresses();
+    AddAddressesToAddrMan(addrman);
+
+    // Move some of the addresses to tried, as connecting to them would.
+    FastRandomContext rng(true);
+    for (size_t source_i = 0; source_i < NUM_SOURCES; ++source_i) {
+        for (size_t addr_i = 0; addr_i < NUM_ADDRESSES_PER_SOURCE; addr_i += 16) {
+            addrman.Good(g_addresses[source_i][addr_i]);
+        }
+    }
+}
+
+/* Benchmarks */
+
+static void AddrManAdd(benchmark::State& state)
+{
+    CreateAddresses();
+
+    while (state.KeepRunning()) {
+        CAddrMan addrman;
+        AddAddressesToAddrMan(addrman);
+    }
+}
+
+static void AddrManAddAsmap(benchmark::State& state)
+{
+    CreateAddresses();
+    const std::vector<bool> asmap = BenchAsmap();
+
+    while (state.KeepRunning()) {
+        CAddrMan addrman;
+        addrman.SetAsmap(asmap);
+        AddAddressesToAddrMan(addrman);
+    }
+}
+
+static void AddrManSelect(benchmark::State& state)
+{
+    CAddrMan addrman;
+    FillAddrMan(addrman);
+
+    while (state.KeepRunning()) {
+        const auto& address = addrman.Select();
+        assert(address.GetPort() > 0);
+    }
+}
+
+static void AddrManGetAddr(benchmark::State& state)
+{
+    CAddrMan addrman;
+    FillAddrMan(addrman);
+
+    while (state.KeepRunning()) {
+        const auto& addresses = addrman.GetAddr();
+        assert(addresses.size() > 0);
+    }
+}
+
+static void AddrManGood(benchmark::State& state)
+{
+    CreateAddresses();
+
+    while (state.KeepRunning()) {
+        CAddrMan addrman;
+        AddAddressesToAddrMan(addrman);
+        for (size_t source_i = 0; source_i < NUM_SOURCES; ++source_i) {
+            for (size_t addr_i = 0; addr_i < NUM_ADDRESSES_PER_SOURCE; addr_i += 16) {
+                addrman.Good(g_addresses[source_i][addr_i]);
+            }
+        }
+    }
+}
+
+static void AddrManSerialize(benchmark::State& state)
+{
+    CAddrMan addrman;
+    FillAddrMan(addrman);
+
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_DISK, CLIENT_VERSION);
+        stream << addrman;
+    }
+}
+
+static void AddrManDeserialize(benchmark::State& state)
+{
+    CAddrMan addrman;
+    FillAddrMan(addrman);
+    CDataStream data(SER_DISK, CLIENT_VERSION);
+    data << addrman;
+
+    while (state.KeepRunning()) {
+        CDataStream stream(data);
+        CAddrMan loaded;
+        stream >> loaded;
+    }
+}
+
+BENCHMARK(AddrManAdd, 3);
+BENCHMARK(AddrManAddAsmap, 3);
+BENCHMARK(AddrManSelect, 1000000);
+BENCHMARK(AddrManGetAddr, 20);
+BENCHMARK(AddrManGood, 2);
+BENCHMARK(AddrManSerialize, 10);
+BENCHMARK(AddrManDeserialize, 3);
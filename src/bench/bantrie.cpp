@@ -0,0 +1,84 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bantrie.h>
+#include <bench/bench.h>
+#include <random.h>
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+// The size of a large imported blocklist
+static constexpr size_t NUM_BANNED_SUBNETS = 50000;
+static constexpr size_t NUM_LOOKUPS = 1000;
+
+static CNetAddr RandomAddress(FastRandomContext& rng)
+{
+    CNetAddr addr;
+    if (rng.randrange(4) != 0) {
+        uint8_t ip[4];
+        ip[0] = 1 + rng.randrange(223);
+        for (int i = 1; i < 4; ++i) ip[i] = rng.randbits(8);
+        addr.SetRaw(NET_IPV4, ip);
+    } else {
+        uint8_t ip[16];
+        ip[0] = 0x20;
+        ip[1] = 0x01;
+        for (int i = 2; i < 16; ++i) ip[i] = rng.randbits(8);
+        addr.SetRaw(NET_IPV6, ip);
+    }
+    return addr;
+}
+
+static void FillBanTrie(BanTrie& trie, FastRandomContext& rng)
+{
+    for (size_t i = 0; i < NUM_BANNED_SUBNETS; ++i) {
+        const CNetAddr addr = RandomAddress(rng);
+        // Mostly single addresses and small ranges, as in public blocklists
+        const int mask = addr.IsIPv4() ? 16 + rng.randrange(17) : 32 + rng.randrange(97);
+        trie.Insert(CSubNet(addr, mask), std::numeric_limits<int64_t>::max());
+    }
+}
+
+static void BanTrieIsBanned(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    BanTrie trie;
+    FillBanTrie(trie, rng);
+    std::vector<CNetAddr> addrs;
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i) {
+        addrs.push_back(RandomAddress(rng));
+    }
+
+    while (state.KeepRunning()) {
+        for (const CNetAddr& addr : addrs) {
+            trie.IsBanned(addr, 0);
+        }
+    }
+}
+
+static void BanTrieInsertErase(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<CSubNet> subnets;
+    for (size_t i = 0; i < NUM_BANNED_SUBNETS; ++i) {
+        const CNetAddr addr = RandomAddress(rng);
+        subnets.emplace_back(addr, addr.IsIPv4() ? 16 + rng.randrange(17) : 32 + rng.randrange(97));
+    }
+
+    while (state.KeepRunning()) {
+        BanTrie trie;
+        for (const CSubNet& sub_net : subnets) {
+            trie.Insert(sub_net, 1);
+        }
+        for (const CSubNet& sub_net : subnets) {
+            trie.Erase(sub_net);
+        }
+        assert(trie.Size() == 0);
+    }
+}
+
+BENCHMARK(BanTrieIsBanned, 50);
+BENCHMARK(BanTrieInsertErase, 2);
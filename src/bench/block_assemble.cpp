@@ -10,6 +10,10 @@
 #include <test/util/wallet.h>
 #include <txmempool.h>
 #include <validation.h>
+#include <miner.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <pow.h>
 
 
 #include <vector>
@@ -17,11 +21,11 @@
 static std::shared_ptr<CBlock> PrepareBlock(const CScript& coinbase_scriptPubKey)
 {
     auto block = std::make_shared<CBlock>(
-        BlockAssembler{Params()}
+        BlockAssembler{::mempool, Params()}
             .CreateNewBlock(coinbase_scriptPubKey)
             ->block);
 
-    block->nTime = ::chainActive.Tip()->GetMedianTimePast() + 1;
+    block->nTime = ::ChainActive().Tip()->GetMedianTimePast() + 1;
     block->hashMerkleRoot = BlockMerkleRoot(*block);
 
     return block;
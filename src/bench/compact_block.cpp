@@ -0,0 +1,51 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+// Reconstructing a 2000 transaction compact block against a mempool of
+// 100000 transactions, as a node relaying to miners would.
+static void CompactBlockReconstruct(benchmark::State& state)
+{
+    const size_t MEMPOOL_SIZE = 100000;
+    const size_t BLOCK_TXS = 2000;
+
+    FastRandomContext det_rand{true};
+    CTxMemPool pool;
+    CBlock block;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig.resize(10);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+    block.vtx.push_back(MakeTransactionRef(tx));
+    block.nBits = 0x207fffff;
+    {
+        LOCK2(cs_main, pool.cs);
+        for (size_t i = 0; i < MEMPOOL_SIZE; i++) {
+            tx.vin[0].prevout.hash = det_rand.rand256();
+            CTransactionRef ptx = MakeTransactionRef(tx);
+            pool.addUnchecked(CTxMemPoolEntry(ptx, 1000, 0, 1, false, 4, LockPoints()));
+            if (i % (MEMPOOL_SIZE / BLOCK_TXS) == 0) block.vtx.push_back(ptx);
+        }
+    }
+    const CBlockHeaderAndShortTxIDs cmpctblock(block, true);
+    const std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
+
+    while (state.KeepRunning()) {
+        PartiallyDownloadedBlock partial_block(&pool);
+        bool ok = partial_block.InitData(cmpctblock, extra_txn) == READ_STATUS_OK;
+        assert(ok);
+    }
+}
+
+BENCHMARK(CompactBlockReconstruct, 20);
@@ -11,6 +11,7 @@
 namespace benchmark {
 namespace data {
 
+extern const std::vector<uint8_t> asmap;
 extern const std::vector<uint8_t> block413567;
 
 } // namespace data
@@ -8,14 +8,14 @@
 
 #include <vector>
 
-static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool, CAmount fee = 1000) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
     int64_t nTime = 0;
     unsigned int nHeight = 1;
     bool spendsCoinbase = false;
     unsigned int sigOpCost = 4;
     LockPoints lp;
-    pool.addUnchecked(CTxMemPoolEntry(tx, 1000, nTime, nHeight, spendsCoinbase, sigOpCost, lp));
+    pool.addUnchecked(CTxMemPoolEntry(tx, fee, nTime, nHeight, spendsCoinbase, sigOpCost, lp));
 }
 
 struct Available {
@@ -84,4 +84,35 @@ static void ComplexMemPool(benchmark::State& state)
     }
 }
 
+// Fill the mempool to four times its size limit with mostly independent
+// transactions of varying feerates, then evict down to the limit.
+static void MempoolTrimStress(benchmark::State& state)
+{
+    FastRandomContext det_rand{true};
+    std::vector<std::pair<CTransactionRef, CAmount>> txs;
+    for (int x = 0; x < 5000; ++x) {
+        CMutableTransaction tx = CMutableTransaction();
+        tx.vin.resize(1);
+        if (x % 10 == 9) {
+            // Every tenth transaction spends the one before it
+            tx.vin[0].prevout = COutPoint(txs.back().first->GetHash(), 0);
+        }
+        tx.vin[0].scriptSig = CScript() << CScriptNum(x);
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << CScriptNum(x) << OP_EQUAL;
+        tx.vout[0].nValue = 10 * COIN;
+        txs.emplace_back(MakeTransactionRef(tx), 1000 + det_rand.randrange(100000));
+    }
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    while (state.KeepRunning()) {
+        for (const auto& tx : txs) {
+            AddTx(tx.first, pool, tx.second);
+        }
+        pool.TrimToSize(pool.DynamicMemoryUsage() / 4);
+        pool.TrimToSize(0);
+    }
+}
+
 BENCHMARK(ComplexMemPool, 1);
+BENCHMARK(MempoolTrimStress, 1);
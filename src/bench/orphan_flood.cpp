@@ -0,0 +1,73 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <txorphanage.h>
+
+#include <set>
+#include <vector>
+
+// Simulates an orphan flood such as an airdrop burst: a set of parents
+// with many outputs each, whose children arrive first from many peers.
+// The children are resolved as their parents arrive and the peers that
+// relayed the leftovers then disconnect.
+static void OrphanFlood(benchmark::State& state)
+{
+    const size_t NUM_PARENTS = 100;
+    const size_t OUTPUTS_PER_PARENT = 50;
+    const NodeId NUM_PEERS = 125;
+
+    FastRandomContext det_rand{true};
+    std::vector<CTransactionRef> parents;
+    std::vector<CTransactionRef> children;
+    for (size_t p = 0; p < NUM_PARENTS; ++p) {
+        CMutableTransaction parent;
+        parent.vin.resize(1);
+        parent.vin[0].prevout = COutPoint(det_rand.rand256(), 0);
+        parent.vout.resize(OUTPUTS_PER_PARENT);
+        for (size_t o = 0; o < OUTPUTS_PER_PARENT; ++o) {
+            parent.vout[o].nValue = 1000;
+            parent.vout[o].scriptPubKey = CScript() << OP_TRUE;
+        }
+        parents.push_back(MakeTransactionRef(parent));
+
+        for (size_t o = 0; o < OUTPUTS_PER_PARENT; ++o) {
+            CMutableTransaction child;
+            child.vin.resize(1);
+            child.vin[0].prevout = COutPoint(parents.back()->GetHash(), o);
+            child.vout.resize(1);
+            child.vout[0].nValue = 900;
+            child.vout[0].scriptPubKey = CScript() << OP_TRUE;
+            children.push_back(MakeTransactionRef(child));
+        }
+    }
+
+    LOCK(g_cs_orphans);
+    while (state.KeepRunning()) {
+        TxOrphanage orphanage;
+        NodeId peer = 0;
+        for (const auto& child : children) {
+            orphanage.AddTx(child, peer);
+            peer = (peer + 1) % NUM_PEERS;
+        }
+
+        // Half of the parents show up; their children get resolved.
+        for (size_t p = 0; p < NUM_PARENTS; p += 2) {
+            std::set<uint256> work_set;
+            orphanage.AddChildrenToWorkSet(*parents[p], work_set);
+            assert(work_set.size() == OUTPUTS_PER_PARENT);
+            for (const uint256& txid : work_set) {
+                orphanage.EraseTx(txid);
+            }
+        }
+
+        for (NodeId i = 0; i < NUM_PEERS; ++i) {
+            orphanage.EraseForPeer(i);
+        }
+        assert(orphanage.Size() == 0);
+    }
+}
+
+BENCHMARK(OrphanFlood, 5);
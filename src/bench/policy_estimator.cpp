@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <policy/policy.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+
+#include <vector>
+
+static constexpr int TXS_PER_BLOCK = 100;
+
+static std::vector<CTxMemPoolEntry> CreateBlockEntries(int height)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_TRUE;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    tx.vout[0].nValue = 0;
+
+    std::vector<CTxMemPoolEntry> entries;
+    entries.reserve(TXS_PER_BLOCK);
+    for (int i = 0; i < TXS_PER_BLOCK; i++) {
+        tx.vin[0].prevout.n = height * TXS_PER_BLOCK + i; // make transaction unique
+        entries.push_back(entry.Fee(1000 * (1 + i % 20)).Height(height).FromTx(tx));
+    }
+    return entries;
+}
+
+/** Feed one block worth of mempool transactions to the estimator and confirm them in the next block */
+static void ProcessEstimatorBlock(CBlockPolicyEstimator& estimator, const std::vector<CTxMemPoolEntry>& entries, unsigned int height)
+{
+    std::vector<const CTxMemPoolEntry*> confirmed;
+    confirmed.reserve(entries.size());
+    for (const CTxMemPoolEntry& entry : entries) {
+        estimator.processTransaction(entry, true);
+        confirmed.push_back(&entry);
+    }
+    estimator.processBlock(height + 1, confirmed);
+}
+
+// Per-block bookkeeping of an estimator with a populated history, for blocks
+// that contain no tracked transactions
+static void BlockPolicyEstimatorProcessBlock(benchmark::State& state)
+{
+    CBlockPolicyEstimator estimator;
+    unsigned int height = 0;
+    for (; height < 200; height++) {
+        ProcessEstimatorBlock(estimator, CreateBlockEntries(height), height);
+    }
+
+    std::vector<const CTxMemPoolEntry*> empty_block;
+    while (state.KeepRunning()) {
+        estimator.processBlock(++height, empty_block);
+    }
+}
+
+static void BlockPolicyEstimatorSmartFee(benchmark::State& state)
+{
+    CBlockPolicyEstimator estimator;
+    for (int height = 0; height < 200; height++) {
+        ProcessEstimatorBlock(estimator, CreateBlockEntries(height), height);
+    }
+
+    const int targets[] = {2, 3, 6, 12, 24, 48, 144};
+    FeeCalculation feeCalc;
+    while (state.KeepRunning()) {
+        for (int target : targets) {
+            estimator.estimateSmartFee(target, &feeCalc, /* conservative */ true);
+            estimator.estimateSmartFee(target, &feeCalc, /* conservative */ false);
+        }
+    }
+}
+
+BENCHMARK(BlockPolicyEstimatorProcessBlock, 200000);
+BENCHMARK(BlockPolicyEstimatorSmartFee, 100000);
@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <net.h>
+#include <protocol.h>
+#include <version.h>
+
+#include <algorithm>
+#include <cassert>
+#include <string.h>
+#include <vector>
+
+// Receiving a 1 MB block message in socket-sized reads, as during IBD.
+static void ReceiveBlockMessage(benchmark::State& state)
+{
+    const size_t READ_SIZE = 0x10000;
+
+    CSerializedNetMsg ser_msg;
+    ser_msg.command = NetMsgType::BLOCK;
+    ser_msg.data.assign(1000 * 1000, 0x5a);
+    std::vector<unsigned char> wire;
+    V1TransportSerializer().prepareForTransport(ser_msg, wire);
+    wire.insert(wire.end(), ser_msg.data.begin(), ser_msg.data.end());
+
+    V1TransportDeserializer deserializer(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    while (state.KeepRunning()) {
+        size_t pos = 0;
+        while (!deserializer.Complete()) {
+            // The memcpy stands in for the kernel copying out of the socket.
+            char tmp[READ_SIZE];
+            const size_t n = std::min(READ_SIZE, wire.size() - pos);
+            memcpy(tmp, wire.data() + pos, n);
+            size_t handled = 0;
+            while (handled < n) handled += deserializer.Read(tmp + handled, n - handled);
+            pos += n;
+        }
+        CNetMessage msg = deserializer.GetMessage(Params().MessageStart(), 0);
+        assert(msg.m_valid_checksum);
+    }
+}
+
+BENCHMARK(ReceiveBlockMessage, 50);
@@ -5,10 +5,13 @@
 
 #include <bench/bench.h>
 #include <bloom.h>
+#include <crypto/common.h>
+#include <uint256.h>
 
-static void RollingBloom(benchmark::State& state)
+template <typename Filter>
+static void RollingBloomInsertContains(benchmark::State& state)
 {
-    CRollingBloomFilter filter(120000, 0.000001);
+    Filter filter(120000, 0.000001);
     std::vector<unsigned char> data(32);
     uint32_t count = 0;
     while (state.KeepRunning()) {
@@ -27,13 +30,53 @@ static void RollingBloom(benchmark::State& state)
     }
 }
 
-static void RollingBloomReset(benchmark::State& state)
+// Inventory filter usage: uint256 keys, mostly lookups of unknown txids.
+template <typename Filter>
+static void RollingBloomTxids(benchmark::State& state)
 {
-    CRollingBloomFilter filter(120000, 0.000001);
+    Filter filter(50000, 0.000001);
+    uint256 hash;
+    uint32_t count = 0;
+    while (state.KeepRunning()) {
+        count++;
+        WriteLE32(hash.begin(), count);
+        filter.insert(hash);
+        WriteLE32(hash.begin() + 4, count);
+        for (int i = 0; i < 4; i++) {
+            hash.begin()[8] = i;
+            filter.contains(hash);
+        }
+    }
+}
+
+template <typename Filter>
+static void RollingBloomResetFilter(benchmark::State& state)
+{
+    Filter filter(120000, 0.000001);
     while (state.KeepRunning()) {
         filter.reset();
     }
 }
 
+static void RollingBloom(benchmark::State& state) { RollingBloomInsertContains<CRollingBloomFilter>(state); }
+static void RollingBloomBlocked(benchmark::State& state) { RollingBloomInsertContains<CBlockedRollingBloomFilter>(state); }
+static void RollingBloomTxid(benchmark::State& state) { RollingBloomTxids<CRollingBloomFilter>(state); }
+static void RollingBloomBlockedTxid(benchmark::State& state) { RollingBloomTxids<CBlockedRollingBloomFilter>(state); }
+static void RollingBloomReset(benchmark::State& state) { RollingBloomResetFilter<CRollingBloomFilter>(state); }
+static void RollingBloomBlockedReset(benchmark::State& state) { RollingBloomResetFilter<CBlockedRollingBloomFilter>(state); }
+
+// Per-peer filters are created for every connection.
+static void RollingBloomBlockedCreate(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        CBlockedRollingBloomFilter filter(50000, 0.000001);
+    }
+}
+
 BENCHMARK(RollingBloom, 1500 * 1000);
+BENCHMARK(RollingBloomBlocked, 1500 * 1000);
+BENCHMARK(RollingBloomTxid, 500 * 1000);
+BENCHMARK(RollingBloomBlockedTxid, 500 * 1000);
 BENCHMARK(RollingBloomReset, 20000);
+BENCHMARK(RollingBloomBlockedReset, 20000);
+BENCHMARK(RollingBloomBlockedCreate, 1000);
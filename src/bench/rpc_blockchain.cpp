@@ -8,25 +8,56 @@
 #include <validation.h>
 #include <streams.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 
 #include <univalue.h>
 
-static void BlockToJsonVerbose(benchmark::State& state) {
-    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
-    char a = '\0';
-    stream.write(&a, 1); // Prevent compaction
-
+namespace {
+struct TestBlockAndIndex {
     CBlock block;
-    stream >> block;
-
+    uint256 blockHash;
     CBlockIndex blockindex;
-    const uint256 blockHash = block.GetHash();
-    blockindex.phashBlock = &blockHash;
-    blockindex.nBits = 403014710;
 
+    TestBlockAndIndex()
+    {
+        CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+        char a = '\0';
+        stream.write(&a, 1); // Prevent compaction
+
+        stream >> block;
+
+        blockHash = block.GetHash();
+        blockindex.phashBlock = &blockHash;
+        blockindex.nBits = 403014710;
+    }
+};
+} // namespace
+
+static void BlockToJsonVerbose(benchmark::State& state) {
+    TestBlockAndIndex data;
+    while (state.KeepRunning()) {
+        (void)blockToJSON(data.block, &data.blockindex, &data.blockindex, /*verbose*/ true);
+    }
+}
+
+static void BlockToJsonVerboseWrite(benchmark::State& state) {
+    TestBlockAndIndex data;
+    while (state.KeepRunning()) {
+        (void)blockToJSON(data.block, &data.blockindex, &data.blockindex, /*verbose*/ true).write();
+    }
+}
+
+static void BlockToJsonVerboseStream(benchmark::State& state) {
+    TestBlockAndIndex data;
+    size_t written = 0;
+    JSONStreamWriter writer([&](const std::string& text) { written += text.size(); });
     while (state.KeepRunning()) {
-        (void)blockToJSON(block, &blockindex, &blockindex, /*verbose*/ true);
+        WriteBlockJSON(writer, data.block, &data.blockindex, &data.blockindex, /*verbose*/ true);
+        writer.Flush();
     }
+    assert(written > 0);
 }
 
 BENCHMARK(BlockToJsonVerbose, 10);
+BENCHMARK(BlockToJsonVerboseWrite, 10);
+BENCHMARK(BlockToJsonVerboseStream, 10);
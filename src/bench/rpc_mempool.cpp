@@ -4,6 +4,7 @@
 
 #include <bench/bench.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <txmempool.h>
 
 #include <univalue.h>
@@ -15,11 +16,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& poo
     pool.addUnchecked(CTxMemPoolEntry(tx, fee, /* time */ 0, /* height */ 1, /* spendsCoinbase */ false, /* sigOpCost */ 4, lp));
 }
 
-static void RpcMempool(benchmark::State& state)
+static void FillMempool(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
-    CTxMemPool pool;
-    LOCK2(cs_main, pool.cs);
-
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
         tx.vin.resize(1);
@@ -31,10 +29,33 @@ static void RpcMempool(benchmark::State& state)
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
         AddTx(tx_r, /* fee */ i, pool);
     }
+}
+
+static void RpcMempool(benchmark::State& state)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
 
     while (state.KeepRunning()) {
         (void)MempoolToJSON(pool, /*verbose*/ true);
     }
 }
 
+static void RpcMempoolStream(benchmark::State& state)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
+
+    size_t written = 0;
+    JSONStreamWriter writer([&](const std::string& text) { written += text.size(); });
+    while (state.KeepRunning()) {
+        WriteMempoolJSON(writer, pool);
+        writer.Flush();
+    }
+    assert(written > 0);
+}
+
 BENCHMARK(RpcMempool, 40);
+BENCHMARK(RpcMempoolStream, 40);
@@ -0,0 +1,58 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <net.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <test/util/net.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+#ifndef WIN32
+// Inventory relay to a peer that reads slower than we announce: most
+// messages queue up behind a full socket buffer and are flushed in bulk.
+static void PushMessageInvFlood(benchmark::State& state)
+{
+    const int MESSAGES_PER_FLUSH = 1000;
+
+    ConnmanTestMsg connman(0x1337, 0x1337);
+    CConnman::Options options;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    connman.Init(options);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return;
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    CNode node(0, NODE_NETWORK, 0, fds[0], CAddress(), 0, 0, CAddress(), "", false);
+    node.SetSendVersion(PROTOCOL_VERSION);
+
+    const CNetMsgMaker msg_maker(PROTOCOL_VERSION);
+    std::vector<CInv> inv(1, CInv(MSG_TX, uint256()));
+    std::vector<unsigned char> sink(1 << 16);
+    uint64_t n = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < MESSAGES_PER_FLUSH; ++i) {
+            inv[0].hash = ArithToUint256(arith_uint256(++n));
+            connman.PushMessage(&node, msg_maker.Make(NetMsgType::INV, inv));
+        }
+        for (;;) {
+            while (read(fds[1], sink.data(), sink.size()) > 0) {}
+            connman.FlushSendBuffer(node);
+            if (WITH_LOCK(node.cs_vSend, return node.m_send_buffer.empty())) break;
+        }
+        while (read(fds[1], sink.data(), sink.size()) > 0) {}
+    }
+    close(fds[1]);
+}
+
+BENCHMARK(PushMessageInvFlood, 50);
+#endif
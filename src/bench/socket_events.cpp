@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <net.h>
+#include <netmessagemaker.h>
+#include <test/util/net.h>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+#ifdef USE_POLL
+// Many mostly idle peers, one of which has a message to deliver on each
+// iteration of the socket handler. The cost of waiting for readiness
+// should not grow with the number of idle connections.
+static void SocketEventsManyPeers(benchmark::State& state, SocketEventsMode mode)
+{
+    const size_t NUM_PEERS = 400;
+
+    ConnmanTestMsg connman(0x1337, 0x1337);
+    connman.SetSocketEventsMode(mode);
+
+    std::vector<CNode*> nodes;
+    std::vector<int> remotes;
+    for (size_t i = 0; i < NUM_PEERS; ++i) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) break;
+        CNode* node = new CNode(i, NODE_NETWORK, 0, fds[0], CAddress(), 0, 0, CAddress(), "", true);
+        connman.AddTestNode(*node);
+        nodes.push_back(node);
+        remotes.push_back(fds[1]);
+    }
+    assert(!nodes.empty());
+
+    const CNetMsgMaker msg_maker(INIT_PROTO_VERSION);
+    std::vector<std::vector<unsigned char>> wire;
+    for (CNode* node : nodes) {
+        CSerializedNetMsg msg = msg_maker.Make(NetMsgType::PING, uint64_t{0});
+        wire.push_back(connman.SerializeForWire(*node, msg));
+    }
+
+    // Let the handler see the initial writability of all sockets.
+    connman.SocketHandlerOnce();
+
+    size_t next = 0;
+    while (state.KeepRunning()) {
+        const std::vector<unsigned char>& data = wire[next];
+        ssize_t written = write(remotes[next], data.data(), data.size());
+        assert(written == (ssize_t)data.size());
+        connman.SocketHandlerOnce();
+        size_t received = connman.PopReceivedMsgs(*nodes[next]);
+        assert(received == 1);
+        next = (next + 1) % nodes.size();
+    }
+
+    connman.ClearTestNodes();
+    for (int fd : remotes) {
+        close(fd);
+    }
+}
+
+static void SocketEventsPoll(benchmark::State& state)
+{
+    SocketEventsManyPeers(state, SocketEventsMode::POLL);
+}
+BENCHMARK(SocketEventsPoll, 500);
+
+#ifdef USE_EPOLL
+static void SocketEventsEpoll(benchmark::State& state)
+{
+    SocketEventsManyPeers(state, SocketEventsMode::EPOLL);
+}
+BENCHMARK(SocketEventsEpoll, 500);
+#endif
+#endif // USE_POLL
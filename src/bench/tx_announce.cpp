@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <txannounce.h>
+
+#include <algorithm>
+#include <vector>
+
+// Transaction relay to 500 peers: every round a trickle interval's worth of
+// transactions is queued once, then each peer takes and ranks what is new
+// for it and announces up to the per-trickle limit.
+static void TxAnnounce500Peers(benchmark::State& state)
+{
+    const NodeId NUM_PEERS = 500;
+    const size_t TXS_PER_ROUND = 30;
+    const size_t MAX_PER_TRICKLE = 35;
+
+    FastRandomContext det_rand{true};
+    TxAnnouncementQueue queue(100000);
+    for (NodeId peer = 0; peer < NUM_PEERS; ++peer) queue.AddPeer(peer);
+
+    std::vector<TxAnnouncementQueue::Entry> candidates;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < TXS_PER_ROUND; ++i) {
+            queue.Push(det_rand.rand256(), 1 + det_rand.randrange(3), 1000 + det_rand.randrange(100000), 200 + det_rand.randrange(1000));
+        }
+        for (NodeId peer = 0; peer < NUM_PEERS; ++peer) {
+            candidates.clear();
+            queue.Take(peer, candidates);
+            std::make_heap(candidates.begin(), candidates.end(), TxAnnouncementWorse());
+            size_t sent = 0;
+            while (!candidates.empty() && sent < MAX_PER_TRICKLE) {
+                std::pop_heap(candidates.begin(), candidates.end(), TxAnnouncementWorse());
+                candidates.pop_back();
+                ++sent;
+            }
+            queue.GiveBack(peer, std::move(candidates));
+        }
+    }
+}
+
+BENCHMARK(TxAnnounce500Peers, 100);
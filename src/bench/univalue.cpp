@@ -0,0 +1,90 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <util/strencodings.h>
+
+#include <univalue.h>
+
+#include <cassert>
+
+namespace {
+/** A submitblock request for a full block */
+std::string SubmitBlockRequest()
+{
+    UniValue params(UniValue::VARR);
+    params.push_back(HexStr(benchmark::data::block413567));
+    UniValue request(UniValue::VOBJ);
+    request.pushKV("jsonrpc", "1.0");
+    request.pushKV("id", 1);
+    request.pushKV("method", "submitblock");
+    request.pushKV("params", params);
+    return request.write();
+}
+
+/** An object with many members, like getrawmempool true */
+UniValue LargeObject()
+{
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 5000; ++i) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("vsize", 200 + i);
+        entry.pushKV("weight", 800 + i);
+        entry.pushKV("time", 1588000000 + i);
+        entry.pushKV("height", 1000);
+        entry.pushKV("wtxid", std::string(64, 'a' + i % 6));
+        UniValue depends(UniValue::VARR);
+        depends.push_back(std::string(64, 'b'));
+        entry.pushKV("depends", depends);
+        entry.pushKV("bip125-replaceable", false);
+        obj.pushKV(HexStr(std::string(32, (char)i)) + std::to_string(i), entry);
+    }
+    return obj;
+}
+} // namespace
+
+static void UniValueReadSubmitBlock(benchmark::State& state)
+{
+    const std::string json = SubmitBlockRequest();
+    while (state.KeepRunning()) {
+        UniValue request;
+        bool ok = request.read(json);
+        assert(ok);
+    }
+}
+
+static void UniValueReadLargeObject(benchmark::State& state)
+{
+    const std::string json = LargeObject().write();
+    while (state.KeepRunning()) {
+        UniValue obj;
+        bool ok = obj.read(json);
+        assert(ok);
+    }
+}
+
+static void UniValueWriteLargeObject(benchmark::State& state)
+{
+    const UniValue obj = LargeObject();
+    while (state.KeepRunning()) {
+        obj.write();
+    }
+}
+
+static void UniValueFindKeyLargeObject(benchmark::State& state)
+{
+    const UniValue obj = LargeObject();
+    const std::vector<std::string>& keys = obj.getKeys();
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < keys.size(); i += 10) {
+            assert(obj[keys[i]].isObject());
+        }
+    }
+}
+
+BENCHMARK(UniValueReadSubmitBlock, 100);
+BENCHMARK(UniValueReadLargeObject, 10);
+BENCHMARK(UniValueWriteLargeObject, 20);
+BENCHMARK(UniValueFindKeyLargeObject, 20);
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <blockencodings.h>
+#include <checkqueue.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <chainparams.h>
@@ -14,8 +15,99 @@
 #include <validation.h>
 #include <util/system.h>
 
+#include <algorithm>
+#include <atomic>
 #include <unordered_map>
 
+/** Size in 64-bit words of the bitmap used to rule out mempool entries quickly */
+static constexpr size_t SHORTID_PREFILTER_WORDS = 1024;
+/** Number of mempool entries scanned by one short ID scan check */
+static constexpr size_t SHORTID_SCAN_BATCH = 2048;
+
+namespace {
+
+/** What the scans of the mempool for one compact block share */
+struct ShortIDScanContext {
+    const CBlockHeaderAndShortTxIDs& cmpctblock;
+    const std::vector<std::pair<uint256, CTxMemPool::txiter>>& vTxHashes;
+    const std::unordered_map<uint64_t, uint16_t>& shorttxids;
+    //! Bitmap of the low bits of the block's short IDs
+    const std::vector<uint64_t>& prefilter;
+    //! Number of mempool entries matched so far for each block index, capped at 2
+    std::vector<std::atomic<uint8_t>> match_counts;
+    //! Number of block indexes matched by exactly one entry, like mempool_count
+    std::atomic<size_t> found{0};
+
+    ShortIDScanContext(const CBlockHeaderAndShortTxIDs& cmpctblockIn, const std::vector<std::pair<uint256, CTxMemPool::txiter>>& vTxHashesIn,
+                       const std::unordered_map<uint64_t, uint16_t>& shorttxidsIn, const std::vector<uint64_t>& prefilterIn, size_t tx_count)
+        : cmpctblock(cmpctblockIn), vTxHashes(vTxHashesIn), shorttxids(shorttxidsIn), prefilter(prefilterIn), match_counts(tx_count) {}
+
+    /** Count a match for a block index */
+    void AddMatch(uint16_t index)
+    {
+        uint8_t count = match_counts[index].load(std::memory_order_relaxed);
+        while (count < 2 && !match_counts[index].compare_exchange_weak(count, count + 1, std::memory_order_relaxed)) {}
+        if (count == 0) {
+            ++found;
+        } else if (count == 1) {
+            // A second match: the transaction will be requested instead
+            --found;
+        }
+    }
+};
+
+/** Matches a range of mempool entries against the short IDs of a compact block */
+class CShortIDScan
+{
+private:
+    ShortIDScanContext* context{nullptr};
+    size_t begin{0};
+    size_t end{0};
+    //! (block index, vTxHashes index) of each match
+    std::vector<std::pair<uint16_t, size_t>>* matches{nullptr};
+
+public:
+    CShortIDScan() {}
+    CShortIDScan(ShortIDScanContext& contextIn, size_t beginIn, size_t endIn, std::vector<std::pair<uint16_t, size_t>>& matchesIn)
+        : context(&contextIn), begin(beginIn), end(endIn), matches(&matchesIn) {}
+
+    bool operator()()
+    {
+        const size_t needed = context->shorttxids.size();
+        for (size_t i = begin; i < end; i++) {
+            // Though ideally we'd continue scanning for the two-txn-match-shortid case,
+            // the performance win of an early exit here is too good to pass up and worth
+            // the extra risk. Every scan stops, also when another one found the last match.
+            if (context->found.load(std::memory_order_relaxed) >= needed) break;
+            uint64_t shortid = context->cmpctblock.GetShortID(context->vTxHashes[i].first);
+            if (!((context->prefilter[(shortid >> 6) % SHORTID_PREFILTER_WORDS] >> (shortid & 63)) & 1)) continue;
+            std::unordered_map<uint64_t, uint16_t>::const_iterator idit = context->shorttxids.find(shortid);
+            if (idit == context->shorttxids.end()) continue;
+            matches->emplace_back(idit->second, i);
+            context->AddMatch(idit->second);
+        }
+        return true;
+    }
+
+    void swap(CShortIDScan& check)
+    {
+        std::swap(context, check.context);
+        std::swap(begin, check.begin);
+        std::swap(end, check.end);
+        std::swap(matches, check.matches);
+    }
+};
+
+} // namespace
+
+static CCheckQueue<CShortIDScan> shortidscanqueue(1);
+
+void ThreadShortIDScan(int worker_num)
+{
+    util::ThreadRename(strprintf("shortid.%i", worker_num));
+    shortidscanqueue.Thread();
+}
+
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, bool fUseWTXID) :
         nonce(GetRand(std::numeric_limits<uint64_t>::max())),
         shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
@@ -102,33 +194,52 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     if (shorttxids.size() != cmpctblock.shorttxids.size())
         return READ_STATUS_FAILED; // Short ID collision
 
+    // Bitmap of the low bits of the block's short IDs, small enough to stay in
+    // L1 cache, so that most mempool entries are ruled out without a map lookup.
+    std::vector<uint64_t> prefilter(SHORTID_PREFILTER_WORDS);
+    for (const uint64_t shortid : cmpctblock.shorttxids) {
+        prefilter[(shortid >> 6) % SHORTID_PREFILTER_WORDS] |= uint64_t{1} << (shortid & 63);
+    }
+
     std::vector<bool> have_txn(txn_available.size());
     {
     LOCK(pool->cs);
     const std::vector<std::pair<uint256, CTxMemPool::txiter> >& vTxHashes = pool->vTxHashes;
-    for (size_t i = 0; i < vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
+    // The short IDs depend on the block, so one SipHash per mempool entry
+    // can't be avoided. Large mempools are scanned in batches on the short ID
+    // scan threads, small ones right here.
+    ShortIDScanContext context(cmpctblock, vTxHashes, shorttxids, prefilter, txn_available.size());
+    const size_t parts = vTxHashes.size() < MIN_PARALLEL_SHORTID_SCAN ? 1 : (vTxHashes.size() + SHORTID_SCAN_BATCH - 1) / SHORTID_SCAN_BATCH;
+    std::vector<std::vector<std::pair<uint16_t, size_t>>> matches(parts);
+    if (parts == 1) {
+        CShortIDScan(context, 0, vTxHashes.size(), matches[0])();
+    } else {
+        std::vector<CShortIDScan> checks;
+        checks.reserve(matches.size());
+        for (size_t part = 0; part < matches.size(); part++) {
+            checks.emplace_back(context, part * SHORTID_SCAN_BATCH, std::min(vTxHashes.size(), (part + 1) * SHORTID_SCAN_BATCH), matches[part]);
+        }
+        CCheckQueueControl<CShortIDScan> control(&shortidscanqueue);
+        control.Add(checks);
+        control.Wait();
+    }
+
+    for (const auto& part_matches : matches) {
+        for (const std::pair<uint16_t, size_t>& match : part_matches) {
+            if (!have_txn[match.first]) {
+                txn_available[match.first] = vTxHashes[match.second].second->GetSharedTx();
+                have_txn[match.first] = true;
                 mempool_count++;
             } else {
                 // If we find two mempool txn that match the short id, just request it.
                 // This should be rare enough that the extra bandwidth doesn't matter,
                 // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
+                if (txn_available[match.first]) {
+                    txn_available[match.first].reset();
                     mempool_count--;
                 }
             }
         }
-        // Though ideally we'd continue scanning for the two-txn-match-shortid case,
-        // the performance win of an early exit here is too good to pass up and worth
-        // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
     }
     }
 
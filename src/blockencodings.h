@@ -10,6 +10,15 @@
 
 class CTxMemPool;
 
+/** Mempools with at least this many transactions are scanned for the
+ *  transactions of a compact block on the short ID scan threads */
+static constexpr size_t MIN_PARALLEL_SHORTID_SCAN = 10000;
+/** Maximum number of threads scanning a mempool, including the one receiving the block */
+static constexpr int MAX_SHORTID_SCAN_THREADS = 4;
+
+/** Run an instance of the short ID scan thread */
+void ThreadShortIDScan(int worker_num);
+
 // Transaction compression schemes for compact block relay can be introduced by writing
 // an actual formatter here.
 using TransactionCompression = DefaultFormatter;
@@ -5,6 +5,7 @@
 #include <bloom.h>
 
 #include <primitives/transaction.h>
+#include <crypto/siphash.h>
 #include <hash.h>
 #include <script/script.h>
 #include <script/standard.h>
@@ -307,3 +308,149 @@ void CRollingBloomFilter::reset()
     nGeneration = 1;
     std::fill(data.begin(), data.end(), 0);
 }
+
+/** False positive rate of a blocked bloom filter with num_blocks blocks of
+ *  positions each, holding elements entries with hash_funcs probes each.
+ *  The number of entries in a block is Poisson distributed; j entries leave
+ *  each position unset with probability (1 - 1/positions)^(hash_funcs * j). */
+static double BlockedBloomFPRate(double elements, uint32_t num_blocks, unsigned int positions, int hash_funcs)
+{
+    const double lambda = elements / num_blocks;
+    const double unset_per_entry = pow(1.0 - 1.0 / positions, hash_funcs);
+    const int max_entries = (int)(lambda + 20 * sqrt(lambda) + 50);
+    double p_entries = exp(-lambda);
+    double unset = 1.0;
+    double rate = 0.0;
+    for (int j = 0; j <= max_entries; ++j) {
+        rate += p_entries * pow(1.0 - unset, hash_funcs);
+        unset *= unset_per_entry;
+        p_entries *= lambda / (j + 1);
+    }
+    return rate;
+}
+
+CBlockedRollingBloomFilter::CBlockedRollingBloomFilter(const unsigned int nElements, const double fpRate)
+{
+    /* Same generations as CRollingBloomFilter: between 2 and 3 generations of nElements / 2 entries. */
+    nEntriesPerGeneration = (nElements + 1) / 2;
+    const double nMaxElements = (double)nEntriesPerGeneration * 3;
+    /* For each number of probes around the optimum of an unblocked filter,
+     * find the fewest blocks that reach fpRate, and keep the smallest. */
+    const int nStandardHashFuncs = std::max(1, std::min((int)round(log(fpRate) / log(0.5)), 50));
+    nBlocks = 0;
+    nHashFuncs = nStandardHashFuncs;
+    for (int k = std::max(1, nStandardHashFuncs - 6); k <= std::min(nStandardHashFuncs + 2, 50); ++k) {
+        uint32_t lo = std::max<uint32_t>(1, (uint32_t)(nMaxElements / 64));
+        uint32_t hi = lo;
+        while (BlockedBloomFPRate(nMaxElements, hi, BLOCK_POSITIONS, k) > fpRate) hi *= 2;
+        while (lo < hi) {
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if (BlockedBloomFPRate(nMaxElements, mid, BLOCK_POSITIONS, k) > fpRate) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (nBlocks == 0 || hi < nBlocks) {
+            nBlocks = hi;
+            nHashFuncs = k;
+        }
+    }
+    data.resize(nBlocks * BLOCK_WORDS + BLOCK_WORDS - 1);
+    const size_t misalignment = (reinterpret_cast<uintptr_t>(data.data()) / sizeof(uint64_t)) % BLOCK_WORDS;
+    nOffset = misalignment == 0 ? 0 : BLOCK_WORDS - misalignment;
+    reset();
+}
+
+const uint64_t* CBlockedRollingBloomFilter::Block(uint64_t hash) const
+{
+    return data.data() + nOffset + FastMod(hash >> 32, nBlocks) * BLOCK_WORDS;
+}
+
+uint64_t* CBlockedRollingBloomFilter::Block(uint64_t hash)
+{
+    return data.data() + nOffset + FastMod(hash >> 32, nBlocks) * BLOCK_WORDS;
+}
+
+/* Derive the probes within a block from the element's hash with an LCG step
+ * each, using the top byte of the state. */
+static inline uint64_t NextProbe(uint64_t& state)
+{
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state >> 56;
+}
+
+void CBlockedRollingBloomFilter::insert(uint64_t hash)
+{
+    if (nEntriesThisGeneration == nEntriesPerGeneration) {
+        nEntriesThisGeneration = 0;
+        nGeneration++;
+        if (nGeneration == 4) {
+            nGeneration = 1;
+        }
+        uint64_t nGenerationMask1 = 0 - (uint64_t)(nGeneration & 1);
+        uint64_t nGenerationMask2 = 0 - (uint64_t)(nGeneration >> 1);
+        /* Wipe old entries that used this generation number. */
+        for (size_t p = nOffset; p < nOffset + nBlocks * BLOCK_WORDS; p += 2) {
+            uint64_t p1 = data[p], p2 = data[p + 1];
+            uint64_t mask = (p1 ^ nGenerationMask1) | (p2 ^ nGenerationMask2);
+            data[p] = p1 & mask;
+            data[p + 1] = p2 & mask;
+        }
+    }
+    nEntriesThisGeneration++;
+
+    uint64_t* block = Block(hash);
+    const uint64_t gen1 = nGeneration & 1, gen2 = nGeneration >> 1;
+    uint64_t state = hash;
+    for (int n = 0; n < nHashFuncs; n++) {
+        const uint64_t pos = NextProbe(state);
+        const int bit = pos & 0x3F;
+        uint64_t* pair = block + ((pos >> 6) << 1);
+        pair[0] = (pair[0] & ~(((uint64_t)1) << bit)) | (gen1 << bit);
+        pair[1] = (pair[1] & ~(((uint64_t)1) << bit)) | (gen2 << bit);
+    }
+}
+
+bool CBlockedRollingBloomFilter::contains(uint64_t hash) const
+{
+    const uint64_t* block = Block(hash);
+    uint64_t state = hash;
+    for (int n = 0; n < nHashFuncs; n++) {
+        const uint64_t pos = NextProbe(state);
+        const uint64_t* pair = block + ((pos >> 6) << 1);
+        if (!(((pair[0] | pair[1]) >> (pos & 0x3F)) & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CBlockedRollingBloomFilter::insert(const std::vector<unsigned char>& vKey)
+{
+    insert(CSipHasher(k0, k1).Write(vKey.data(), vKey.size()).Finalize());
+}
+
+void CBlockedRollingBloomFilter::insert(const uint256& hash)
+{
+    insert(SipHashUint256(k0, k1, hash));
+}
+
+bool CBlockedRollingBloomFilter::contains(const std::vector<unsigned char>& vKey) const
+{
+    return contains(CSipHasher(k0, k1).Write(vKey.data(), vKey.size()).Finalize());
+}
+
+bool CBlockedRollingBloomFilter::contains(const uint256& hash) const
+{
+    return contains(SipHashUint256(k0, k1, hash));
+}
+
+void CBlockedRollingBloomFilter::reset()
+{
+    k0 = GetRand(std::numeric_limits<uint64_t>::max());
+    k1 = GetRand(std::numeric_limits<uint64_t>::max());
+    nEntriesThisGeneration = 0;
+    nGeneration = 1;
+    std::fill(data.begin(), data.end(), 0);
+}
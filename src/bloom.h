@@ -133,4 +133,52 @@ private:
     int nHashFuncs;
 };
 
+/**
+ * A blocked variant of CRollingBloomFilter, with the same interface and the
+ * same generations scheme. All probes for an element fall in one 64-byte
+ * block of the filter, and they are derived from a single keyed SipHash of
+ * the element rather than one MurmurHash3 per probe, so a lookup costs one
+ * hash and touches one cache line.
+ *
+ * Blocks fill up unevenly, which raises the false positive rate of a blocked
+ * filter of a given size. The constructor sizes the filter (and picks the
+ * number of probes) so that the rate asked for still holds with nElements * 1.5
+ * entries. This costs more memory than CRollingBloomFilter, the more so the
+ * lower the rate: about 15% more at 0.001, and 70% more at 0.000001. For
+ * that reason the node's own filters still use CRollingBloomFilter.
+ */
+class CBlockedRollingBloomFilter
+{
+public:
+    CBlockedRollingBloomFilter(const unsigned int nElements, const double nFPRate);
+
+    void insert(const std::vector<unsigned char>& vKey);
+    void insert(const uint256& hash);
+    bool contains(const std::vector<unsigned char>& vKey) const;
+    bool contains(const uint256& hash) const;
+
+    void reset();
+
+private:
+    /** Each block holds 256 positions, as the two generation bits of 64
+     *  positions are stored in a pair of words (see CRollingBloomFilter). */
+    static constexpr unsigned int BLOCK_WORDS = 8;
+    static constexpr unsigned int BLOCK_POSITIONS = 256;
+
+    void insert(uint64_t hash);
+    bool contains(uint64_t hash) const;
+    const uint64_t* Block(uint64_t hash) const;
+    uint64_t* Block(uint64_t hash);
+
+    int nEntriesPerGeneration;
+    int nEntriesThisGeneration;
+    int nGeneration;
+    uint32_t nBlocks;
+    int nHashFuncs;
+    //! Filter words, plus room to align the first block to a cache line
+    std::vector<uint64_t> data;
+    size_t nOffset;
+    uint64_t k0, k1;
+};
+
 #endif // BITCOIN_BLOOM_H
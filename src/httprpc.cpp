@@ -7,6 +7,8 @@
 #include <chainparams.h>
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
+#include <logging.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <ui_interface.h>
@@ -28,6 +30,27 @@
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
+/** Read-only calls that take little time, and so are served ahead of other
+ * queued requests. Only single calls in small requests are looked at. */
+static const std::set<std::string> PRIORITY_RPC_METHODS{
+    "estimatesmartfee",
+    "getbestblockhash",
+    "getblockcount",
+    "getblockhash",
+    "getblockheader",
+    "getconnectioncount",
+    "getdifficulty",
+    "getmempoolentry",
+    "getmempoolinfo",
+    "getnetworkinfo",
+    "getrpcinfo",
+    "gettxout",
+    "uptime",
+};
+static const size_t MAX_PRIORITY_REQUEST_SIZE = 1024;
+/** Work queue client of the requests that fail to authenticate */
+static const char* UNAUTHENTICATED_CLIENT = "unauthenticated";
+
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
  */
@@ -72,6 +95,8 @@ static std::unique_ptr<HTTPRPCTimerInterface> httpRPCTimerInterface;
 /* RPC Auth Whitelist */
 static std::map<std::string, std::set<std::string>> g_rpc_whitelist;
 static bool g_rpc_whitelist_default = false;
+/** Number of threads the calls of a batch may be spread over */
+static int g_rpc_batch_threads = DEFAULT_RPC_BATCH_THREADS;
 
 static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id)
 {
@@ -90,6 +115,39 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+void WriteJSONStreamReply(HTTPRequest* req, const RPCResultWriter& write_json)
+{
+    req->WriteHeader("Content-Type", "application/json");
+    req->StartChunkedReply(HTTP_OK);
+    JSONStreamWriter writer([req](const std::string& text) {
+        if (!req->WriteReplyChunk(text)) throw std::runtime_error("client stopped reading the reply");
+    });
+    try {
+        write_json(writer);
+        writer.Flush();
+    } catch (const UniValue& objError) {
+        LogPrintf("Error while writing a JSON reply: %s\n", objError.write());
+    } catch (const std::exception& e) {
+        LogPrintf("Error while writing a JSON reply: %s\n", e.what());
+    }
+    req->WriteReplyChunk("\n");
+    req->EndChunkedReply();
+}
+
+/** Stream the reply to a JSON-RPC call whose handler set a result writer */
+static void JSONRPCStreamReply(HTTPRequest* req, const RPCResultWriter& write_result, const UniValue& id)
+{
+    WriteJSONStreamReply(req, [&](JSONStreamWriter& writer) {
+        // As JSONRPCReplyObj() would build it
+        writer.BeginObject();
+        writer.Key("result");
+        write_result(writer);
+        writer.KeyValue("error", NullUniValue);
+        writer.KeyValue("id", id);
+        writer.EndObject();
+    });
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -205,7 +263,14 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+            RPCResultWriter result_writer;
+            jreq.result_writer = &result_writer;
             UniValue result = tableRPC.execute(jreq);
+            jreq.result_writer = nullptr;
+            if (result_writer) {
+                JSONRPCStreamReply(req, result_writer, jreq.id);
+                return true;
+            }
 
             // Send reply
             strReply = JSONRPCReply(result, NullUniValue, jreq.id);
@@ -228,7 +293,7 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                     }
                 }
             }
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            strReply = JSONRPCExecBatch(jreq, valRequest.get_array(), RunOnIdleHTTPWorker, g_rpc_batch_threads);
         }
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
@@ -245,6 +310,33 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     return true;
 }
 
+static bool IsPriorityJSONRPC(HTTPRequest* req)
+{
+    if (req->GetRequestMethod() != HTTPRequest::POST) return false;
+    UniValue request;
+    if (!request.read(req->PeekBody(MAX_PRIORITY_REQUEST_SIZE)) || !request.isObject()) return false;
+    const UniValue& method = find_value(request, "method");
+    return method.isStr() && PRIORITY_RPC_METHODS.count(method.get_str());
+}
+
+/** Queue requests by the user they authenticate as. The credentials are
+ * checked here, before the request is queued: requests failing to
+ * authenticate all share one client queue and are never priority, so they
+ * can neither get ahead of nor displace the work of authenticated users. */
+static HTTPRequestClass ClassifyJSONRPC(HTTPRequest* req, const std::string &)
+{
+    HTTPRequestClass request_class;
+    std::pair<bool, std::string> authHeader = req->GetHeader("authorization");
+    std::string user;
+    if (!authHeader.first || !RPCAuthorized(authHeader.second, user)) {
+        request_class.client = UNAUTHENTICATED_CLIENT;
+        return request_class;
+    }
+    request_class.client = "user " + user;
+    request_class.priority = IsPriorityJSONRPC(req);
+    return request_class;
+}
+
 static bool InitRPCAuthentication()
 {
     if (gArgs.GetArg("-rpcpassword", "") == "")
@@ -293,10 +385,11 @@ bool StartHTTPRPC()
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
+    g_rpc_batch_threads = std::max((int)gArgs.GetArg("-rpcbatchthreads", DEFAULT_RPC_BATCH_THREADS), 1);
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, ClassifyJSONRPC);
     if (g_wallet_init_interface.HasWalletSupport()) {
-        RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+        RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, ClassifyJSONRPC);
     }
     struct event_base* eventBase = EventBase();
     assert(eventBase);
@@ -5,6 +5,12 @@
 #ifndef BITCOIN_HTTPRPC_H
 #define BITCOIN_HTTPRPC_H
 
+#include <rpc/jsonstream.h>
+
+class HTTPRequest;
+
+/** Default for -rpcbatchthreads: calls of a batch run one after the other */
+static const int DEFAULT_RPC_BATCH_THREADS = 1;
 
 /** Start HTTP RPC subsystem.
  * Precondition; HTTP and RPC has been started.
@@ -18,6 +24,13 @@ void InterruptHTTPRPC();
  */
 void StopHTTPRPC();
 
+/** Send a JSON document produced by write_json as a chunked HTTP reply,
+ * so that it never has to be held in memory as a whole. Errors while
+ * writing cannot be reported anymore: they are logged, and the reply is cut
+ * short.
+ */
+void WriteJSONStreamReply(HTTPRequest* req, const RPCResultWriter& write_json);
+
 /** Start HTTP REST subsystem.
  * Precondition; HTTP and RPC has been started.
  */
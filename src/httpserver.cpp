@@ -5,6 +5,7 @@
 #include <httpserver.h>
 
 #include <chainparamsbase.h>
+#include <httpworkqueue.h>
 #include <compat.h>
 #include <util/threadnames.h>
 #include <util/system.h>
@@ -15,7 +16,9 @@
 #include <sync.h>
 #include <ui_interface.h>
 
-#include <deque>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
@@ -62,76 +65,27 @@ private:
     HTTPRequestHandler func;
 };
 
-/** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
- */
-template <typename WorkItem>
-class WorkQueue
+/** Work item running a plain function */
+class HTTPTask final : public HTTPClosure
 {
-private:
-    /** Mutex protects entire object */
-    Mutex cs;
-    std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
-    bool running;
-    size_t maxDepth;
-
 public:
-    explicit WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth)
-    {
-    }
-    /** Precondition: worker threads have all stopped (they have been joined).
-     */
-    ~WorkQueue()
-    {
-    }
-    /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
-    {
-        LOCK(cs);
-        if (queue.size() >= maxDepth) {
-            return false;
-        }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
-        cond.notify_one();
-        return true;
-    }
-    /** Thread function */
-    void Run()
-    {
-        while (true) {
-            std::unique_ptr<WorkItem> i;
-            {
-                WAIT_LOCK(cs, lock);
-                while (running && queue.empty())
-                    cond.wait(lock);
-                if (!running)
-                    break;
-                i = std::move(queue.front());
-                queue.pop_front();
-            }
-            (*i)();
-        }
-    }
-    /** Interrupt and exit loops */
-    void Interrupt()
-    {
-        LOCK(cs);
-        running = false;
-        cond.notify_all();
-    }
+    explicit HTTPTask(std::function<void()> func) : m_func(std::move(func)) {}
+    void operator()() override { m_func(); }
+
+private:
+    const std::function<void()> m_func;
 };
 
 struct HTTPPathHandler
 {
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPClassifyFunction _classify):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), classify(_classify)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPClassifyFunction classify;
 };
 
 /** HTTP module state */
@@ -148,6 +102,8 @@ static WorkQueue<HTTPClosure>* workQueue = nullptr;
 static std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
 static std::vector<evhttp_bound_socket *> boundSockets;
+//! How long to wait for a client to read a chunk of a reply, in seconds
+static int64_t httpServerTimeout = DEFAULT_HTTP_SERVER_TIMEOUT;
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -262,19 +218,49 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPRequestClass request_class;
+        if (i->classify) {
+            request_class = i->classify(hreq.get(), path);
+        } else {
+            request_class.client = "address " + hreq->GetPeer().ToStringIP();
+        }
+        const std::string& client = request_class.client;
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        std::unique_ptr<HTTPClosure> dropped;
+        if (workQueue->Enqueue(item.get(), client, request_class.priority, dropped))
             item.release(); /* if true, queue took ownership */
         else {
             LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
             item->req->WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Work queue depth exceeded");
         }
+        if (dropped) {
+            // Only requests are queued per client, so this is an HTTPWorkItem.
+            HTTPWorkItem* dropped_item = static_cast<HTTPWorkItem*>(dropped.get());
+            LogPrintf("WARNING: request from %s dropped to make room in the http work queue for %s\n", dropped_item->req->GetPeer().ToString(), client);
+            dropped_item->req->WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Work queue depth exceeded");
+        }
     } else {
         hreq->WriteReply(HTTP_NOT_FOUND);
     }
 }
 
+bool GetHTTPWorkQueueStats(HTTPWorkQueueStats& stats)
+{
+    if (!workQueue) return false;
+    stats = workQueue->GetStats();
+    return true;
+}
+
+bool RunOnIdleHTTPWorker(std::function<void()> func)
+{
+    if (!workQueue) return false;
+    std::unique_ptr<HTTPTask> task(new HTTPTask(std::move(func)));
+    if (!workQueue->EnqueueIfIdle(task.get())) return false;
+    task.release(); // queue took ownership
+    return true;
+}
+
 /** Callback to reject HTTP requests after shutdown. */
 static void http_reject_request_cb(struct evhttp_request* req, void*)
 {
@@ -385,7 +371,8 @@ bool InitHTTPServer()
         return false;
     }
 
-    evhttp_set_timeout(http, gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+    httpServerTimeout = gArgs.GetArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT);
+    evhttp_set_timeout(http, httpServerTimeout);
     evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
     evhttp_set_max_body_size(http, MAX_SIZE);
     evhttp_set_gencb(http, http_request_cb, nullptr);
@@ -399,7 +386,10 @@ bool InitHTTPServer()
     int workQueueDepth = std::max((long)gArgs.GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    // Priority requests may take up half of the worker threads, so that
+    // a flood of them can't hold up all other requests.
+    const int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth, rpcThreads / 2);
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -510,13 +500,56 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
-HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_req), replySent(_replySent)
+/** Whether the chunk last sent of a chunked reply was written to the socket */
+class HTTPReplyFlow
+{
+private:
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_pending GUARDED_BY(m_mutex){false};
+    bool m_closed GUARDED_BY(m_mutex){false};
+
+public:
+    void Sent()
+    {
+        LOCK(m_mutex);
+        m_pending = true;
+    }
+
+    void Written(bool closed)
+    {
+        LOCK(m_mutex);
+        m_pending = false;
+        m_closed = m_closed || closed;
+        m_cond.notify_all();
+    }
+
+    /** Wait for the chunk last sent to be written. Returns false if it won't
+     * be, after which the client is considered gone. */
+    bool WaitWritten(std::chrono::seconds timeout)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cond.wait_for(lock, timeout, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_pending || m_closed; });
+        m_closed = m_closed || m_pending;
+        return !m_closed;
+    }
+
+    /** Called by libevent once the output buffer of the connection is written */
+    static void WrittenCallback(struct evhttp_connection*, void* arg)
+    {
+        static_cast<HTTPReplyFlow*>(arg)->Written(false);
+    }
+};
+
+HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_req), replySent(_replySent), replyStarted(false)
 {
 }
 
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (replyStarted && !replySent) {
+        EndChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL_SERVER_ERROR, "Unhandled request");
@@ -555,6 +588,19 @@ std::string HTTPRequest::ReadBody()
     return rv;
 }
 
+std::string HTTPRequest::PeekBody(size_t max_size) const
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = evbuffer_get_length(buf);
+    if (size == 0 || size > max_size)
+        return "";
+    std::string rv(size, '\0');
+    evbuffer_copyout(buf, &rv[0], size);
+    return rv;
+}
+
 void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
 {
     struct evkeyvalq* headers = evhttp_request_get_output_headers(req);
@@ -562,6 +608,21 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Re-enable reading from the socket once a reply was sent. This is the
+ * second part of the libevent workaround in http_request_cb.
+ */
+static void ReenableReading(evhttp_connection* conn)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -569,7 +630,7 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
  */
 void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
 {
-    assert(!replySent && req);
+    assert(!replySent && !replyStarted && req);
     if (ShutdownRequested()) {
         WriteHeader("Connection", "close");
     }
@@ -579,18 +640,79 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     evbuffer_add(evb, strReply.data(), strReply.size());
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
+        ReenableReading(conn);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus)
+{
+    assert(!replySent && !replyStarted && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    replyStarted = true;
+    replyFlow = std::make_shared<HTTPReplyFlow>();
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string& chunk)
+{
+    return WriteReplyChunk(Span<const unsigned char>((const unsigned char*)chunk.data(), chunk.size()));
+}
+
+bool HTTPRequest::WriteReplyChunk(Span<const unsigned char> chunk)
+{
+    assert(replyStarted && req);
+    if (chunk.size() == 0) return true; // an empty chunk would end the reply
+    if (!replyFlow->WaitWritten(std::chrono::seconds{httpServerTimeout})) return false;
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    replyFlow->Sent();
+    auto req_copy = req;
+    auto flow = replyFlow;
+    // Events triggered from the same thread run in order, so chunks are sent
+    // in the order they were written.
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb, flow]{
+        if (!evhttp_request_get_connection(req_copy)) {
+            // The client went away, in which case libevent keeps the
+            // request around until the reply is ended.
+            flow->Written(true);
+        } else {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+            // The callback is replaced by the next chunk or the end of the
+            // reply, which happen on this thread, and flow outlives both.
+            evhttp_send_reply_chunk_with_cb(req_copy, evb, HTTPReplyFlow::WrittenCallback, flow.get());
+#else
+            evhttp_send_reply_chunk(req_copy, evb);
+            flow->Written(false);
+#endif
         }
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply()
+{
+    assert(replyStarted && req);
+    auto req_copy = req;
+    auto flow = std::move(replyFlow);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, flow]{
+        // The request is freed right away if the client went away.
+        evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+        evhttp_send_reply_end(req_copy);
+        ReenableReading(conn);
     });
     ev->trigger(nullptr);
     replySent = true;
@@ -637,10 +759,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPClassifyFunction &classify)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classify));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
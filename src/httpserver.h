@@ -5,8 +5,11 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <span.h>
+
 #include <string>
 #include <functional>
+#include <memory>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
@@ -15,6 +18,7 @@ static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 struct evhttp_request;
 struct event_base;
 class CService;
+class HTTPReplyFlow;
 class HTTPRequest;
 
 /** Initialize HTTP server.
@@ -37,14 +41,56 @@ bool UpdateHTTPServerLogging(bool enable);
 
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** How a request is queued */
+struct HTTPRequestClass {
+    //! Who the request is queued for. Clients take turns at the worker threads.
+    std::string client;
+    //! Whether the request is cheap enough to be served ahead of queued work
+    bool priority{false};
+};
+/** Classify a request. Called on the event loop thread before the request
+ * is queued, so only authenticated properties of the request should decide
+ * the client and the priority. */
+typedef std::function<HTTPRequestClass(HTTPRequest* req, const std::string &)> HTTPClassifyFunction;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Without classify, requests are queued by source address.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPClassifyFunction &classify = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Counters of the HTTP work queue. Wait times are in microseconds. */
+struct HTTPWorkQueueStats {
+    //! Requests waiting for a worker, other than priority ones
+    size_t depth{0};
+    size_t priority_depth{0};
+    //! Clients with requests waiting
+    size_t clients{0};
+    //! Requests handed to a worker so far
+    uint64_t served{0};
+    uint64_t priority_served{0};
+    //! Work items of RunOnIdleHTTPWorker handed to a worker so far
+    uint64_t helpers_served{0};
+    //! Time the served requests, but not the helper items, spent waiting in the queue
+    int64_t total_wait{0};
+    int64_t max_wait{0};
+    //! Requests refused because the queue was full
+    uint64_t rejected{0};
+    //! Queued requests refused to make room for another client's
+    uint64_t dropped{0};
+};
+
+/** Get the counters of the work queue, if the HTTP server is running */
+bool GetHTTPWorkQueueStats(HTTPWorkQueueStats& stats);
+
+/** Run func on an HTTP worker thread, to spread the work of one request
+ * over several threads. Returns false, without running func, unless a
+ * worker is idle: such work never waits behind, nor takes the place of,
+ * other requests.
+ */
+bool RunOnIdleHTTPWorker(std::function<void()> func);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -58,6 +104,9 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool replyStarted;
+    //! Tracks the chunks of a chunked reply not yet written to the socket
+    std::shared_ptr<HTTPReplyFlow> replyFlow;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -97,6 +146,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Get a copy of the request body without consuming it, or an empty
+     * string if it is larger than max_size.
+     */
+    std::string PeekBody(size_t max_size) const;
+
     /**
      * Write output header.
      *
@@ -113,6 +168,24 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, for bodies sent while they are produced.
+     * Follow with any number of WriteReplyChunk() calls and one call to
+     * EndChunkedReply(), which gives the request back to the main thread
+     * like WriteReply() does.
+     *
+     * WriteReplyChunk() first waits for the previous chunk to be written to
+     * the socket, so that a slow client doesn't make the reply pile up in
+     * memory. It returns false, without sending the chunk, if the client went
+     * away or didn't read the previous chunk within the server timeout.
+     *
+     * @note Write all headers before calling this.
+     */
+    void StartChunkedReply(int nStatus);
+    bool WriteReplyChunk(const std::string& chunk);
+    bool WriteReplyChunk(Span<const unsigned char> chunk);
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
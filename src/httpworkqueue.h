@@ -0,0 +1,202 @@
+// Copyright (c) 2015-2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_HTTPWORKQUEUE_H
+#define BITCOIN_HTTPWORKQUEUE_H
+
+#include <httpserver.h>
+#include <sync.h>
+#include <util/time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+
+/** Simple work queue for distributing work over multiple threads.
+ * Work items are simply callable objects.
+ *
+ * Items are queued per client and clients take turns, so one client with
+ * many requests doesn't hold up the others. Priority items are served
+ * before all other items, in the order they arrived, but by no more than
+ * a given number of threads at once. Helper items, which only get queued
+ * while a thread is idle, are served before anything else.
+ */
+template <typename WorkItem>
+class WorkQueue
+{
+private:
+    struct Entry {
+        std::unique_ptr<WorkItem> item;
+        int64_t queued_time;
+    };
+
+    /** Mutex protects entire object */
+    Mutex cs;
+    std::condition_variable cond;
+    std::deque<std::unique_ptr<WorkItem>> helper_queue;
+    std::deque<Entry> priority_queue;
+    std::map<std::string, std::deque<Entry>> client_queues;
+    /** Clients with queued items, in the order they are served */
+    std::deque<std::string> client_order;
+    /** Number of items in client_queues */
+    size_t depth;
+    bool running;
+    size_t maxDepth;
+    /** Number of priority items being run, and how many may be at once */
+    size_t priorityRunning;
+    size_t maxPriorityRunning;
+    /** Number of threads waiting for work */
+    size_t idle;
+    HTTPWorkQueueStats stats;
+
+    bool CanServe() const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        return !helper_queue.empty() || depth > 0 || (!priority_queue.empty() && priorityRunning < maxPriorityRunning);
+    }
+
+    void CountWait(int64_t queued_time) EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        const int64_t wait = GetTimeMicros() - queued_time;
+        stats.total_wait += wait;
+        stats.max_wait = std::max(stats.max_wait, wait);
+    }
+
+public:
+    WorkQueue(size_t _maxDepth, size_t _maxPriorityRunning) : depth(0),
+                                 running(true),
+                                 maxDepth(_maxDepth),
+                                 priorityRunning(0),
+                                 maxPriorityRunning(std::max<size_t>(_maxPriorityRunning, 1)),
+                                 idle(0)
+    {
+    }
+    /** Precondition: worker threads have all stopped (they have been joined).
+     */
+    ~WorkQueue()
+    {
+    }
+    /** Enqueue a work item of a client. Priority items and the other items
+     * may each fill the queue up to its depth. When the other items do,
+     * the newest item of the client with the most queued items is moved to
+     * dropped to make room, if that client has more items than this one
+     * would then have.
+     */
+    bool Enqueue(WorkItem* item, const std::string& client, bool priority, std::unique_ptr<WorkItem>& dropped)
+    {
+        LOCK(cs);
+        if (priority) {
+            if (priority_queue.size() >= maxDepth) {
+                ++stats.rejected;
+                return false;
+            }
+            priority_queue.push_back(Entry{std::unique_ptr<WorkItem>(item), GetTimeMicros()});
+            cond.notify_one();
+            return true;
+        }
+        if (depth >= maxDepth) {
+            auto longest = client_queues.end();
+            for (auto it = client_queues.begin(); it != client_queues.end(); ++it) {
+                if (longest == client_queues.end() || it->second.size() > longest->second.size()) longest = it;
+            }
+            const auto own = client_queues.find(client);
+            const size_t own_size = own == client_queues.end() ? 0 : own->second.size();
+            if (longest == client_queues.end() || longest->second.size() <= own_size + 1) {
+                ++stats.rejected;
+                return false;
+            }
+            // The client keeps at least one item, so it stays in client_order.
+            dropped = std::move(longest->second.back().item);
+            longest->second.pop_back();
+            --depth;
+            ++stats.dropped;
+        }
+        std::deque<Entry>& queue = client_queues[client];
+        if (queue.empty()) client_order.push_back(client);
+        queue.push_back(Entry{std::unique_ptr<WorkItem>(item), GetTimeMicros()});
+        ++depth;
+        cond.notify_one();
+        return true;
+    }
+    /** Enqueue a work item only if a thread is idle to pick it up right away */
+    bool EnqueueIfIdle(WorkItem* item)
+    {
+        LOCK(cs);
+        if (helper_queue.size() + priority_queue.size() + depth >= idle) {
+            return false;
+        }
+        helper_queue.emplace_back(item);
+        cond.notify_one();
+        return true;
+    }
+    /** Thread function */
+    void Run()
+    {
+        while (true) {
+            std::unique_ptr<WorkItem> i;
+            bool priority = false;
+            {
+                WAIT_LOCK(cs, lock);
+                ++idle;
+                while (running && !CanServe())
+                    cond.wait(lock);
+                --idle;
+                if (!running)
+                    break;
+                if (!helper_queue.empty()) {
+                    i = std::move(helper_queue.front());
+                    helper_queue.pop_front();
+                    ++stats.helpers_served;
+                } else if (!priority_queue.empty() && priorityRunning < maxPriorityRunning) {
+                    i = std::move(priority_queue.front().item);
+                    CountWait(priority_queue.front().queued_time);
+                    priority_queue.pop_front();
+                    ++priorityRunning;
+                    priority = true;
+                    ++stats.priority_served;
+                } else {
+                    const std::string client = std::move(client_order.front());
+                    client_order.pop_front();
+                    auto it = client_queues.find(client);
+                    i = std::move(it->second.front().item);
+                    CountWait(it->second.front().queued_time);
+                    it->second.pop_front();
+                    --depth;
+                    if (it->second.empty()) {
+                        client_queues.erase(it);
+                    } else {
+                        client_order.push_back(client);
+                    }
+                    ++stats.served;
+                }
+            }
+            (*i)();
+            if (priority) {
+                LOCK(cs);
+                --priorityRunning;
+                cond.notify_one();
+            }
+        }
+    }
+    HTTPWorkQueueStats GetStats()
+    {
+        LOCK(cs);
+        HTTPWorkQueueStats ret = stats;
+        ret.depth = depth;
+        ret.priority_depth = priority_queue.size();
+        ret.clients = client_queues.size();
+        return ret;
+    }
+    /** Interrupt and exit loops */
+    void Interrupt()
+    {
+        LOCK(cs);
+        running = false;
+        cond.notify_all();
+    }
+};
+
+#endif // BITCOIN_HTTPWORKQUEUE_H
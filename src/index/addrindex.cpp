@@ -0,0 +1,213 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addrindex.h>
+
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <dbwrapper.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <set>
+
+/* The index database stores one entry for each transaction output with a spendable scriptPubKey
+ * and one for each transaction input spending such an output, under a key of type
+ * [DB_ADDR_ENTRY, uint256, uint32 (BE), uint256, uint8, VARINT]. The first uint256 is the SHA256
+ * of the scriptPubKey paid to or spent from and the uint32 is the height of the block, so that the
+ * entries of a script are next to each other in the order of the blocks. It is followed by the
+ * txid, whether the entry is an input, and the input or output index. The value is the amount as
+ * a VARINT, followed by the outpoint spent for inputs.
+ */
+constexpr char DB_ADDR_ENTRY = 'a';
+
+std::unique_ptr<AddrIndex> g_addrindex;
+
+namespace {
+
+uint256 ScriptHash(const CScript& script)
+{
+    uint256 hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(hash.begin());
+    return hash;
+}
+
+struct DBAddrKey {
+    uint256 script_hash;
+    uint32_t height;
+    uint256 txid;
+    uint8_t spending;
+    uint32_t index;
+
+    DBAddrKey() : height(0), spending(0), index(0) {}
+    DBAddrKey(const uint256& script_hash_in, uint32_t height_in, const uint256& txid_in = uint256(), bool spending_in = false, uint32_t index_in = 0) :
+        script_hash(script_hash_in), height(height_in), txid(txid_in), spending(spending_in), index(index_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDR_ENTRY);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        s << txid << spending << VARINT(index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_ADDR_ENTRY) {
+            throw std::ios_base::failure("Invalid format for address index DB key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        s >> txid >> spending >> VARINT(index);
+    }
+};
+
+struct DBAddrValue {
+    //! Not serialized, taken from the key
+    bool spending;
+    CAmount value;
+    COutPoint prevout;
+
+    explicit DBAddrValue(bool spending_in, CAmount value_in = 0, const COutPoint& prevout_in = COutPoint()) :
+        spending(spending_in), value(value_in), prevout(prevout_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << VARINT_MODE(value, VarIntMode::NONNEGATIVE_SIGNED);
+        if (spending) s << prevout;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> VARINT_MODE(value, VarIntMode::NONNEGATIVE_SIGNED);
+        if (spending) s >> prevout;
+    }
+};
+
+/** Call fn(key, value) for each entry a block adds to the index */
+template <typename Fn>
+bool ForEachBlockEntry(const CBlock& block, const CBlockUndo& block_undo, const CBlockIndex* pindex, Fn fn)
+{
+    if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+    }
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txid = tx.GetHash();
+        if (i > 0) {
+            const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+            if (tx_undo.vprevout.size() != tx.vin.size()) {
+                return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+            }
+            for (uint32_t j = 0; j < tx.vin.size(); ++j) {
+                const CTxOut& spent = tx_undo.vprevout[j].out;
+                fn(DBAddrKey(ScriptHash(spent.scriptPubKey), pindex->nHeight, txid, true, j),
+                   DBAddrValue(true, spent.nValue, tx.vin[j].prevout));
+            }
+        }
+        for (uint32_t n = 0; n < tx.vout.size(); ++n) {
+            const CTxOut& out = tx.vout[n];
+            if (out.scriptPubKey.IsUnspendable()) continue;
+            fn(DBAddrKey(ScriptHash(out.scriptPubKey), pindex->nHeight, txid, false, n), DBAddrValue(false, out.nValue));
+        }
+    }
+    return true;
+}
+
+}; // namespace
+
+AddrIndex::AddrIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "addrindex", n_cache_size, f_memory, f_wipe))
+{}
+
+bool AddrIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+
+    // The genesis block's outputs can't be spent.
+    if (pindex->nHeight > 0) {
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+        const bool res = ForEachBlockEntry(block, block_undo, pindex, [&batch](const DBAddrKey& key, const DBAddrValue& value) {
+            batch.Write(key, value);
+        });
+        if (!res) return false;
+    }
+
+    m_db->WriteSyncBlock(batch, pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool AddrIndex::DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: can't read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        const bool res = ForEachBlockEntry(block, block_undo, pindex, [&batch](const DBAddrKey& key, const DBAddrValue& value) {
+            batch.Erase(key);
+        });
+        if (!res) return false;
+    }
+    m_db->WriteSyncBlock(batch, new_tip->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool AddrIndex::FindHistory(const CScript& script, int start_height, int end_height, std::vector<AddrIndexEntry>& entries) const
+{
+    const uint256 script_hash = ScriptHash(script);
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    db_it->Seek(DBAddrKey(script_hash, std::max(start_height, 0)));
+
+    DBAddrKey key;
+    for (; db_it->Valid() && db_it->GetKey(key) && key.script_hash == script_hash; db_it->Next()) {
+        if ((int64_t)key.height > end_height) break;
+        DBAddrValue value(key.spending);
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value of entry of %s at height %d", __func__, key.txid.ToString(), key.height);
+        }
+        AddrIndexEntry entry;
+        entry.txid = key.txid;
+        entry.index = key.index;
+        entry.height = key.height;
+        entry.spending = key.spending;
+        entry.value = value.value;
+        entry.prevout = value.prevout;
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool AddrIndex::FindUnspent(const CScript& script, int end_height, std::vector<AddrIndexEntry>& entries) const
+{
+    std::vector<AddrIndexEntry> history;
+    if (!FindHistory(script, 0, end_height, history)) {
+        return false;
+    }
+
+    // An output can be spent in the same block, by a transaction ordered before it in the index
+    std::set<COutPoint> spent;
+    for (const AddrIndexEntry& entry : history) {
+        if (entry.spending) spent.insert(entry.prevout);
+    }
+    for (AddrIndexEntry& entry : history) {
+        if (!entry.spending && !spent.count(COutPoint(entry.txid, entry.index))) {
+            entries.push_back(std::move(entry));
+        }
+    }
+    return true;
+}
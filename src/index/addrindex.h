@@ -0,0 +1,68 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRINDEX_H
+#define BITCOIN_INDEX_ADDRINDEX_H
+
+#include <amount.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+
+#include <vector>
+
+/** A transaction output paying to a script, or a transaction input spending such an output */
+struct AddrIndexEntry {
+    uint256 txid;
+    //! The output index if funding, the input index if spending
+    uint32_t index{0};
+    int height{0};
+    bool spending{false};
+    CAmount value{0};
+    //! The output spent, if spending
+    COutPoint prevout;
+};
+
+/**
+ * AddrIndex is used to look up the history of a scriptPubKey: the
+ * transaction outputs paying to it and the inputs spending those outputs,
+ * in the order of the blocks they are in. The index is written to a LevelDB
+ * database and keyed by the SHA256 of the scriptPubKey (the Electrum
+ * "script hash").
+ */
+class AddrIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "addrindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddrIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the history of a script between two heights, inclusive.
+    ///
+    /// @param[in]   script  The scriptPubKey to look up.
+    /// @param[in]   start_height  The height of the first block to include.
+    /// @param[in]   end_height  The height of the last block to include.
+    /// @param[out]  entries  The entries found, in the order of the blocks.
+    /// @return  false on a database error
+    bool FindHistory(const CScript& script, int start_height, int end_height, std::vector<AddrIndexEntry>& entries) const;
+
+    /// Look up the outputs paying to a script that are not spent as of a height.
+    bool FindUnspent(const CScript& script, int end_height, std::vector<AddrIndexEntry>& entries) const;
+};
+
+/// The global address index, used in getaddresshistory and getaddressutxos. May be null.
+extern std::unique_ptr<AddrIndex> g_addrindex;
+
+#endif // BITCOIN_INDEX_ADDRINDEX_H
@@ -12,6 +12,7 @@
 #include <warnings.h>
 
 constexpr char DB_BEST_BLOCK = 'B';
+constexpr char DB_SYNC_BLOCK = 'h';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30; // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
@@ -46,6 +47,23 @@ void BaseIndex::DB::WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator
     batch.Write(DB_BEST_BLOCK, locator);
 }
 
+bool BaseIndex::DB::ReadSyncBlock(uint256& block_hash) const
+{
+    return Read(DB_SYNC_BLOCK, block_hash);
+}
+
+bool BaseIndex::DB::ReadSyncBlock(CDBIterator& db_it, uint256& block_hash)
+{
+    char key;
+    db_it.Seek(DB_SYNC_BLOCK);
+    return db_it.Valid() && db_it.GetKey(key) && key == DB_SYNC_BLOCK && db_it.GetValue(block_hash);
+}
+
+void BaseIndex::DB::WriteSyncBlock(CDBBatch& batch, const uint256& block_hash)
+{
+    batch.Write(DB_SYNC_BLOCK, block_hash);
+}
+
 BaseIndex::~BaseIndex()
 {
     Interrupt();
@@ -66,7 +84,22 @@ bool BaseIndex::Init()
         m_best_block_index = FindForkInGlobalIndex(::ChainActive(), locator);
     }
     m_synced = m_best_block_index.load() == ::ChainActive().Tip();
-    return true;
+
+    // Remove the entries of a stale branch, see DisconnectBlocks.
+    uint256 synced_hash;
+    if (!GetDB().ReadSyncBlock(synced_hash)) {
+        return true;
+    }
+    const CBlockIndex* synced_index = LookupBlockIndex(synced_hash);
+    if (!synced_index) {
+        return error("%s: %s is synced to unknown block %s", __func__, GetName(), synced_hash.ToString());
+    }
+    const CBlockIndex* fork = ::ChainActive().FindFork(synced_index);
+    if (fork == synced_index) {
+        return true;
+    }
+    LogPrintf("%s: Disconnecting %s from stale block %s\n", __func__, GetName(), synced_hash.ToString());
+    return fork && DisconnectBlocks(synced_index, fork);
 }
 
 static const CBlockIndex* NextSyncBlock(const CBlockIndex* pindex_prev) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
@@ -177,6 +210,10 @@ bool BaseIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_ti
     assert(current_tip == m_best_block_index);
     assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
 
+    if (!DisconnectBlocks(current_tip, new_tip)) {
+        return false;
+    }
+
     // In the case of a reorg, ensure persisted block locator is not stale.
     m_best_block_index = new_tip;
     if (!Commit()) {
@@ -32,6 +32,16 @@ protected:
 
         /// Write block locator of the chain that the txindex is in sync with.
         void WriteBestBlock(CDBBatch& batch, const CBlockLocator& locator);
+
+        /// Read the hash of the block the entries of the index are in sync with.
+        bool ReadSyncBlock(uint256& block_hash) const;
+
+        /// Read the hash of the block the entries are in sync with from the
+        /// snapshot of an iterator over the index database.
+        static bool ReadSyncBlock(CDBIterator& db_it, uint256& block_hash);
+
+        /// Write the hash of the block the entries of the index are in sync with.
+        void WriteSyncBlock(CDBBatch& batch, const uint256& block_hash);
     };
 
 private:
@@ -82,6 +92,17 @@ protected:
     /// be an ancestor of the current best block.
     virtual bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip);
 
+    /// Remove the entries of the blocks after new_tip up to current_tip, for
+    /// indices whose entries are only valid on the branch they were written
+    /// for. Called on Rewind, before the best block locator is moved back.
+    ///
+    /// Such indices store the block their entries are in sync with along with
+    /// every batch of entries, with DB::WriteSyncBlock. As entries can be
+    /// written past the best block locator, they may be left on a branch that
+    /// has been reorganized away from while the node was down; Init removes
+    /// those with this method, and the rest is written again while syncing.
+    virtual bool DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip) { return true; }
+
     virtual DB& GetDB() const = 0;
 
     /// Get the name of the index for display in logs.
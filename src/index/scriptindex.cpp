@@ -0,0 +1,183 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/scriptindex.h>
+
+#include <chainparams.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
+#include <dbwrapper.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores one entry for each unspent output with a spendable scriptPubKey, under
+ * a key of type [DB_SCRIPT_COIN, uint64 (BE), COutPoint] and with the Coin as value. The uint64 is
+ * the start of the SHA256 of the scriptPubKey, so that all outputs paying to a script are next to
+ * each other. Outputs of different scripts with the same short hash are told apart by comparing
+ * the scriptPubKey stored in the Coin.
+ *
+ * The block the entries are in sync with is stored along with them, so that a lookup reading from
+ * a consistent snapshot knows which block it reflects.
+ */
+constexpr char DB_SCRIPT_COIN = 's';
+
+std::unique_ptr<ScriptIndex> g_scriptindex;
+
+namespace {
+
+uint64_t ScriptKeyHash(const CScript& script)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(script.data(), script.size()).Finalize(hash);
+    return ReadBE64(hash);
+}
+
+struct DBScriptKey {
+    uint64_t script_hash;
+    COutPoint outpoint;
+
+    DBScriptKey() : script_hash(0) {}
+    DBScriptKey(uint64_t script_hash_in, const COutPoint& outpoint_in) : script_hash(script_hash_in), outpoint(outpoint_in) {}
+    DBScriptKey(const CScript& script, const COutPoint& outpoint_in) : script_hash(ScriptKeyHash(script)), outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SCRIPT_COIN);
+        // Big-endian, so that the database orders entries by script hash
+        unsigned char hash_be[8];
+        WriteBE64(hash_be, script_hash);
+        s.write((const char*)hash_be, sizeof(hash_be));
+        s << outpoint;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        char prefix = ser_readdata8(s);
+        if (prefix != DB_SCRIPT_COIN) {
+            throw std::ios_base::failure("Invalid format for script index DB key");
+        }
+        unsigned char hash_be[8];
+        s.read((char*)hash_be, sizeof(hash_be));
+        script_hash = ReadBE64(hash_be);
+        s >> outpoint;
+    }
+};
+
+}; // namespace
+
+ScriptIndex::ScriptIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "scriptindex", n_cache_size, f_memory, f_wipe))
+{}
+
+bool ScriptIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+
+    // The genesis block's outputs are not part of the UTXO set.
+    if (pindex->nHeight > 0) {
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return false;
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        for (size_t i = 0; i < block.vtx.size(); ++i) {
+            const CTransaction& tx = *block.vtx[i];
+            if (i > 0) {
+                const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+                if (tx_undo.vprevout.size() != tx.vin.size()) {
+                    return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+                }
+                for (size_t j = 0; j < tx.vin.size(); ++j) {
+                    batch.Erase(DBScriptKey(tx_undo.vprevout[j].out.scriptPubKey, tx.vin[j].prevout));
+                }
+            }
+            const uint256& txid = tx.GetHash();
+            for (uint32_t n = 0; n < tx.vout.size(); ++n) {
+                const CTxOut& out = tx.vout[n];
+                if (out.scriptPubKey.IsUnspendable()) continue;
+                batch.Write(DBScriptKey(out.scriptPubKey, COutPoint(txid, n)), Coin(out, pindex->nHeight, tx.IsCoinBase()));
+            }
+        }
+    }
+
+    m_db->WriteSyncBlock(batch, pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool ScriptIndex::DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Undo the disconnected blocks from the tip backwards, so that outputs
+    // spent and created again within the range end up in the right state.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()) || !UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: can't read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        if (block_undo.vtxundo.size() + 1 != block.vtx.size()) {
+            return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        for (size_t i = block.vtx.size(); i-- > 0;) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256& txid = tx.GetHash();
+            for (uint32_t n = 0; n < tx.vout.size(); ++n) {
+                const CTxOut& out = tx.vout[n];
+                if (out.scriptPubKey.IsUnspendable()) continue;
+                batch.Erase(DBScriptKey(out.scriptPubKey, COutPoint(txid, n)));
+            }
+            if (i == 0) continue;
+            const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+            if (tx_undo.vprevout.size() != tx.vin.size()) {
+                return error("%s: undo data of block %s doesn't match the block", __func__, pindex->GetBlockHash().ToString());
+            }
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const Coin& coin = tx_undo.vprevout[j];
+                batch.Write(DBScriptKey(coin.out.scriptPubKey, tx.vin[j].prevout), coin);
+            }
+        }
+    }
+    m_db->WriteSyncBlock(batch, new_tip->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool ScriptIndex::FindCoins(const std::set<CScript>& scripts, std::map<COutPoint, Coin>& coins, int64_t& count, uint256& block_hash) const
+{
+    count = 0;
+
+    // A single iterator reads all entries from the same snapshot of the database
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    if (!BaseIndex::DB::ReadSyncBlock(*db_it, block_hash)) {
+        return false;
+    }
+
+    std::set<uint64_t> script_hashes;
+    for (const CScript& script : scripts) {
+        script_hashes.insert(ScriptKeyHash(script));
+    }
+    for (const uint64_t script_hash : script_hashes) {
+        db_it->Seek(DBScriptKey(script_hash, COutPoint(uint256(), 0)));
+        DBScriptKey entry_key;
+        for (; db_it->Valid() && db_it->GetKey(entry_key) && entry_key.script_hash == script_hash; db_it->Next()) {
+            Coin coin;
+            if (!db_it->GetValue(coin)) {
+                return error("%s: unable to read value of %s", __func__, entry_key.outpoint.ToString());
+            }
+            ++count;
+            if (scripts.count(coin.out.scriptPubKey)) {
+                coins.emplace(entry_key.outpoint, std::move(coin));
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SCRIPTINDEX_H
+#define BITCOIN_INDEX_SCRIPTINDEX_H
+
+#include <coins.h>
+#include <index/base.h>
+#include <script/script.h>
+
+#include <map>
+#include <set>
+
+/**
+ * ScriptIndex is used to look up the unspent transaction outputs paying to
+ * given scriptPubKeys, so that scantxoutset doesn't need to read the whole
+ * UTXO set. The index is written to a LevelDB database and mirrors the UTXO
+ * set, keyed by a short hash of each output's scriptPubKey.
+ */
+class ScriptIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "scriptindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit ScriptIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the unspent outputs paying to any of the given scripts.
+    ///
+    /// @param[in]   scripts  The scriptPubKeys to look for.
+    /// @param[out]  coins  The unspent outputs found.
+    /// @param[out]  count  The number of index entries read.
+    /// @param[out]  block_hash  The block the result is in sync with.
+    /// @return  false if nothing was indexed yet or on a database error
+    bool FindCoins(const std::set<CScript>& scripts, std::map<COutPoint, Coin>& coins, int64_t& count, uint256& block_hash) const;
+};
+
+/// The global script index, used in scantxoutset. May be null.
+extern std::unique_ptr<ScriptIndex> g_scriptindex;
+
+#endif // BITCOIN_INDEX_SCRIPTINDEX_H
@@ -0,0 +1,99 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <chainparams.h>
+#include <dbwrapper.h>
+#include <util/system.h>
+#include <validation.h>
+
+/* The index database stores one entry for each transaction output spent in the indexed blocks,
+ * under a key of type [DB_SPENT_OUTPOINT, uint256, VARINT], the txid and index of the output.
+ * The value is the txid of the spending transaction, followed by the input index and the height
+ * of the block as VARINTs.
+ */
+constexpr char DB_SPENT_OUTPOINT = 'o';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+namespace {
+
+struct DBSpentKey {
+    const COutPoint& outpoint;
+
+    explicit DBSpentKey(const COutPoint& outpoint_in) : outpoint(outpoint_in) {}
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_SPENT_OUTPOINT);
+        s << outpoint.hash << VARINT(outpoint.n);
+    }
+};
+
+struct DBSpentValue {
+    uint256 txid;
+    uint32_t input_index;
+    int height;
+
+    DBSpentValue() : input_index(0), height(0) {}
+    DBSpentValue(const uint256& txid_in, uint32_t input_index_in, int height_in) :
+        txid(txid_in), input_index(input_index_in), height(height_in) {}
+
+    SERIALIZE_METHODS(DBSpentValue, obj) { READWRITE(obj.txid, VARINT(obj.input_index), VARINT_MODE(obj.height, VarIntMode::NONNEGATIVE_SIGNED)); }
+};
+
+}; // namespace
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe))
+{}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        const uint256& txid = tx->GetHash();
+        for (uint32_t i = 0; i < tx->vin.size(); ++i) {
+            batch.Write(DBSpentKey(tx->vin[i].prevout), DBSpentValue(txid, i, pindex->nHeight));
+        }
+    }
+    m_db->WriteSyncBlock(batch, pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: can't read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->IsCoinBase()) continue;
+            for (const CTxIn& txin : tx->vin) {
+                batch.Erase(DBSpentKey(txin.prevout));
+            }
+        }
+    }
+    m_db->WriteSyncBlock(batch, new_tip->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::FindSpender(const COutPoint& prevout, SpentIndexEntry& entry) const
+{
+    DBSpentValue value;
+    if (!m_db->Read(DBSpentKey(prevout), value)) {
+        return false;
+    }
+    entry.txid = value.txid;
+    entry.input_index = value.input_index;
+    entry.height = value.height;
+    return true;
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <primitives/transaction.h>
+
+/** The transaction input spending an output */
+struct SpentIndexEntry {
+    uint256 txid;
+    uint32_t input_index{0};
+    int height{0};
+};
+
+/**
+ * SpentIndex is used to look up the transaction input spending a given
+ * transaction output. The index is written to a LevelDB database and
+ * records the spending input for each outpoint spent in the active chain.
+ */
+class SpentIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool DisconnectBlocks(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the input spending an output.
+    ///
+    /// @param[in]   prevout  The output to look up.
+    /// @param[out]  entry  The spending input, if found.
+    /// @return  true if the output is spent in an indexed block
+    bool FindSpender(const COutPoint& prevout, SpentIndexEntry& entry) const;
+};
+
+/// The global spent output index, used in gettxspendingprevout. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
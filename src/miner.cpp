@@ -22,6 +22,7 @@
 #include <util/system.h>
 
 #include <algorithm>
+#include <set>
 #include <utility>
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
@@ -442,3 +443,31 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+std::vector<uint256> GetBlockTemplateTxids(const CBlock& block)
+{
+    std::vector<uint256> txids;
+    txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        txids.push_back(tx->GetHash());
+    }
+    return txids;
+}
+
+BlockTemplateDiff GetBlockTemplateDiff(const std::vector<uint256>& old_txids, const CBlock& block)
+{
+    BlockTemplateDiff diff;
+    std::set<uint256> old_set(old_txids.begin(), old_txids.end());
+    std::set<uint256> new_set;
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        if (tx.IsCoinBase()) continue;
+        new_set.insert(tx.GetHash());
+        if (!old_set.count(tx.GetHash())) diff.added.push_back(i);
+    }
+    for (const uint256& txid : old_txids) {
+        if (!new_set.count(txid)) diff.removed.push_back(txid);
+    }
+    return diff;
+}
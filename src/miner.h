@@ -203,4 +203,18 @@ private:
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
+/** Non-coinbase transactions that differ between two block templates */
+struct BlockTemplateDiff
+{
+    //! Positions in the new block's vtx of transactions the old template did not have, in block order
+    std::vector<size_t> added;
+    //! Txids of transactions in the old template that the new one no longer includes
+    std::vector<uint256> removed;
+};
+
+/** Txids of the non-coinbase transactions of a block, in block order */
+std::vector<uint256> GetBlockTemplateTxids(const CBlock& block);
+/** Compare the transactions of block against the txids of an earlier template */
+BlockTemplateDiff GetBlockTemplateDiff(const std::vector<uint256>& old_txids, const CBlock& block);
+
 #endif // BITCOIN_MINER_H
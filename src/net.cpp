@@ -32,6 +32,14 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/upnpcommands.h>
@@ -41,6 +49,7 @@
 static_assert(MINIUPNPC_API_VERSION >= 10, "miniUPnPc API version >= 10 assumed");
 #endif
 
+#include <array>
 #include <unordered_map>
 
 #include <math.h>
@@ -75,6 +84,21 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+/** Maximum number of send buffer chunks passed to a single send call */
+static constexpr size_t MAX_SEND_CHUNKS = 64;
+
+/** Maximum number of unused segments kept by the send buffer pool (8 MiB) */
+static constexpr size_t MAX_FREE_SEND_SEGMENTS = 512;
+/** Bytes of free receive buffers kept per size class of the receive buffer pool */
+static constexpr size_t MAX_FREE_RECV_BYTES_PER_CLASS = 1024 * 1024;
+/** Buffer size given to a message before any of its payload has been received */
+static constexpr unsigned int RECV_BUFFER_INITIAL_SIZE = 256 * 1024;
+
+#ifdef USE_EPOLL
+/** Maximum number of readiness events fetched per epoll_wait() call */
+static constexpr int MAX_EPOLL_EVENTS = 256;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -657,18 +681,35 @@ int V1TransportDeserializer::readHeader(const char *pch, unsigned int nBytes)
     // switch state to reading message data
     in_data = true;
 
+    // Take a buffer of the full message size from the pool, up to 256 KiB.
+    // Larger messages grow theirs as the data arrives, so that a peer can't
+    // make us allocate much more than it actually sent.
+    vRecv = GetRecvBufferPool().Get(std::min(hdr.nMessageSize, RECV_BUFFER_INITIAL_SIZE), vRecv.GetType(), vRecv.GetVersion());
+
     return nCopy;
 }
 
+void V1TransportDeserializer::PrepareData(unsigned int nBytes)
+{
+    const size_t needed = nDataPos + nBytes;
+    if (vRecv.size() >= needed) return;
+    if (vRecv.capacity() < needed) {
+        // Double the buffer, but never beyond the total message size.
+        const size_t grow = std::min<size_t>(hdr.nMessageSize, std::max<size_t>(needed, 2 * vRecv.capacity()));
+        CDataStream grown = GetRecvBufferPool().Get(grow, vRecv.GetType(), vRecv.GetVersion());
+        grown.write(vRecv.data(), nDataPos);
+        GetRecvBufferPool().Put(std::move(vRecv));
+        vRecv = std::move(grown);
+    }
+    vRecv.resize(std::min<size_t>(hdr.nMessageSize, vRecv.capacity()));
+}
+
 int V1TransportDeserializer::readData(const char *pch, unsigned int nBytes)
 {
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
-    if (vRecv.size() < nDataPos + nCopy) {
-        // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
-    }
+    PrepareData(nCopy);
 
     hasher.Write((const unsigned char*)pch, nCopy);
     memcpy(&vRecv[nDataPos], pch, nCopy);
@@ -731,33 +772,208 @@ void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vec
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, header, 0, hdr};
 }
 
+RecvBufferPool::RecvBufferPool(size_t max_bytes_per_class)
+    : m_free(SizeClass(MAX_POOLED_SIZE) + 1), m_max_bytes_per_class(max_bytes_per_class) {}
+
+size_t RecvBufferPool::SizeClass(size_t size)
+{
+    // Index of the smallest power of two, starting at MIN_POOLED_SIZE, that holds size
+    size_t size_class = 0;
+    while ((MIN_POOLED_SIZE << size_class) < size) ++size_class;
+    return size_class;
+}
+
+CDataStream RecvBufferPool::Get(size_t size, int type, int version)
+{
+    if (size >= MIN_POOLED_SIZE && size <= MAX_POOLED_SIZE) {
+        const size_t size_class = SizeClass(size);
+        {
+            LOCK(m_mutex);
+            std::vector<CDataStream>& free = m_free[size_class];
+            if (!free.empty()) {
+                CDataStream stream = std::move(free.back());
+                free.pop_back();
+                stream.SetType(type);
+                stream.SetVersion(version);
+                return stream;
+            }
+        }
+        size = MIN_POOLED_SIZE << size_class;
+    }
+    CDataStream stream(type, version);
+    stream.reserve(size);
+    return stream;
+}
+
+void RecvBufferPool::Put(CDataStream&& stream)
+{
+    stream.clear();
+    const size_t capacity = stream.capacity();
+    if (capacity < MIN_POOLED_SIZE || capacity > MAX_POOLED_SIZE) return;
+    // Round down, so that every buffer in a class is at least its size
+    size_t size_class = SizeClass(capacity);
+    if ((MIN_POOLED_SIZE << size_class) > capacity) --size_class;
+    const size_t max_free = std::max<size_t>(1, m_max_bytes_per_class / (MIN_POOLED_SIZE << size_class));
+    LOCK(m_mutex);
+    std::vector<CDataStream>& free = m_free[size_class];
+    if (free.size() < max_free) {
+        free.push_back(std::move(stream));
+    }
+}
+
+size_t RecvBufferPool::FreeCount() const
+{
+    LOCK(m_mutex);
+    size_t count = 0;
+    for (const auto& free : m_free) count += free.size();
+    return count;
+}
+
+RecvBufferPool& GetRecvBufferPool()
+{
+    static RecvBufferPool pool(MAX_FREE_RECV_BYTES_PER_CLASS);
+    return pool;
+}
+
+SendBufferPool& GetSendBufferPool()
+{
+    static SendBufferPool pool(MAX_FREE_SEND_SEGMENTS);
+    return pool;
+}
+
+std::vector<unsigned char> SendBufferPool::Get()
+{
+    {
+        LOCK(m_mutex);
+        if (!m_free.empty()) {
+            std::vector<unsigned char> segment = std::move(m_free.back());
+            m_free.pop_back();
+            return segment;
+        }
+    }
+    std::vector<unsigned char> segment;
+    segment.reserve(SEGMENT_SIZE);
+    return segment;
+}
+
+void SendBufferPool::Put(std::vector<unsigned char>&& segment)
+{
+    if (segment.capacity() != SEGMENT_SIZE) return;
+    segment.clear();
+    LOCK(m_mutex);
+    if (m_free.size() < m_max_free) {
+        m_free.push_back(std::move(segment));
+    }
+}
+
+size_t SendBufferPool::FreeCount() const
+{
+    LOCK(m_mutex);
+    return m_free.size();
+}
+
+void SendBuffer::Append(Span<const unsigned char> data)
+{
+    m_size += data.size();
+    while (data.size() > 0) {
+        // Fill up the spare capacity of the last chunk without reallocating
+        // it, as a partially sent first chunk must not move.
+        if (m_chunks.empty() || m_chunks.back().size() == m_chunks.back().capacity()) {
+            m_chunks.push_back(m_pool.Get());
+        }
+        std::vector<unsigned char>& chunk = m_chunks.back();
+        const size_t n = std::min<size_t>(data.size(), chunk.capacity() - chunk.size());
+        chunk.insert(chunk.end(), data.data(), data.data() + n);
+        data = data.subspan(n);
+    }
+}
+
+void SendBuffer::Append(std::vector<unsigned char>&& data)
+{
+    if (data.size() < SendBufferPool::SEGMENT_SIZE) {
+        Append(Span<const unsigned char>(data.data(), data.size()));
+        return;
+    }
+    m_size += data.size();
+    m_chunks.push_back(std::move(data));
+}
+
+size_t SendBuffer::Peek(Span<const unsigned char>* out, size_t max) const
+{
+    size_t count = 0;
+    size_t offset = m_offset;
+    for (auto it = m_chunks.begin(); it != m_chunks.end() && count < max; ++it) {
+        out[count++] = Span<const unsigned char>(it->data() + offset, it->size() - offset);
+        offset = 0;
+    }
+    return count;
+}
+
+void SendBuffer::Consume(size_t bytes)
+{
+    assert(bytes <= m_size);
+    m_size -= bytes;
+    while (bytes > 0) {
+        std::vector<unsigned char>& chunk = m_chunks.front();
+        const size_t n = std::min(bytes, chunk.size() - m_offset);
+        m_offset += n;
+        bytes -= n;
+        if (m_offset == chunk.size()) {
+            m_pool.Put(std::move(chunk));
+            m_chunks.pop_front();
+            m_offset = 0;
+        }
+    }
+}
+
+void SendBuffer::clear()
+{
+    for (std::vector<unsigned char>& chunk : m_chunks) {
+        m_pool.Put(std::move(chunk));
+    }
+    m_chunks.clear();
+    m_offset = 0;
+    m_size = 0;
+}
+
 size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend)
 {
-    auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
-    while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+    while (!pnode->m_send_buffer.empty()) {
+        // Hand as much of the queue as possible to the kernel in one call
+        std::array<Span<const unsigned char>, MAX_SEND_CHUNKS> chunks;
+        const size_t nChunks = pnode->m_send_buffer.Peek(chunks.data(), chunks.size());
+        size_t nAttempted = 0;
         int nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nAttempted = chunks[0].size();
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(chunks[0].data()), chunks[0].size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            std::array<struct iovec, MAX_SEND_CHUNKS> iov;
+            for (size_t i = 0; i < nChunks; ++i) {
+                iov[i].iov_base = const_cast<unsigned char*>(chunks[i].data());
+                iov[i].iov_len = chunks[i].size();
+                nAttempted += chunks[i].size();
+            }
+            struct msghdr msg{};
+            msg.msg_iov = iov.data();
+            msg.msg_iovlen = nChunks;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
-                pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+            pnode->m_send_buffer.Consume(nBytes);
+            pnode->fPauseSend = pnode->m_send_buffer.size() > nSendBufferMaxSize;
+            if ((size_t)nBytes < nAttempted) {
+                // could not send everything; the socket buffer is full
                 break;
             }
         } else {
@@ -775,11 +991,6 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
         }
     }
 
-    if (it == pnode->vSendMsg.end()) {
-        assert(pnode->nSendOffset == 0);
-        assert(pnode->nSendSize == 0);
-    }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     return nSentSize;
 }
 
@@ -1045,6 +1256,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterSocketEvents(pnode);
     }
 
     // We received a new connection, harvest entropy from the time (and our peer count)
@@ -1078,6 +1290,8 @@ void CConnman::DisconnectNodes()
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
 
+                UnregisterSocketEvents(pnode);
+
                 // close socket and cleanup
                 pnode->CloseSocketDisconnect();
 
@@ -1185,7 +1399,7 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
             bool select_send;
             {
                 LOCK(pnode->cs_vSend);
-                select_send = !pnode->vSendMsg.empty();
+                select_send = !pnode->m_send_buffer.empty();
             }
 
             LOCK(pnode->cs_hSocket);
@@ -1206,8 +1420,194 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
     return !recv_set.empty() || !send_set.empty() || !error_set.empty();
 }
 
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode)
+{
+    if (str == "select") {
+        mode = SocketEventsMode::SELECT;
+        return true;
+    }
 #ifdef USE_POLL
+    if (str == "poll") {
+        mode = SocketEventsMode::POLL;
+        return true;
+    }
+#endif
+#ifdef USE_EPOLL
+    if (str == "epoll") {
+        mode = SocketEventsMode::EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string SupportedSocketEventsModes()
+{
+    std::string modes = "select";
+#ifdef USE_POLL
+    modes += ", poll";
+#endif
+#ifdef USE_EPOLL
+    modes += ", epoll";
+#endif
+    return modes;
+}
+
+void CConnman::InitSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (m_socket_events_mode == SocketEventsMode::EPOLL && m_epoll_fd == -1) {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd == -1) {
+            LogPrintf("epoll_create1 failed (%s), falling back to poll()\n", NetworkErrorString(WSAGetLastError()));
+            m_socket_events_mode = SocketEventsMode::POLL;
+        }
+    }
+#endif
+}
+
+void CConnman::CloseSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif
+}
+
+void CConnman::RegisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (m_socket_events_mode != SocketEventsMode::EPOLL || m_epoll_fd == -1) return;
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) return;
+
+    // Peer sockets are registered once for both directions, edge-triggered:
+    // the kernel only reports changes in readiness, and SocketHandler()
+    // remembers them in the node until a short read or write shows that the
+    // socket was drained. This avoids rebuilding and rescanning the full
+    // descriptor set on every iteration.
+    struct epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = pnode->hSocket;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+        return;
+    }
+    pnode->m_epoll_socket = pnode->hSocket;
+    m_epoll_nodes[pnode->hSocket] = pnode;
+#endif
+}
+
+void CConnman::UnregisterSocketEvents(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    // No EPOLL_CTL_DEL: closing the socket removes it from the epoll set, and
+    // by now the descriptor may already belong to a newer connection.
+    if (pnode->m_epoll_socket == INVALID_SOCKET) return;
+    auto it = m_epoll_nodes.find(pnode->m_epoll_socket);
+    if (it != m_epoll_nodes.end() && it->second == pnode) {
+        m_epoll_nodes.erase(it);
+    }
+    pnode->m_epoll_socket = INVALID_SOCKET;
+#endif
+}
+
+#ifdef USE_EPOLL
+bool CConnman::SelectReadySocket(CNode* pnode, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set)
+{
+    // Same priorities as GenerateSelectSet(), restricted to sockets that are
+    // known to be ready.
+    bool select_send;
+    {
+        LOCK(pnode->cs_vSend);
+        select_send = !pnode->m_send_buffer.empty();
+    }
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return false;
+
+    if (select_send) {
+        if (!pnode->m_sock_send_ready) return false;
+        send_set.insert(pnode->hSocket);
+        return true;
+    }
+    if (!pnode->fPauseRecv && pnode->m_sock_recv_ready) {
+        recv_set.insert(pnode->hSocket);
+        return true;
+    }
+    return false;
+}
+
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    // Sockets left ready by the previous iteration (more data than one
+    // recv() buffer, or send data queued by the message handler thread) are
+    // serviced without waiting.
+    bool have_work = false;
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            have_work |= SelectReadySocket(pnode, recv_set, send_set);
+        }
+    }
+
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int nEvents = epoll_wait(m_epoll_fd, events, MAX_EPOLL_EVENTS, have_work ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    LOCK(cs_vNodes);
+    for (int i = 0; i < nEvents; ++i) {
+        const SOCKET socket = events[i].data.fd;
+        auto it = m_epoll_nodes.find(socket);
+        if (it == m_epoll_nodes.end()) {
+            for (const ListenSocket& hListenSocket : vhListenSocket) {
+                if (hListenSocket.socket == socket) recv_set.insert(socket);
+            }
+            continue;
+        }
+        CNode* pnode = it->second;
+        // Errors and hangups are picked up by the next recv().
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) pnode->m_sock_recv_ready = true;
+        if (events[i].events & EPOLLOUT) pnode->m_sock_send_ready = true;
+        SelectReadySocket(pnode, recv_set, send_set);
+    }
+}
+#endif
+
 void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+#ifdef USE_EPOLL
+    if (m_socket_events_mode == SocketEventsMode::EPOLL && m_epoll_fd != -1) {
+        SocketEventsEpoll(recv_set, send_set, error_set);
+        return;
+    }
+#endif
+#ifdef USE_POLL
+    if (m_socket_events_mode != SocketEventsMode::SELECT) {
+        SocketEventsPoll(recv_set, send_set, error_set);
+        return;
+    }
+#endif
+    SocketEventsSelect(recv_set, send_set, error_set);
+}
+
+#ifdef USE_POLL
+void CConnman::SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1248,8 +1648,9 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         if (pollfd_entry.revents & (POLLERR|POLLHUP)) error_set.insert(pollfd_entry.fd);
     }
 }
-#else
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+#endif
+
+void CConnman::SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1322,7 +1723,6 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         }
     }
 }
-#endif
 
 void CConnman::SocketHandler()
 {
@@ -1382,6 +1782,10 @@ void CConnman::SocketHandler()
                     continue;
                 nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
             }
+            if (nBytes < (int)sizeof(pchBuf)) {
+                // Socket drained; wait for epoll to report more data
+                pnode->m_sock_recv_ready = false;
+            }
             if (nBytes > 0)
             {
                 bool notify = false;
@@ -1437,6 +1841,10 @@ void CConnman::SocketHandler()
             if (nBytes) {
                 RecordBytesSent(nBytes);
             }
+            if (!pnode->m_send_buffer.empty()) {
+                // Send buffer full; wait for epoll to report it writable
+                pnode->m_sock_send_ready = false;
+            }
         }
 
         InactivityCheck(pnode);
@@ -2018,6 +2426,80 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterSocketEvents(pnode);
+    }
+}
+
+bool CConnman::ProcessNodeMessages(CNode* pnode)
+{
+    if (pnode->fDisconnect || flagInterruptMsgProc)
+        return false;
+
+    // Receive messages
+    bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
+    if (flagInterruptMsgProc)
+        return false;
+    // Send messages
+    {
+        LOCK(pnode->cs_sendProcessing);
+        m_msgproc->SendMessages(pnode);
+    }
+    return fMoreNodeWork && !pnode->fPauseSend;
+}
+
+bool CConnman::ProcessNextRoundNode(UniqueLock<Mutex>& lock)
+{
+    if (m_msghand_next >= m_msghand_nodes.size())
+        return false;
+
+    CNode* pnode = m_msghand_nodes[m_msghand_next++];
+    ++m_msghand_running;
+    bool fMoreNodeWork;
+    {
+        UniqueLock<Mutex>::reverse_lock unlock(lock, "m_msghand_mutex", __FILE__, __LINE__);
+        fMoreNodeWork = ProcessNodeMessages(pnode);
+    }
+    m_msghand_more_work |= fMoreNodeWork;
+    if (--m_msghand_running == 0 && m_msghand_next >= m_msghand_nodes.size()) {
+        m_msghand_cond.notify_all();
+    }
+    return true;
+}
+
+bool CConnman::ProcessMessagesRound(const std::vector<CNode*>& nodes)
+{
+    if (m_message_handler_workers.empty()) {
+        bool fMoreWork = false;
+        for (CNode* pnode : nodes) {
+            fMoreWork |= ProcessNodeMessages(pnode);
+            if (flagInterruptMsgProc)
+                return false;
+        }
+        return fMoreWork;
+    }
+
+    WAIT_LOCK(m_msghand_mutex, lock);
+    m_msghand_nodes = nodes;
+    m_msghand_next = 0;
+    m_msghand_more_work = false;
+    m_msghand_cond.notify_all();
+
+    // Work through the round alongside the workers, then wait for the nodes
+    // they are still busy with, so that no node is ever in two rounds at once.
+    while (ProcessNextRoundNode(lock)) {}
+    m_msghand_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_msghand_mutex) { return m_msghand_running == 0; });
+    m_msghand_nodes.clear();
+    m_msghand_next = 0;
+    return m_msghand_more_work;
+}
+
+void CConnman::ThreadMessageHandlerWorker()
+{
+    WAIT_LOCK(m_msghand_mutex, lock);
+    while (!flagInterruptMsgProc) {
+        if (!ProcessNextRoundNode(lock)) {
+            m_msghand_cond.wait(lock);
+        }
     }
 }
 
@@ -2034,27 +2516,9 @@ void CConnman::ThreadMessageHandler()
             }
         }
 
-        bool fMoreWork = false;
-
-        for (CNode* pnode : vNodesCopy)
-        {
-            if (pnode->fDisconnect)
-                continue;
-
-            // Receive messages
-            bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
-            fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
-            if (flagInterruptMsgProc)
-                return;
-            // Send messages
-            {
-                LOCK(pnode->cs_sendProcessing);
-                m_msgproc->SendMessages(pnode);
-            }
-
-            if (flagInterruptMsgProc)
-                return;
-        }
+        bool fMoreWork = ProcessMessagesRound(vNodesCopy);
+        if (flagInterruptMsgProc)
+            return;
 
         {
             LOCK(cs_vNodes);
@@ -2136,6 +2600,22 @@ bool CConnman::BindListenPort(const CService& addrBind, std::string& strError, N
         return false;
     }
 
+#ifdef USE_EPOLL
+    if (m_socket_events_mode == SocketEventsMode::EPOLL) {
+        // Listening sockets stay level-triggered: AcceptConnection() only
+        // accepts one connection per iteration.
+        struct epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = hListenSocket;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, hListenSocket, &event) != 0) {
+            strError = strprintf("Error: Listening for incoming connections failed (epoll_ctl returned error %s)", NetworkErrorString(WSAGetLastError()));
+            LogPrintf("%s\n", strError);
+            CloseSocket(hListenSocket);
+            return false;
+        }
+    }
+#endif
+
     vhListenSocket.push_back(ListenSocket(hListenSocket, permissions));
 
     if (addrBind.IsRoutable() && fDiscover && (permissions & PF_NOBAN) == 0)
@@ -2257,6 +2737,7 @@ bool CConnman::InitBinds(const std::vector<CService>& binds, const std::vector<N
 bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 {
     Init(connOptions);
+    InitSocketEvents();
 
     {
         LOCK(cs_totalBytesRecv);
@@ -2348,6 +2829,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 1; i < connOptions.m_message_handler_threads; ++i) {
+        const std::string name = strprintf("msghand.%d", i);
+        m_message_handler_workers.emplace_back([this, name] { TraceThread(name.c_str(), std::bind(&CConnman::ThreadMessageHandlerWorker, this)); });
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery([this] { DumpAddresses(); }, DUMP_PEERS_INTERVAL);
@@ -2377,6 +2862,10 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    {
+        LOCK(m_msghand_mutex);
+        m_msghand_cond.notify_all();
+    }
 
     interruptNet();
     InterruptSocks5(true);
@@ -2398,6 +2887,10 @@ void CConnman::StopThreads()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (std::thread& worker : m_message_handler_workers) {
+        worker.join();
+    }
+    m_message_handler_workers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2426,6 +2919,7 @@ void CConnman::StopNodes()
 
     // clean up some globals (to help leak detection)
     for (CNode* pnode : vNodes) {
+        UnregisterSocketEvents(pnode);
         DeleteNode(pnode);
     }
     for (CNode* pnode : vNodesDisconnected) {
@@ -2434,6 +2928,7 @@ void CConnman::StopNodes()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    CloseSocketEvents();
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -2727,7 +3222,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
         LogPrint(BCLog::NET, "Added connection peer=%d\n", id);
     }
 
-    m_deserializer = MakeUnique<V1TransportDeserializer>(V1TransportDeserializer(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+    m_deserializer = MakeUnique<V1TransportDeserializer>(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
     m_serializer = MakeUnique<V1TransportSerializer>(V1TransportSerializer());
 }
 
@@ -2754,17 +3249,16 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
-        bool optimisticSend(pnode->vSendMsg.empty());
+        bool optimisticSend(pnode->m_send_buffer.empty());
 
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
-        pnode->nSendSize += nTotalSize;
 
-        if (pnode->nSendSize > nSendBufferMaxSize)
-            pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
+        pnode->m_send_buffer.Append(Span<const unsigned char>(serializedHeader.data(), serializedHeader.size()));
         if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->m_send_buffer.Append(std::move(msg.data));
+        if (pnode->m_send_buffer.size() > nSendBufferMaxSize)
+            pnode->fPauseSend = true;
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -19,6 +19,7 @@
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
+#include <span.h>
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
@@ -29,6 +30,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -51,6 +53,23 @@ static const int PING_INTERVAL = 2 * 60;
 static const int TIMEOUT_INTERVAL = 20 * 60;
 /** Run the feeler connection loop once every 2 minutes or 120 seconds. **/
 static const int FEELER_INTERVAL = 120;
+/** Mechanism used by the socket handler thread to wait for socket readiness (-socketevents) */
+enum class SocketEventsMode {
+    SELECT,
+    POLL,
+    EPOLL,
+};
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKET_EVENTS_MODE = SocketEventsMode::EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKET_EVENTS_MODE = SocketEventsMode::POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKET_EVENTS_MODE = SocketEventsMode::SELECT;
+#endif
+/** Parse a -socketevents value. Returns false if it is unknown or not supported on this platform. */
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode);
+/** Comma separated list of the -socketevents values supported on this platform */
+std::string SupportedSocketEventsModes();
 /** The maximum number of entries in an 'inv' protocol message */
 static const unsigned int MAX_INV_SZ = 50000;
 /** The maximum number of entries in a locator */
@@ -89,6 +108,10 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of threads processing peer messages (-msghandlerthreads) */
+static const int DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+/** Maximum number of threads processing peer messages */
+static const int MAX_MESSAGE_HANDLER_THREADS = 16;
 
 typedef int64_t NodeId;
 
@@ -154,6 +177,8 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         std::vector<bool> m_asmap;
+        SocketEventsMode m_socket_events_mode = DEFAULT_SOCKET_EVENTS_MODE;
+        int m_message_handler_threads = 1;
     };
 
     void Init(const Options& connOptions) {
@@ -172,6 +197,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_socket_events_mode = connOptions.m_socket_events_mode;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -328,7 +354,7 @@ public:
     */
     int64_t PoissonNextSendInbound(int64_t now, int average_interval_seconds);
 
-    void SetAsmap(std::vector<bool> asmap) { addrman.m_asmap = std::move(asmap); }
+    void SetAsmap(std::vector<bool> asmap) { addrman.SetAsmap(std::move(asmap)); }
 
 private:
     struct ListenSocket {
@@ -348,12 +374,35 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    void ThreadMessageHandlerWorker();
+    /** Process messages for each of nodes once, spread over the message handler threads. Returns whether there is more work. */
+    bool ProcessMessagesRound(const std::vector<CNode*>& nodes);
+    /** Take the next node of the current round and process it. Returns false once all nodes are taken. */
+    bool ProcessNextRoundNode(UniqueLock<Mutex>& lock) EXCLUSIVE_LOCKS_REQUIRED(m_msghand_mutex);
+    /** Receive and send messages for a single node. Returns whether it has more work. */
+    bool ProcessNodeMessages(CNode* pnode);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    void SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    /** Add pnode's socket to recv_set or send_set if it was reported ready and still has work to do */
+    bool SelectReadySocket(CNode* pnode, std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set);
+#endif
+    /** Set up the epoll instance if that mode was requested, falling back to poll()/select() if it cannot be created */
+    void InitSocketEvents();
+    /** Register a newly added node's socket with the epoll instance (edge-triggered) */
+    void RegisterSocketEvents(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    /** Forget a node that is being removed from vNodes */
+    void UnregisterSocketEvents(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    void CloseSocketEvents();
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -398,6 +447,16 @@ private:
     // P2P timeout in seconds
     int64_t m_peer_connect_timeout;
 
+    /** How the socket handler waits for socket readiness; may be downgraded by InitSocketEvents() */
+    SocketEventsMode m_socket_events_mode{DEFAULT_SOCKET_EVENTS_MODE};
+#ifdef USE_EPOLL
+    /** epoll instance that all listening and peer sockets are registered with, or -1 */
+    int m_epoll_fd{-1};
+    /** Peer sockets registered with m_epoll_fd. Entries of closed sockets are
+     *  dropped by the kernel, so this is only used to map events to nodes. */
+    std::unordered_map<SOCKET, CNode*> m_epoll_nodes GUARDED_BY(cs_vNodes);
+#endif
+
     // Whitelisted ranges. Any node connecting from these is automatically
     // whitelisted (as well as those connecting to whitelisted binds).
     std::vector<NetWhitelistPermissions> vWhitelistedRange;
@@ -471,6 +530,21 @@ private:
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
 
+    /** Additional message handler threads (-msghandlerthreads). Within a round,
+     *  every node is handed to exactly one thread, so each peer's messages are
+     *  still processed in order; the message processor serializes whatever is
+     *  not safe to run for different peers at the same time. */
+    std::vector<std::thread> m_message_handler_workers;
+    Mutex m_msghand_mutex;
+    std::condition_variable m_msghand_cond;
+    /** Nodes of the round in progress */
+    std::vector<CNode*> m_msghand_nodes GUARDED_BY(m_msghand_mutex);
+    /** Index of the next node in m_msghand_nodes that no thread has taken yet */
+    size_t m_msghand_next GUARDED_BY(m_msghand_mutex){0};
+    /** Number of nodes taken by a thread and not finished yet */
+    size_t m_msghand_running GUARDED_BY(m_msghand_mutex){0};
+    bool m_msghand_more_work GUARDED_BY(m_msghand_mutex){false};
+
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
      *  This takes the place of a feeler connection */
@@ -609,6 +683,39 @@ public:
 
 
 
+/**
+ * Free lists of message receive buffers, shared by all peers. Buffers are
+ * kept in power-of-two size classes, so that a message can be given one of
+ * its own size without a fresh allocation.
+ */
+class RecvBufferPool
+{
+public:
+    /** Smaller buffers are allocated to their exact size and not pooled */
+    static constexpr size_t MIN_POOLED_SIZE = 256;
+    /** Larger buffers are allocated to their exact size and not pooled */
+    static constexpr size_t MAX_POOLED_SIZE = 4 * 1024 * 1024;
+
+    /** Keep at most max_bytes_per_class (but at least one buffer) of free buffers in each size class */
+    explicit RecvBufferPool(size_t max_bytes_per_class);
+
+    /** Get an empty stream with room for at least size bytes */
+    CDataStream Get(size_t size, int type, int version);
+    /** Return a stream's buffer for reuse; buffers outside the pooled sizes are simply freed */
+    void Put(CDataStream&& stream);
+    size_t FreeCount() const;
+
+private:
+    static size_t SizeClass(size_t size);
+
+    mutable Mutex m_mutex;
+    std::vector<std::vector<CDataStream>> m_free GUARDED_BY(m_mutex);
+    const size_t m_max_bytes_per_class;
+};
+
+/** The pool used for all received messages */
+RecvBufferPool& GetRecvBufferPool();
+
 /** Transport protocol agnostic message container.
  * Ideally it should only contain receive time, payload,
  * command and size.
@@ -625,6 +732,10 @@ public:
     std::string m_command;
 
     CNetMessage(CDataStream&& recv_in) : m_recv(std::move(recv_in)) {}
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    // hand the payload buffer back for the next message
+    ~CNetMessage() { GetRecvBufferPool().Put(std::move(m_recv)); }
 
     void SetVersion(int nVersionIn)
     {
@@ -664,8 +775,12 @@ private:
     const uint256& GetMessageHash() const;
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+    void PrepareData(unsigned int nBytes);
 
     void Reset() {
+        // vRecv has been moved out with the last message or is returned to
+        // the pool; a buffer for the next one is taken once its header is read
+        GetRecvBufferPool().Put(std::move(vRecv));
         vRecv.clear();
         hdrbuf.clear();
         hdrbuf.resize(24);
@@ -681,6 +796,7 @@ public:
     V1TransportDeserializer(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         Reset();
     }
+    ~V1TransportDeserializer() { GetRecvBufferPool().Put(std::move(vRecv)); }
 
     bool Complete() const override
     {
@@ -715,6 +831,66 @@ public:
     void prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) override;
 };
 
+/** Free list of fixed-size send buffer segments, shared by all peers */
+class SendBufferPool
+{
+public:
+    /** Size of a pooled segment. Small messages are packed into these. */
+    static constexpr size_t SEGMENT_SIZE = 16 * 1024;
+
+    explicit SendBufferPool(size_t max_free) : m_max_free(max_free) {}
+
+    /** Get an empty segment with SEGMENT_SIZE capacity */
+    std::vector<unsigned char> Get();
+    /** Return a segment obtained from Get(); other buffers are simply freed */
+    void Put(std::vector<unsigned char>&& segment);
+    size_t FreeCount() const;
+
+private:
+    mutable Mutex m_mutex;
+    std::vector<std::vector<unsigned char>> m_free GUARDED_BY(m_mutex);
+    const size_t m_max_free;
+};
+
+/** The pool used by all CNode send buffers */
+SendBufferPool& GetSendBufferPool();
+
+/**
+ * Bytes queued for sending to a peer, as a list of chunks that can be
+ * handed to a single scatter-gather send. Consecutive small messages are
+ * copied into shared pool segments, while payloads of at least a segment
+ * are kept as their own chunk without copying.
+ */
+class SendBuffer
+{
+public:
+    explicit SendBuffer(SendBufferPool& pool) : m_pool(pool) {}
+    ~SendBuffer() { clear(); }
+    SendBuffer(const SendBuffer&) = delete;
+    SendBuffer& operator=(const SendBuffer&) = delete;
+
+    void Append(Span<const unsigned char> data);
+    void Append(std::vector<unsigned char>&& data);
+
+    /** Store up to max unsent chunks in out, returning how many were stored */
+    size_t Peek(Span<const unsigned char>* out, size_t max) const;
+    /** Drop the first bytes of unsent data, after they have been sent */
+    void Consume(size_t bytes);
+
+    bool empty() const { return m_size == 0; }
+    /** Number of unsent bytes */
+    size_t size() const { return m_size; }
+    size_t ChunkCount() const { return m_chunks.size(); }
+    void clear();
+
+private:
+    SendBufferPool& m_pool;
+    std::deque<std::vector<unsigned char>> m_chunks;
+    /** Bytes of the first chunk that have already been sent */
+    size_t m_offset{0};
+    size_t m_size{0};
+};
+
 /** Information about a peer */
 class CNode
 {
@@ -728,10 +904,8 @@ public:
     // socket
     std::atomic<ServiceFlags> nServices{NODE_NONE};
     SOCKET hSocket GUARDED_BY(cs_hSocket);
-    size_t nSendSize{0}; // total size of all vSendMsg entries
-    size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    SendBuffer m_send_buffer GUARDED_BY(cs_vSend){GetSendBufferPool()};
     RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -794,8 +968,11 @@ public:
     std::atomic<int> nStartingHeight{-1};
 
     // flood relay
-    std::vector<CAddress> vAddrToSend;
-    const std::unique_ptr<CRollingBloomFilter> m_addr_known;
+    // Addresses are pushed to a node while other nodes' messages are being
+    // processed, possibly on another message handler thread.
+    Mutex m_addr_send_mutex;
+    std::vector<CAddress> vAddrToSend GUARDED_BY(m_addr_send_mutex);
+    const std::unique_ptr<CRollingBloomFilter> m_addr_known PT_GUARDED_BY(m_addr_send_mutex);
     bool fGetAddr{false};
     std::chrono::microseconds m_next_addr_send GUARDED_BY(cs_sendProcessing){0};
     std::chrono::microseconds m_next_local_addr_send GUARDED_BY(cs_sendProcessing){0};
@@ -820,9 +997,8 @@ public:
 
         mutable RecursiveMutex cs_tx_inventory;
         CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_tx_inventory){50000, 0.000001};
-        // Set of transaction ids we still have to announce.
-        // They are sorted by the mempool before relay, so the order is not important.
-        std::set<uint256> setInventoryTxToSend;
+        // Transactions still to announce are taken from the shared
+        // announcement queue in net_processing.
         // Used for BIP35 mempool sending
         bool fSendMempool GUARDED_BY(cs_tx_inventory){false};
         // Last time a "MEMPOOL" request was serviced.
@@ -891,6 +1067,14 @@ private:
     NetPermissionFlags m_permissionFlags{ PF_NONE };
     std::list<CNetMessage> vRecvMsg;  // Used only by SocketHandler thread
 
+    // Readiness last reported by edge-triggered epoll and not yet consumed
+    // by a short read or write. Used only by SocketHandler thread.
+    bool m_sock_recv_ready{false};
+    bool m_sock_send_ready{false};
+    // Socket this node was registered with epoll under, kept after hSocket
+    // is closed so the registration can be forgotten.
+    SOCKET m_epoll_socket{INVALID_SOCKET};
+
     mutable RecursiveMutex cs_addrName;
     std::string addrName GUARDED_BY(cs_addrName);
 
@@ -950,6 +1134,7 @@ public:
     void AddAddressKnown(const CAddress& _addr)
     {
         assert(m_addr_known);
+        LOCK(m_addr_send_mutex);
         m_addr_known->insert(_addr.GetKey());
     }
 
@@ -959,6 +1144,7 @@ public:
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
         assert(m_addr_known);
+        LOCK(m_addr_send_mutex);
         if (_addr.IsValid() && !m_addr_known->contains(_addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
@@ -979,12 +1165,7 @@ public:
 
     void PushInventory(const CInv& inv)
     {
-        if (inv.type == MSG_TX && m_tx_relay != nullptr) {
-            LOCK(m_tx_relay->cs_tx_inventory);
-            if (!m_tx_relay->filterInventoryKnown.contains(inv.hash)) {
-                m_tx_relay->setInventoryTxToSend.insert(inv.hash);
-            }
-        } else if (inv.type == MSG_BLOCK) {
+        if (inv.type == MSG_BLOCK) {
             LOCK(cs_inventory);
             vInventoryBlockToSend.push_back(inv.hash);
         }
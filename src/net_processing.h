@@ -14,13 +14,17 @@
 class CTxMemPool;
 
 extern RecursiveMutex cs_main;
-extern RecursiveMutex g_cs_orphans;
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
+/** Default for -cmpctblockfastforward, relaying compact blocks before they are fully validated */
+static const bool DEFAULT_CMPCTBLOCK_FAST_FORWARD = true;
+
+/** Whether to relay compact blocks before they are fully validated (-cmpctblockfastforward) */
+extern bool g_cmpctblock_fast_forward;
 
 class PeerLogicValidation final : public CValidationInterface, public NetEventsInterface {
 private:
@@ -92,6 +96,6 @@ struct CNodeStateStats {
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 
 /** Relay transaction to every node */
-void RelayTransaction(const uint256&, const CConnman& connman);
+void RelayTransaction(const uint256&, const CTxMemPool& mempool);
 
 #endif // BITCOIN_NET_PROCESSING_H
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <netaddress.h>
+#include <crypto/siphash.h>
 #include <hash.h>
 #include <util/strencodings.h>
 #include <util/asmap.h>
@@ -485,11 +486,15 @@ uint32_t CNetAddr::GetMappedAS(const std::vector<bool> &asmap) const {
  */
 std::vector<unsigned char> CNetAddr::GetGroup(const std::vector<bool> &asmap) const
 {
-    std::vector<unsigned char> vchRet;
-    uint32_t net_class = GetNetClass();
     // If non-empty asmap is supplied and the address is IPv4/IPv6,
     // return ASN to be used for bucketing.
-    uint32_t asn = GetMappedAS(asmap);
+    return GetGroupForAS(GetMappedAS(asmap));
+}
+
+std::vector<unsigned char> CNetAddr::GetGroupForAS(uint32_t asn) const
+{
+    std::vector<unsigned char> vchRet;
+    uint32_t net_class = GetNetClass();
     if (asn != 0) { // Either asmap was empty, or address has non-asmappable net class (e.g. TOR).
         vchRet.push_back(NET_IPV6); // IPv4 and IPv6 with same ASN should be in the same bucket
         for (int i = 0; i < 4; i++) {
@@ -551,6 +556,11 @@ uint64_t CNetAddr::GetHash() const
     return nRet;
 }
 
+uint64_t CNetAddr::GetSaltedHash(uint64_t k0, uint64_t k1) const
+{
+    return CSipHasher(k0, k1).Write(ip, sizeof(ip)).Finalize();
+}
+
 // private extensions to enum Network, only returned by GetExtNetwork,
 // and only used in GetReachabilityFrom
 static const int NET_UNKNOWN = NET_MAX + 0;
@@ -885,6 +895,23 @@ bool CSubNet::IsValid() const
     return valid;
 }
 
+int CSubNet::GetPrefixLength() const
+{
+    int n = 0;
+    int len = 0;
+    for (; n < 16 && netmask[n] == 0xff; ++n)
+        len += 8;
+    if (n < 16) {
+        int bits = NetmaskBits(netmask[n]);
+        if (bits < 0) return -1;
+        len += bits;
+        ++n;
+    }
+    for (; n < 16; ++n)
+        if (netmask[n] != 0x00) return -1;
+    return len;
+}
+
 bool operator==(const CSubNet& a, const CSubNet& b)
 {
     return a.valid == b.valid && a.network == b.network && !memcmp(a.netmask, b.netmask, 16);
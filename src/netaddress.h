@@ -76,6 +76,8 @@ class CNetAddr
         std::string ToStringIP() const;
         unsigned int GetByte(int n) const;
         uint64_t GetHash() const;
+        //! SipHash of the address with the given key, for hash tables that peers can fill
+        uint64_t GetSaltedHash(uint64_t k0, uint64_t k1) const;
         bool GetInAddr(struct in_addr* pipv4Addr) const;
         uint32_t GetNetClass() const;
 
@@ -90,6 +92,8 @@ class CNetAddr
         uint32_t GetMappedAS(const std::vector<bool> &asmap) const;
 
         std::vector<unsigned char> GetGroup(const std::vector<bool> &asmap) const;
+        //! The network group GetGroup() returns for an address mapped to the given AS (0 if not mapped)
+        std::vector<unsigned char> GetGroupForAS(uint32_t mapped_as) const;
         std::vector<unsigned char> GetAddrBytes() const { return {std::begin(ip), std::end(ip)}; }
         int GetReachabilityFrom(const CNetAddr *paddrPartner = nullptr) const;
 
@@ -133,6 +137,15 @@ class CSubNet
         std::string ToString() const;
         bool IsValid() const;
 
+        /** The network (base) address, masked by the netmask */
+        const CNetAddr& GetNetwork() const { return network; }
+        /**
+         * @returns The number of leading 1-bits of the netmask, counted over
+         *          the whole 16-byte address (so 96 + n for an IPv4 /n). If
+         *          the netmask is not of the form 1{n}0{128-n}, -1.
+         */
+        int GetPrefixLength() const;
+
         friend bool operator==(const CSubNet& a, const CSubNet& b);
         friend bool operator!=(const CSubNet& a, const CSubNet& b) { return !(a == b); }
         friend bool operator<(const CSubNet& a, const CSubNet& b);
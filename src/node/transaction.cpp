@@ -78,7 +78,7 @@ TransactionError BroadcastTransaction(NodeContext& node, const CTransactionRef t
     }
 
     if (relay) {
-        RelayTransaction(hashTx, *node.connman);
+        RelayTransaction(hashTx, *node.mempool);
     }
 
     return TransactionError::OK;
@@ -12,6 +12,9 @@
 
 static constexpr double INF_FEERATE = 1e99;
 
+/** Fold the pending decay of a TxConfirmStats into its stored averages once it drops below this */
+static constexpr double MIN_PENDING_DECAY = 1e-20;
+
 std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
     static const std::map<FeeEstimateHorizon, std::string> horizon_strings = {
         {FeeEstimateHorizon::SHORT_HALFLIFE, "short"},
@@ -32,6 +35,11 @@ std::string StringForFeeEstimateHorizon(FeeEstimateHorizon horizon) {
  *
  * The tracking of unconfirmed (mempool) transactions is completely independent of the
  * historical tracking of transactions that have been confirmed in a block.
+ *
+ * All two-dimensional counters are stored row-major in a single contiguous
+ * vector, indexed by Index(Y, X). The moving averages are decayed lazily: the
+ * stored values have to be multiplied by m_pending_decay to obtain the actual
+ * averages, and new data points are scaled up by its inverse when recorded.
  */
 class TxConfirmStats
 {
@@ -40,6 +48,12 @@ private:
     const std::vector<double>& buckets;              // The upper-bound of the range for the bucket (inclusive)
     const std::map<double, unsigned int>& bucketMap; // Map of bucket upper-bound to index into all vectors by bucket
 
+    // Number of buckets tracked by all the vectors below
+    size_t m_num_buckets;
+
+    // Number of periods tracked by confAvg and failAvg
+    unsigned int m_max_periods;
+
     // For each bucket X:
     // Count the total # of txs in each bucket
     // Track the historical moving average of this total over blocks
@@ -47,11 +61,11 @@ private:
 
     // Count the total # of txs confirmed within Y blocks in each bucket
     // Track the historical moving average of these totals over blocks
-    std::vector<std::vector<double>> confAvg; // confAvg[Y][X]
+    std::vector<double> confAvg; // confAvg[Y][X]
 
     // Track moving avg of txs which have been evicted from the mempool
     // after failing to be confirmed within Y blocks
-    std::vector<std::vector<double>> failAvg; // failAvg[Y][X]
+    std::vector<double> failAvg; // failAvg[Y][X]
 
     // Sum the total feerate of all tx's in each bucket
     // Track the historical moving average of this total over blocks
@@ -62,18 +76,30 @@ private:
 
     double decay;
 
+    // Decay that has not been applied to the stored averages yet
+    double m_pending_decay;
+
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
     // Mempool counts of outstanding transactions
     // For each bucket X, track the number of transactions in the mempool
     // that are unconfirmed for each possible confirmation value Y
-    std::vector<std::vector<int> > unconfTxs;  //unconfTxs[Y][X]
+    std::vector<int> unconfTxs;  //unconfTxs[Y][X]
     // transactions still unconfirmed after GetMaxConfirms for each bucket
     std::vector<int> oldUnconfTxs;
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /** Position of [Y][X] in the flattened two-dimensional vectors */
+    size_t Index(unsigned int y, unsigned int x) const { return y * m_num_buckets + x; }
+
+    /** Multiply the pending decay into the stored averages */
+    void ApplyPendingDecay();
+
+    /** Convert a flattened [Y][X] moving average into actual (decayed) values per Y */
+    std::vector<std::vector<double>> UnflattenAvg(const std::vector<double>& flat) const;
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -123,7 +149,7 @@ public:
                              EstimationResult *result = nullptr) const;
 
     /** Return the max number of confirms we're tracking */
-    unsigned int GetMaxConfirms() const { return scale * confAvg.size(); }
+    unsigned int GetMaxConfirms() const { return scale * m_max_periods; }
 
     /** Write state of estimation data to a file*/
     void Write(CAutoFile& fileout) const;
@@ -142,38 +168,33 @@ TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
     : buckets(defaultBuckets), bucketMap(defaultBucketMap)
 {
     decay = _decay;
+    m_pending_decay = 1;
     assert(_scale != 0 && "_scale must be non-zero");
     scale = _scale;
-    confAvg.resize(maxPeriods);
-    for (unsigned int i = 0; i < maxPeriods; i++) {
-        confAvg[i].resize(buckets.size());
-    }
-    failAvg.resize(maxPeriods);
-    for (unsigned int i = 0; i < maxPeriods; i++) {
-        failAvg[i].resize(buckets.size());
-    }
+    m_num_buckets = buckets.size();
+    m_max_periods = maxPeriods;
+    confAvg.assign(m_max_periods * m_num_buckets, 0);
+    failAvg.assign(m_max_periods * m_num_buckets, 0);
 
-    txCtAvg.resize(buckets.size());
-    avg.resize(buckets.size());
+    txCtAvg.resize(m_num_buckets);
+    avg.resize(m_num_buckets);
 
-    resizeInMemoryCounters(buckets.size());
+    resizeInMemoryCounters(m_num_buckets);
 }
 
 void TxConfirmStats::resizeInMemoryCounters(size_t newbuckets) {
     // newbuckets must be passed in because the buckets referred to during Read have not been updated yet.
-    unconfTxs.resize(GetMaxConfirms());
-    for (unsigned int i = 0; i < unconfTxs.size(); i++) {
-        unconfTxs[i].resize(newbuckets);
-    }
-    oldUnconfTxs.resize(newbuckets);
+    unconfTxs.assign(GetMaxConfirms() * newbuckets, 0);
+    oldUnconfTxs.assign(newbuckets, 0);
 }
 
 // Roll the unconfirmed txs circular buffer
 void TxConfirmStats::ClearCurrent(unsigned int nBlockHeight)
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        oldUnconfTxs[j] += unconfTxs[nBlockHeight%unconfTxs.size()][j];
-        unconfTxs[nBlockHeight%unconfTxs.size()][j] = 0;
+    const unsigned int blockIndex = nBlockHeight % GetMaxConfirms();
+    for (unsigned int j = 0; j < m_num_buckets; j++) {
+        oldUnconfTxs[j] += unconfTxs[Index(blockIndex, j)];
+        unconfTxs[Index(blockIndex, j)] = 0;
     }
 }
 
@@ -185,25 +206,44 @@ void TxConfirmStats::Record(int blocksToConfirm, double val)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1)/scale;
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+    // Undo the decay which will be applied to the stored value when it is read
+    const double weight = 1 / m_pending_decay;
+    for (size_t i = periodsToConfirm; i <= m_max_periods; i++) {
+        confAvg[Index(i - 1, bucketindex)] += weight;
     }
-    txCtAvg[bucketindex]++;
-    avg[bucketindex] += val;
+    txCtAvg[bucketindex] += weight;
+    avg[bucketindex] += val * weight;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
 {
-    for (unsigned int j = 0; j < buckets.size(); j++) {
-        for (unsigned int i = 0; i < confAvg.size(); i++)
-            confAvg[i][j] = confAvg[i][j] * decay;
-        for (unsigned int i = 0; i < failAvg.size(); i++)
-            failAvg[i][j] = failAvg[i][j] * decay;
-        avg[j] = avg[j] * decay;
-        txCtAvg[j] = txCtAvg[j] * decay;
+    // Only touch every bucket once the stored values start growing large
+    m_pending_decay *= decay;
+    if (m_pending_decay < MIN_PENDING_DECAY) {
+        ApplyPendingDecay();
     }
 }
 
+void TxConfirmStats::ApplyPendingDecay()
+{
+    for (double& v : confAvg) v *= m_pending_decay;
+    for (double& v : failAvg) v *= m_pending_decay;
+    for (double& v : avg) v *= m_pending_decay;
+    for (double& v : txCtAvg) v *= m_pending_decay;
+    m_pending_decay = 1;
+}
+
+std::vector<std::vector<double>> TxConfirmStats::UnflattenAvg(const std::vector<double>& flat) const
+{
+    std::vector<std::vector<double>> ret(m_max_periods, std::vector<double>(m_num_buckets));
+    for (unsigned int i = 0; i < m_max_periods; i++) {
+        for (unsigned int j = 0; j < m_num_buckets; j++) {
+            ret[i][j] = flat[Index(i, j)] * m_pending_decay;
+        }
+    }
+    return ret;
+}
+
 // returns -1 on error conditions
 double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
                                          double successBreakPoint, bool requireGreater,
@@ -215,6 +255,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     int extraNum = 0;  // Number of tx's still in mempool for confTarget or longer
     double failNum = 0; // Number of tx's that were never confirmed but removed from the mempool after confTarget
     int periodTarget = (confTarget + scale - 1)/scale;
+    const double pending_decay = m_pending_decay;
 
     int maxbucketindex = buckets.size() - 1;
 
@@ -236,7 +277,7 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int bestFarBucket = startbucket;
 
     bool foundAnswer = false;
-    unsigned int bins = unconfTxs.size();
+    unsigned int bins = GetMaxConfirms();
     bool newBucketRange = true;
     bool passing = true;
     EstimatorBucket passBucket;
@@ -249,11 +290,11 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
-        for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
-            extraNum += unconfTxs[(nBlockHeight - confct)%bins][bucket];
+        nConf += confAvg[Index(periodTarget - 1, bucket)] * pending_decay;
+        totalNum += txCtAvg[bucket] * pending_decay;
+        failNum += failAvg[Index(periodTarget - 1, bucket)] * pending_decay;
+        for (unsigned int confct = confTarget; confct < bins; confct++)
+            extraNum += unconfTxs[Index((nBlockHeight - confct)%bins, bucket)];
         extraNum += oldUnconfTxs[bucket];
         // If we have enough transaction data points in this range of buckets,
         // we can test for success
@@ -309,14 +350,15 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
     unsigned int minBucket = std::min(bestNearBucket, bestFarBucket);
     unsigned int maxBucket = std::max(bestNearBucket, bestFarBucket);
     for (unsigned int j = minBucket; j <= maxBucket; j++) {
-        txSum += txCtAvg[j];
+        txSum += txCtAvg[j] * pending_decay;
     }
     if (foundAnswer && txSum != 0) {
         txSum = txSum / 2;
         for (unsigned int j = minBucket; j <= maxBucket; j++) {
-            if (txCtAvg[j] < txSum)
-                txSum -= txCtAvg[j];
+            if (txCtAvg[j] * pending_decay < txSum)
+                txSum -= txCtAvg[j] * pending_decay;
             else { // we're in the right bucket
+                // Both averages carry the same pending decay, which cancels out
                 median = avg[j] / txCtAvg[j];
                 break;
             }
@@ -359,12 +401,16 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
 
 void TxConfirmStats::Write(CAutoFile& fileout) const
 {
+    std::vector<double> avg_actual(avg), txct_actual(txCtAvg);
+    for (double& v : avg_actual) v *= m_pending_decay;
+    for (double& v : txct_actual) v *= m_pending_decay;
+
     fileout << decay;
     fileout << scale;
-    fileout << avg;
-    fileout << txCtAvg;
-    fileout << confAvg;
-    fileout << failAvg;
+    fileout << avg_actual;
+    fileout << txct_actual;
+    fileout << UnflattenAvg(confAvg);
+    fileout << UnflattenAvg(failAvg);
 }
 
 void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -392,29 +438,43 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
     if (txCtAvg.size() != numBuckets) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in tx count bucket count");
     }
-    filein >> confAvg;
-    maxPeriods = confAvg.size();
+    std::vector<std::vector<double>> fileConfAvg;
+    filein >> fileConfAvg;
+    maxPeriods = fileConfAvg.size();
     maxConfirms = scale * maxPeriods;
 
     if (maxConfirms <= 0 || maxConfirms > 6 * 24 * 7) { // one week
         throw std::runtime_error("Corrupt estimates file.  Must maintain estimates for between 1 and 1008 (one week) confirms");
     }
     for (unsigned int i = 0; i < maxPeriods; i++) {
-        if (confAvg[i].size() != numBuckets) {
+        if (fileConfAvg[i].size() != numBuckets) {
             throw std::runtime_error("Corrupt estimates file. Mismatch in feerate conf average bucket count");
         }
     }
 
-    filein >> failAvg;
-    if (maxPeriods != failAvg.size()) {
+    std::vector<std::vector<double>> fileFailAvg;
+    filein >> fileFailAvg;
+    if (maxPeriods != fileFailAvg.size()) {
         throw std::runtime_error("Corrupt estimates file. Mismatch in confirms tracked for failures");
     }
     for (unsigned int i = 0; i < maxPeriods; i++) {
-        if (failAvg[i].size() != numBuckets) {
+        if (fileFailAvg[i].size() != numBuckets) {
             throw std::runtime_error("Corrupt estimates file. Mismatch in one of failure average bucket counts");
         }
     }
 
+    m_num_buckets = numBuckets;
+    m_max_periods = maxPeriods;
+    m_pending_decay = 1;
+    confAvg.clear();
+    failAvg.clear();
+    confAvg.reserve(maxPeriods * numBuckets);
+    failAvg.reserve(maxPeriods * numBuckets);
+    for (unsigned int i = 0; i < maxPeriods; i++) {
+        confAvg.insert(confAvg.end(), fileConfAvg[i].begin(), fileConfAvg[i].end());
+        failAvg.insert(failAvg.end(), fileFailAvg[i].begin(), fileFailAvg[i].end());
+    }
+
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
     resizeInMemoryCounters(numBuckets);
@@ -426,8 +486,8 @@ void TxConfirmStats::Read(CAutoFile& filein, int nFileVersion, size_t numBuckets
 unsigned int TxConfirmStats::NewTx(unsigned int nBlockHeight, double val)
 {
     unsigned int bucketindex = bucketMap.lower_bound(val)->second;
-    unsigned int blockIndex = nBlockHeight % unconfTxs.size();
-    unconfTxs[blockIndex][bucketindex]++;
+    unsigned int blockIndex = nBlockHeight % GetMaxConfirms();
+    unconfTxs[Index(blockIndex, bucketindex)]++;
     return bucketindex;
 }
 
@@ -442,7 +502,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         return;  //This can't happen because we call this with our best seen height, no entries can have higher
     }
 
-    if (blocksAgo >= (int)unconfTxs.size()) {
+    if (blocksAgo >= (int)GetMaxConfirms()) {
         if (oldUnconfTxs[bucketindex] > 0) {
             oldUnconfTxs[bucketindex]--;
         } else {
@@ -451,9 +511,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         }
     }
     else {
-        unsigned int blockIndex = entryHeight % unconfTxs.size();
-        if (unconfTxs[blockIndex][bucketindex] > 0) {
-            unconfTxs[blockIndex][bucketindex]--;
+        unsigned int blockIndex = entryHeight % GetMaxConfirms();
+        if (unconfTxs[Index(blockIndex, bucketindex)] > 0) {
+            unconfTxs[Index(blockIndex, bucketindex)]--;
         } else {
             LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error, mempool tx removed from blockIndex=%u,bucketIndex=%u already\n",
                      blockIndex, bucketindex);
@@ -462,8 +522,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
     if (!inBlock && (unsigned int)blocksAgo >= scale) { // Only counts as a failure if not confirmed for entire period
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
-        for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+        const double weight = 1 / m_pending_decay;
+        for (size_t i = 0; i < periodsAgo && i < m_max_periods; i++) {
+            failAvg[Index(i, bucketindex)] += weight;
         }
     }
 }
@@ -482,6 +543,7 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         mapMemPoolTxs.erase(hash);
+        m_smart_fee_cache.clear();
         return true;
     } else {
         return false;
@@ -547,6 +609,8 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex2);
     unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
     assert(bucketIndex == bucketIndex3);
+
+    m_smart_fee_cache.clear();
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
@@ -593,6 +657,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
+    m_smart_fee_cache.clear();
 
     // Update unconfirmed circular buffer
     feeStats->ClearCurrent(nBlockHeight);
@@ -781,11 +846,26 @@ double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget,
  * shortest time horizon which tracks the required target.  Conservative
  * estimates, however, required the 95% threshold at 2 * target be met for any
  * longer time horizons also.
+ *
+ * Answers are memoized per (target, mode) until the estimator's state changes.
  */
 CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
 {
     LOCK(m_cs_fee_estimator);
 
+    const auto key = std::make_pair(confTarget, conservative);
+    auto it = m_smart_fee_cache.find(key);
+    if (it == m_smart_fee_cache.end()) {
+        SmartFeeEstimate estimate;
+        estimate.feerate = estimateSmartFeeUncached(confTarget, &estimate.calc, conservative);
+        it = m_smart_fee_cache.emplace(key, estimate).first;
+    }
+    if (feeCalc) *feeCalc = it->second.calc;
+    return it->second.feerate;
+}
+
+CFeeRate CBlockPolicyEstimator::estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -937,6 +1017,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            m_smart_fee_cache.clear();
         }
     }
     catch (const std::exception& e) {
@@ -251,9 +251,20 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    struct SmartFeeEstimate
+    {
+        CFeeRate feerate;
+        FeeCalculation calc;
+    };
+
+    /** estimateSmartFee answers by (confTarget, conservative), cleared whenever the tracked data changes */
+    mutable std::map<std::pair<int, bool>, SmartFeeEstimate> m_smart_fee_cache GUARDED_BY(m_cs_fee_estimator);
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
+    /** Compute an estimateSmartFee answer without consulting the cache */
+    CFeeRate estimateSmartFeeUncached(int confTarget, FeeCalculation *feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
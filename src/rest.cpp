@@ -6,6 +6,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <httprpc.h>
 #include <httpserver.h>
 #include <index/txindex.h>
 #include <node/context.h>
@@ -27,6 +28,9 @@
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int MAX_BLOCKRANGE_COUNT = 1000; //allow a max of 1000 blocks to be fetched at once
+static const size_t MAX_TXSPENDING_OUTPOINTS = 100; //allow a max of 100 outpoints to be looked up at once
+static const size_t BLOCKUNDO_CHUNK_SIZE = 64 * 1024; //bytes of undo data sent per reply chunk
 
 enum class RetFormat {
     UNDEF,
@@ -262,10 +266,9 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RetFormat::JSON: {
-        UniValue objBlock = blockToJSON(block, tip, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        WriteJSONStreamReply(req, [&](JSONStreamWriter& writer) {
+            WriteBlockJSON(writer, block, tip, pblockindex, showTxDetails);
+        });
         return true;
     }
 
@@ -285,6 +288,134 @@ static bool rest_block_notxdetails(HTTPRequest* req, const std::string& strURIPa
     return rest_block(req, strURIPart, false);
 }
 
+/**
+ * Read a block the way REST serves it in binary: straight from the block
+ * file, unless -rpcserialversion asks for it without witness data.
+ */
+static bool ReadRESTBlock(std::vector<uint8_t>& data, const CBlockIndex* pindex)
+{
+    if (RPCSerializationFlags() == 0) {
+        return ReadRawBlockFromDisk(data, pindex, Params().MessageStart());
+    }
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) return false;
+    data.clear();
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), data, 0) << block;
+    return true;
+}
+
+static bool rest_blockrange(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block range specified. Use /rest/blockrange/<start>/<count>.<ext>.");
+
+    int32_t start;
+    if (!ParseInt32(path[0], &start) || start < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(path[0]));
+
+    int32_t count;
+    if (!ParseInt32(path[1], &count) || count < 1 || count > MAX_BLOCKRANGE_COUNT)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + SanitizeString(path[1]));
+
+    if (rf != RetFormat::BINARY && rf != RetFormat::HEX)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+
+    std::vector<const CBlockIndex*> blocks;
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = ::ChainActive();
+        if (start > active_chain.Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        const int end = std::min(active_chain.Height(), start + count - 1);
+        blocks.reserve(end - start + 1);
+        for (int height = start; height <= end; ++height) {
+            const CBlockIndex* pindex = active_chain[height];
+            if (IsBlockPruned(pindex))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            blocks.push_back(pindex);
+        }
+    }
+
+    // Read the first block before the reply starts, so that failing to is
+    // still reported as an error.
+    std::vector<uint8_t> block;
+    if (!ReadRESTBlock(block, blocks.front()))
+        return RESTERR(req, HTTP_NOT_FOUND, blocks.front()->GetBlockHash().GetHex() + " not found");
+
+    req->WriteHeader("Content-Type", rf == RetFormat::BINARY ? "application/octet-stream" : "text/plain");
+    req->StartChunkedReply(HTTP_OK);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        // Past the first block the status is already sent, and a block that
+        // can't be read ends the reply early. Clients see the short count.
+        // The next block is read while the previous one is being sent, and
+        // sending stops if the client doesn't keep up.
+        if (i > 0 && !ReadRESTBlock(block, blocks[i])) break;
+        const bool sent = rf == RetFormat::BINARY ?
+            req->WriteReplyChunk(MakeSpan(static_cast<const std::vector<uint8_t>&>(block))) :
+            req->WriteReplyChunk(HexStr(block.begin(), block.end()));
+        if (!sent) break;
+    }
+    if (rf == RetFormat::HEX) req->WriteReplyChunk("\n");
+    req->EndChunkedReply();
+    return true;
+}
+
+static bool rest_blockundo(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string hashStr;
+    const RetFormat rf = ParseDataFormat(hashStr, strURIPart);
+
+    uint256 hash;
+    if (!ParseHashStr(hashStr, hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
+
+    if (rf != RetFormat::BINARY && rf != RetFormat::HEX)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+
+    const CBlockIndex* pblockindex = nullptr;
+    {
+        LOCK(cs_main);
+        pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+
+        if (IsBlockPruned(pblockindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
+
+        // The genesis block and blocks that were never connected have none
+        if (!(pblockindex->nStatus & BLOCK_HAVE_UNDO))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " undo data not available");
+    }
+
+    std::vector<uint8_t> undo;
+    if (!ReadRawUndoFromDisk(undo, pblockindex, Params().MessageStart()))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " undo data not found");
+
+    // Send the undo data in pieces, so that the hex encoding of it is never
+    // held in full and sending stops if the client doesn't keep up.
+    req->WriteHeader("Content-Type", rf == RetFormat::BINARY ? "application/octet-stream" : "text/plain");
+    req->StartChunkedReply(HTTP_OK);
+    for (size_t pos = 0; pos < undo.size(); pos += BLOCKUNDO_CHUNK_SIZE) {
+        const size_t len = std::min(BLOCKUNDO_CHUNK_SIZE, undo.size() - pos);
+        const bool sent = rf == RetFormat::BINARY ?
+            req->WriteReplyChunk(Span<const unsigned char>(undo.data() + pos, len)) :
+            req->WriteReplyChunk(HexStr(undo.begin() + pos, undo.begin() + pos + len));
+        if (!sent) break;
+    }
+    if (rf == RetFormat::HEX) req->WriteReplyChunk("\n");
+    req->EndChunkedReply();
+    return true;
+}
+
 // A bit of a hack - dependency on a function defined in rpc/blockchain.cpp
 UniValue getblockchaininfo(const JSONRPCRequest& request);
 
@@ -311,6 +442,100 @@ static bool rest_chaininfo(HTTPRequest* req, const std::string& strURIPart)
     }
 }
 
+// Dependencies on functions defined in rpc/blockchain.cpp, which also check the indexes they use are ready
+UniValue getaddresshistory(const JSONRPCRequest& request);
+UniValue getaddressutxos(const JSONRPCRequest& request);
+UniValue gettxspendingprevout(const JSONRPCRequest& request);
+
+/** Reply with the JSON result of an RPC call, or its error */
+static bool rest_rpc_json(HTTPRequest* req, const UniValue& params, UniValue (*rpc)(const JSONRPCRequest&))
+{
+    JSONRPCRequest jsonRequest;
+    jsonRequest.params = params;
+    UniValue result;
+    try {
+        result = rpc(jsonRequest);
+    } catch (const UniValue& error) {
+        const int code = find_value(error, "code").get_int();
+        const bool invalid = code == RPC_INVALID_ADDRESS_OR_KEY || code == RPC_INVALID_PARAMETER;
+        return RESTERR(req, invalid ? HTTP_BAD_REQUEST : HTTP_NOT_FOUND, find_value(error, "message").get_str());
+    }
+    std::string strJSON = result.write() + "\n";
+    req->WriteHeader("Content-Type", "application/json");
+    req->WriteReply(HTTP_OK, strJSON);
+    return true;
+}
+
+static bool rest_address_query(HTTPRequest* req, const std::string& strURIPart, UniValue (*rpc)(const JSONRPCRequest&))
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string address;
+    const RetFormat rf = ParseDataFormat(address, strURIPart);
+
+    switch (rf) {
+    case RetFormat::JSON: {
+        UniValue params(UniValue::VARR);
+        params.push_back(address);
+        return rest_rpc_json(req, params, rpc);
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
+static bool rest_addresshistory(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address_query(req, strURIPart, getaddresshistory);
+}
+
+static bool rest_addressutxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    return rest_address_query(req, strURIPart, getaddressutxos);
+}
+
+static bool rest_txspending(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    std::vector<std::string> uriParts;
+    boost::split(uriParts, param, boost::is_any_of("/"));
+    if (param.empty() || uriParts.empty())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Error: empty request");
+    if (uriParts.size() > MAX_TXSPENDING_OUTPOINTS)
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Error: max outpoints exceeded (max: %d, tried: %d)", MAX_TXSPENDING_OUTPOINTS, uriParts.size()));
+
+    UniValue outputs(UniValue::VARR);
+    for (const std::string& part : uriParts) {
+        int32_t nOutput;
+        std::string strTxid = part.substr(0, part.find('-'));
+        std::string strOutput = part.substr(part.find('-') + 1);
+
+        if (!ParseInt32(strOutput, &nOutput) || !IsHex(strTxid))
+            return RESTERR(req, HTTP_BAD_REQUEST, "Parse error");
+
+        UniValue output(UniValue::VOBJ);
+        output.pushKV("txid", strTxid);
+        output.pushKV("vout", nOutput);
+        outputs.push_back(output);
+    }
+
+    switch (rf) {
+    case RetFormat::JSON: {
+        UniValue params(UniValue::VARR);
+        params.push_back(outputs);
+        return rest_rpc_json(req, params, gettxspendingprevout);
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
+    }
+    }
+}
+
 static bool rest_mempool_info(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -345,11 +570,9 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RetFormat::JSON: {
-        UniValue mempoolObject = MempoolToJSON(*mempool, true);
-
-        std::string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        WriteJSONStreamReply(req, [mempool](JSONStreamWriter& writer) {
+            WriteMempoolJSON(writer, *mempool);
+        });
         return true;
     }
     default: {
@@ -653,11 +876,16 @@ static const struct {
       {"/rest/tx/", rest_tx},
       {"/rest/block/notxdetails/", rest_block_notxdetails},
       {"/rest/block/", rest_block_extended},
+      {"/rest/blockrange/", rest_blockrange},
+      {"/rest/blockundo/", rest_blockundo},
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/addresshistory/", rest_addresshistory},
+      {"/rest/addressutxos/", rest_addressutxos},
+      {"/rest/txspending/", rest_txspending},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
 };
 
@@ -0,0 +1,106 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/blockcache.h>
+
+#include <chain.h>
+#include <memusage.h>
+#include <primitives/block.h>
+
+#include <univalue.h>
+
+std::unique_ptr<BlockJSONCache> g_block_json_cache;
+
+static size_t StringDynamicUsage(const std::string& s)
+{
+    // Short strings are stored inline by common implementations
+    return s.capacity() > 15 ? memusage::MallocUsage(s.capacity() + 1) : 0;
+}
+
+size_t UniValueDynamicUsage(const UniValue& value)
+{
+    size_t usage = StringDynamicUsage(value.getValStr());
+    if (value.isObject()) {
+        const std::vector<std::string>& keys = value.getKeys();
+        usage += memusage::MallocUsage(keys.capacity() * sizeof(std::string));
+        for (const std::string& key : keys) {
+            usage += StringDynamicUsage(key);
+        }
+    }
+    if (value.isObject() || value.isArray()) {
+        const std::vector<UniValue>& values = value.getValues();
+        usage += memusage::MallocUsage(values.capacity() * sizeof(UniValue));
+        for (const UniValue& child : values) {
+            usage += UniValueDynamicUsage(child);
+        }
+    }
+    return usage;
+}
+
+std::shared_ptr<const UniValue> BlockJSONCache::Get(const uint256& block_hash, Kind kind)
+{
+    LOCK(m_mutex);
+    const auto it = m_index.find(Key(block_hash, kind));
+    if (it == m_index.end()) return nullptr;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->value;
+}
+
+std::shared_ptr<const UniValue> BlockJSONCache::Put(const uint256& block_hash, Kind kind, UniValue value)
+{
+    // Account for the list and map nodes as well
+    const size_t usage = UniValueDynamicUsage(value) + memusage::MallocUsage(sizeof(UniValue)) +
+        memusage::MallocUsage(sizeof(Entry) + 2 * sizeof(void*)) +
+        memusage::MallocUsage(sizeof(std::pair<const Key, EntryList::iterator>) + 4 * sizeof(void*));
+    auto shared_value = std::make_shared<const UniValue>(std::move(value));
+
+    LOCK(m_mutex);
+    const Key key(block_hash, kind);
+    const auto it = m_index.find(key);
+    if (it != m_index.end()) EraseEntry(it->second);
+    if (usage > m_max_usage) return shared_value;
+
+    while (m_usage + usage > m_max_usage) {
+        EraseEntry(std::prev(m_entries.end()));
+    }
+    m_entries.push_front(Entry{key, shared_value, usage});
+    m_index.emplace(key, m_entries.begin());
+    m_usage += usage;
+    return shared_value;
+}
+
+void BlockJSONCache::Erase(const uint256& block_hash)
+{
+    LOCK(m_mutex);
+    auto it = m_index.lower_bound(Key(block_hash, Kind::BLOCK_TXIDS));
+    while (it != m_index.end() && it->first.first == block_hash) {
+        // EraseEntry() erases the index entry too
+        EraseEntry((it++)->second);
+    }
+}
+
+void BlockJSONCache::EraseEntry(EntryList::iterator it)
+{
+    AssertLockHeld(m_mutex);
+    m_usage -= it->usage;
+    m_index.erase(it->key);
+    m_entries.erase(it);
+}
+
+size_t BlockJSONCache::Size() const
+{
+    LOCK(m_mutex);
+    return m_entries.size();
+}
+
+size_t BlockJSONCache::DynamicMemoryUsage() const
+{
+    LOCK(m_mutex);
+    return m_usage;
+}
+
+void BlockJSONCache::BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex)
+{
+    Erase(pindex->GetBlockHash());
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_BLOCKCACHE_H
+#define BITCOIN_RPC_BLOCKCACHE_H
+
+#include <sync.h>
+#include <uint256.h>
+#include <validationinterface.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+
+class UniValue;
+
+/** Default for -rpcblockcachesize, in MiB */
+static const int64_t DEFAULT_RPC_BLOCK_CACHE_SIZE = 32;
+
+/** Estimated memory usage of a UniValue, including everything it owns */
+size_t UniValueDynamicUsage(const UniValue& value);
+
+/**
+ * Least recently used cache of the JSON that RPC calls compute from a
+ * block's data on disk, keyed by block hash.
+ *
+ * Only what doesn't depend on the active chain is cached, so entries stay
+ * valid as the tip moves. Entries of a block are dropped when it is
+ * disconnected. The total estimated memory usage of the cached values is
+ * kept below the limit by evicting the least recently used ones.
+ */
+class BlockJSONCache final : public CValidationInterface
+{
+public:
+    enum class Kind : uint8_t {
+        BLOCK_TXIDS, //!< getblock with verbosity 1
+        BLOCK_TXS,   //!< getblock with verbosity 2
+        BLOCK_STATS, //!< getblockstats
+    };
+
+    explicit BlockJSONCache(size_t max_usage) : m_max_usage(max_usage) {}
+
+    /** The cached value, or null if there is none */
+    std::shared_ptr<const UniValue> Get(const uint256& block_hash, Kind kind);
+    /** Cache a value, replacing any value cached for the same block and kind */
+    std::shared_ptr<const UniValue> Put(const uint256& block_hash, Kind kind, UniValue value);
+    /** Drop all values cached for a block */
+    void Erase(const uint256& block_hash);
+
+    size_t Size() const;
+    size_t DynamicMemoryUsage() const;
+    /** Values estimated to use more than this are never cached */
+    size_t MaxUsage() const { return m_max_usage; }
+
+protected:
+    // CValidationInterface
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex) override;
+
+private:
+    using Key = std::pair<uint256, Kind>;
+    struct Entry {
+        Key key;
+        std::shared_ptr<const UniValue> value;
+        size_t usage;
+    };
+    using EntryList = std::list<Entry>;
+
+    void EraseEntry(EntryList::iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    const size_t m_max_usage;
+    mutable Mutex m_mutex;
+    //! Most recently used first
+    EntryList m_entries GUARDED_BY(m_mutex);
+    std::map<Key, EntryList::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_usage GUARDED_BY(m_mutex){0};
+};
+
+/** Cache used by getblock and getblockstats, null if disabled */
+extern std::unique_ptr<BlockJSONCache> g_block_json_cache;
+
+#endif // BITCOIN_RPC_BLOCKCACHE_H
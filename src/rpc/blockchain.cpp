@@ -13,7 +13,11 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/addrindex.h>
 #include <index/blockfilterindex.h>
+#include <index/scriptindex.h>
+#include <index/spentindex.h>
+#include <key_io.h>
 #include <node/coinstats.h>
 #include <node/context.h>
 #include <node/utxo_snapshot.h>
@@ -21,6 +25,8 @@
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/blockcache.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
@@ -40,8 +46,10 @@
 #include <univalue.h>
 
 #include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <thread>
 
 struct CUpdatedBlock
 {
@@ -125,40 +133,26 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+/** The fields of a block for getblock and REST, with "tx" left null */
+static UniValue blockFieldsToJSON(int stripped_size, int size, int weight, const CBlockIndex* tip, const CBlockIndex* blockindex)
 {
-    // Serialize passed information without accessing chain state of the active chain!
-    AssertLockNotHeld(cs_main); // For performance reasons
-
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", blockindex->GetBlockHash().GetHex());
     const CBlockIndex* pnext;
     int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
     result.pushKV("confirmations", confirmations);
-    result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
-    result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
-    result.pushKV("weight", (int)::GetBlockWeight(block));
+    result.pushKV("strippedsize", stripped_size);
+    result.pushKV("size", size);
+    result.pushKV("weight", weight);
     result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("versionHex", strprintf("%08x", block.nVersion));
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    UniValue txs(UniValue::VARR);
-    for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
-    result.pushKV("tx", txs);
-    result.pushKV("time", block.GetBlockTime());
+    result.pushKV("version", blockindex->nVersion);
+    result.pushKV("versionHex", strprintf("%08x", blockindex->nVersion));
+    result.pushKV("merkleroot", blockindex->hashMerkleRoot.GetHex());
+    result.pushKV("tx", NullUniValue);
+    result.pushKV("time", blockindex->GetBlockTime());
     result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
-    result.pushKV("nonce", (uint64_t)block.nNonce);
-    result.pushKV("bits", strprintf("%08x", block.nBits));
+    result.pushKV("nonce", (uint64_t)blockindex->nNonce);
+    result.pushKV("bits", strprintf("%08x", blockindex->nBits));
     result.pushKV("difficulty", GetDifficulty(blockindex));
     result.pushKV("chainwork", blockindex->nChainWork.GetHex());
     result.pushKV("nTx", (uint64_t)blockindex->nTx);
@@ -170,6 +164,100 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
     return result;
 }
 
+static UniValue blockFieldsToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex)
+{
+    return blockFieldsToJSON(::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS),
+        ::GetSerializeSize(block, PROTOCOL_VERSION), ::GetBlockWeight(block), tip, blockindex);
+}
+
+static UniValue blockTxToJSON(const CTransaction& tx, bool txDetails)
+{
+    if (!txDetails) return tx.GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToUniv(tx, uint256(), objTx, true, RPCSerializationFlags());
+    return objTx;
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    // Serialize passed information without accessing chain state of the active chain!
+    AssertLockNotHeld(cs_main); // For performance reasons
+
+    UniValue result = blockFieldsToJSON(block, tip, blockindex);
+    UniValue txs(UniValue::VARR);
+    for(const auto& tx : block.vtx)
+    {
+        txs.push_back(blockTxToJSON(*tx, txDetails));
+    }
+    result.pushKV("tx", std::move(txs));
+    return result;
+}
+
+/** Write the fields of a block, calling write_txs for the value of "tx" */
+static void WriteBlockFieldsJSON(JSONStreamWriter& writer, const UniValue& fields, const std::function<void()>& write_txs)
+{
+    writer.BeginObject();
+    for (size_t i = 0; i < fields.size(); ++i) {
+        const std::string& key = fields.getKeys()[i];
+        writer.Key(key);
+        if (key != "tx") {
+            writer.Value(fields.getValues()[i]);
+            continue;
+        }
+        writer.BeginArray();
+        write_txs();
+        writer.EndArray();
+    }
+    writer.EndObject();
+}
+
+void WriteBlockJSON(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    AssertLockNotHeld(cs_main);
+
+    WriteBlockFieldsJSON(writer, blockFieldsToJSON(block, tip, blockindex), [&] {
+        for (const auto& tx : block.vtx) {
+            writer.Value(blockTxToJSON(*tx, txDetails));
+        }
+    });
+}
+
+/** The part of a block's JSON that doesn't depend on the active chain, as kept by g_block_json_cache */
+static UniValue blockDataToJSON(const CBlock& block, bool txDetails)
+{
+    UniValue txs(UniValue::VARR);
+    for (const auto& tx : block.vtx) {
+        txs.push_back(blockTxToJSON(*tx, txDetails));
+    }
+    UniValue data(UniValue::VOBJ);
+    data.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    data.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
+    data.pushKV("weight", (int)::GetBlockWeight(block));
+    data.pushKV("tx", std::move(txs));
+    return data;
+}
+
+/** Rough memory usage of blockDataToJSON()'s result, without building it.
+ *  With txDetails every input and output becomes an object of its own, and
+ *  scripts are given both as hex and as asm. */
+static size_t EstimateBlockDataUsage(const CBlock& block, bool txDetails)
+{
+    size_t usage = 0;
+    for (const auto& tx : block.vtx) {
+        if (txDetails) {
+            usage += 2048 + 1280 * (tx->vin.size() + tx->vout.size()) + 4 * tx->GetTotalSize();
+        } else {
+            usage += 256;
+        }
+    }
+    return usage;
+}
+
+static UniValue blockFieldsToJSON(const UniValue& data, const CBlockIndex* tip, const CBlockIndex* blockindex)
+{
+    return blockFieldsToJSON(data["strippedsize"].get_int(), data["size"].get_int(), data["weight"].get_int(), tip, blockindex);
+}
+
 static UniValue getblockcount(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblockcount",
@@ -492,6 +580,45 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
     }
 }
 
+/** Number of mempool entries converted per acquisition of pool.cs */
+static const size_t MEMPOOL_JSON_BATCH = 1000;
+
+void WriteMempoolJSON(JSONStreamWriter& writer, const CTxMemPool& pool)
+{
+    // Writing may block on a slow client, so the entries are converted in
+    // batches under pool.cs and written with the lock released. Transactions
+    // that leave the mempool in between are skipped.
+    std::vector<uint256> vtxid;
+    {
+        LOCK(pool.cs);
+        vtxid.reserve(pool.mapTx.size());
+        for (const CTxMemPoolEntry& e : pool.mapTx) {
+            vtxid.push_back(e.GetTx().GetHash());
+        }
+    }
+
+    writer.BeginObject();
+    std::vector<std::pair<std::string, UniValue>> batch;
+    for (size_t start = 0; start < vtxid.size(); start += MEMPOOL_JSON_BATCH) {
+        const size_t end = std::min(vtxid.size(), start + MEMPOOL_JSON_BATCH);
+        batch.clear();
+        {
+            LOCK(pool.cs);
+            for (size_t i = start; i < end; ++i) {
+                const auto it = pool.mapTx.find(vtxid[i]);
+                if (it == pool.mapTx.end()) continue;
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(pool, info, *it);
+                batch.emplace_back(vtxid[i].ToString(), std::move(info));
+            }
+        }
+        for (const auto& entry : batch) {
+            writer.KeyValue(entry.first, entry.second);
+        }
+    }
+    writer.EndObject();
+}
+
 static UniValue getrawmempool(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getrawmempool",
@@ -522,6 +649,12 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
+    if (fVerbose && request.result_writer) {
+        const CTxMemPool& pool = EnsureMemPool();
+        *request.result_writer = [&pool](JSONStreamWriter& writer) { WriteMempoolJSON(writer, pool); };
+        return NullUniValue;
+    }
+
     return MempoolToJSON(EnsureMemPool(), fVerbose);
 }
 
@@ -871,6 +1004,9 @@ static UniValue getblock(const JSONRPCRequest& request)
             verbosity = request.params[1].get_bool() ? 1 : 0;
     }
 
+    const bool tx_details = verbosity >= 2;
+    const BlockJSONCache::Kind cache_kind = tx_details ? BlockJSONCache::Kind::BLOCK_TXS : BlockJSONCache::Kind::BLOCK_TXIDS;
+    std::shared_ptr<const UniValue> data;
     CBlock block;
     const CBlockIndex* pblockindex;
     const CBlockIndex* tip;
@@ -883,7 +1019,10 @@ static UniValue getblock(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
         }
 
-        block = GetBlockChecked(pblockindex);
+        if (verbosity > 0 && g_block_json_cache && !IsBlockPruned(pblockindex)) {
+            data = g_block_json_cache->Get(hash, cache_kind);
+        }
+        if (!data) block = GetBlockChecked(pblockindex);
     }
 
     if (verbosity <= 0)
@@ -894,7 +1033,38 @@ static UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
-    return blockToJSON(block, tip, pblockindex, verbosity >= 2);
+    if (!data) {
+        // Don't build the whole result for a block the cache can't keep
+        if (!g_block_json_cache || EstimateBlockDataUsage(block, tx_details) > g_block_json_cache->MaxUsage()) {
+            if (tx_details && request.result_writer) {
+                // Write the transactions out one at a time rather than building the
+                // whole result.
+                auto pblock = std::make_shared<const CBlock>(std::move(block));
+                *request.result_writer = [pblock, tip, pblockindex](JSONStreamWriter& writer) {
+                    WriteBlockJSON(writer, *pblock, tip, pblockindex, /* txDetails */ true);
+                };
+                return NullUniValue;
+            }
+            return blockToJSON(block, tip, pblockindex, tx_details);
+        }
+        data = g_block_json_cache->Put(hash, cache_kind, blockDataToJSON(block, tx_details));
+    }
+
+    if (tx_details && request.result_writer) {
+        // Write the cached transactions out without copying them into a result
+        *request.result_writer = [data, tip, pblockindex](JSONStreamWriter& writer) {
+            WriteBlockFieldsJSON(writer, blockFieldsToJSON(*data, tip, pblockindex), [&] {
+                for (const UniValue& tx : (*data)["tx"].getValues()) {
+                    writer.Value(tx);
+                }
+            });
+        };
+        return NullUniValue;
+    }
+
+    UniValue result = blockFieldsToJSON(*data, tip, pblockindex);
+    result.pushKV("tx", (*data)["tx"]);
+    return result;
 }
 
 static UniValue pruneblockchain(const JSONRPCRequest& request)
@@ -1666,105 +1836,9 @@ static inline bool SetHasKeys(const std::set<T>& set, const Tk& key, const Args&
 // outpoint (needed for the utxo index) + nHeight + fCoinBase
 static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
 
-static UniValue getblockstats(const JSONRPCRequest& request)
+/** All statistics of getblockstats, with those not in stats left zero unless it is empty */
+static UniValue BlockStatsToJSON(const CBlockIndex* pindex, const CBlock& block, const CBlockUndo& blockUndo, const std::set<std::string>& stats)
 {
-    RPCHelpMan{"getblockstats",
-                "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
-                "It won't work for some heights with pruning.\n",
-                {
-                    {"hash_or_height", RPCArg::Type::NUM, RPCArg::Optional::NO, "The block hash or height of the target block", "", {"", "string or numeric"}},
-                    {"stats", RPCArg::Type::ARR, /* default */ "all values", "Values to plot (see result below)",
-                        {
-                            {"height", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "Selected statistic"},
-                            {"time", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "Selected statistic"},
-                        },
-                        "stats"},
-                },
-                RPCResult{
-            RPCResult::Type::OBJ, "", "",
-            {
-                {RPCResult::Type::NUM, "avgfee", "Average fee in the block"},
-                {RPCResult::Type::NUM, "avgfeerate", "Average feerate (in satoshis per virtual byte)"},
-                {RPCResult::Type::NUM, "avgtxsize", "Average transaction size"},
-                {RPCResult::Type::STR_HEX, "blockhash", "The block hash (to check for potential reorgs)"},
-                {RPCResult::Type::ARR_FIXED, "feerate_percentiles", "Feerates at the 10th, 25th, 50th, 75th, and 90th percentile weight unit (in satoshis per virtual byte)",
-                {
-                    {RPCResult::Type::NUM, "10th_percentile_feerate", "The 10th percentile feerate"},
-                    {RPCResult::Type::NUM, "25th_percentile_feerate", "The 25th percentile feerate"},
-                    {RPCResult::Type::NUM, "50th_percentile_feerate", "The 50th percentile feerate"},
-                    {RPCResult::Type::NUM, "75th_percentile_feerate", "The 75th percentile feerate"},
-                    {RPCResult::Type::NUM, "90th_percentile_feerate", "The 90th percentile feerate"},
-                }},
-                {RPCResult::Type::NUM, "height", "The height of the block"},
-                {RPCResult::Type::NUM, "ins", "The number of inputs (excluding coinbase)"},
-                {RPCResult::Type::NUM, "maxfee", "Maximum fee in the block"},
-                {RPCResult::Type::NUM, "maxfeerate", "Maximum feerate (in satoshis per virtual byte)"},
-                {RPCResult::Type::NUM, "maxtxsize", "Maximum transaction size"},
-                {RPCResult::Type::NUM, "medianfee", "Truncated median fee in the block"},
-                {RPCResult::Type::NUM, "mediantime", "The block median time past"},
-                {RPCResult::Type::NUM, "mediantxsize", "Truncated median transaction size"},
-                {RPCResult::Type::NUM, "minfee", "Minimum fee in the block"},
-                {RPCResult::Type::NUM, "minfeerate", "Minimum feerate (in satoshis per virtual byte)"},
-                {RPCResult::Type::NUM, "mintxsize", "Minimum transaction size"},
-                {RPCResult::Type::NUM, "outs", "The number of outputs"},
-                {RPCResult::Type::NUM, "subsidy", "The block subsidy"},
-                {RPCResult::Type::NUM, "swtotal_size", "Total size of all segwit transactions"},
-                {RPCResult::Type::NUM, "swtotal_weight", "Total weight of all segwit transactions divided by segwit scale factor (4)"},
-                {RPCResult::Type::NUM, "swtxs", "The number of segwit transactions"},
-                {RPCResult::Type::NUM, "time", "The block time"},
-                {RPCResult::Type::NUM, "total_out", "Total amount in all outputs (excluding coinbase and thus reward [ie subsidy + totalfee])"},
-                {RPCResult::Type::NUM, "total_size", "Total size of all non-coinbase transactions"},
-                {RPCResult::Type::NUM, "total_weight", "Total weight of all non-coinbase transactions divided by segwit scale factor (4)"},
-                {RPCResult::Type::NUM, "totalfee", "The fee total"},
-                {RPCResult::Type::NUM, "txs", "The number of transactions (including coinbase)"},
-                {RPCResult::Type::NUM, "utxo_increase", "The increase/decrease in the number of unspent outputs"},
-                {RPCResult::Type::NUM, "utxo_size_inc", "The increase/decrease in size for the utxo index (not discounting op_return and similar)"},
-            }},
-                RPCExamples{
-                    HelpExampleCli("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
-            + HelpExampleRpc("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
-                },
-    }.Check(request);
-
-    LOCK(cs_main);
-
-    CBlockIndex* pindex;
-    if (request.params[0].isNum()) {
-        const int height = request.params[0].get_int();
-        const int current_tip = ::ChainActive().Height();
-        if (height < 0) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
-        }
-        if (height > current_tip) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
-        }
-
-        pindex = ::ChainActive()[height];
-    } else {
-        const uint256 hash(ParseHashV(request.params[0], "hash_or_height"));
-        pindex = LookupBlockIndex(hash);
-        if (!pindex) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-        }
-        if (!::ChainActive().Contains(pindex)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
-        }
-    }
-
-    CHECK_NONFATAL(pindex != nullptr);
-
-    std::set<std::string> stats;
-    if (!request.params[1].isNull()) {
-        const UniValue stats_univalue = request.params[1].get_array();
-        for (unsigned int i = 0; i < stats_univalue.size(); i++) {
-            const std::string stat = stats_univalue[i].get_str();
-            stats.insert(stat);
-        }
-    }
-
-    const CBlock block = GetBlockChecked(pindex);
-    const CBlockUndo blockUndo = GetUndoChecked(pindex);
-
     const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
     const bool do_mediantxsize = do_all || stats.count("mediantxsize") != 0;
     const bool do_medianfee = do_all || stats.count("medianfee") != 0;
@@ -1908,13 +1982,133 @@ static UniValue getblockstats(const JSONRPCRequest& request)
     ret_all.pushKV("utxo_increase", outputs - inputs);
     ret_all.pushKV("utxo_size_inc", utxo_size_inc);
 
-    if (do_all) {
-        return ret_all;
+    return ret_all;
+}
+
+static UniValue getblockstats(const JSONRPCRequest& request)
+{
+    RPCHelpMan{"getblockstats",
+                "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
+                "It won't work for some heights with pruning.\n",
+                {
+                    {"hash_or_height", RPCArg::Type::NUM, RPCArg::Optional::NO, "The block hash or height of the target block", "", {"", "string or numeric"}},
+                    {"stats", RPCArg::Type::ARR, /* default */ "all values", "Values to plot (see result below)",
+                        {
+                            {"height", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "Selected statistic"},
+                            {"time", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "Selected statistic"},
+                        },
+                        "stats"},
+                },
+                RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::NUM, "avgfee", "Average fee in the block"},
+                {RPCResult::Type::NUM, "avgfeerate", "Average feerate (in satoshis per virtual byte)"},
+                {RPCResult::Type::NUM, "avgtxsize", "Average transaction size"},
+                {RPCResult::Type::STR_HEX, "blockhash", "The block hash (to check for potential reorgs)"},
+                {RPCResult::Type::ARR_FIXED, "feerate_percentiles", "Feerates at the 10th, 25th, 50th, 75th, and 90th percentile weight unit (in satoshis per virtual byte)",
+                {
+                    {RPCResult::Type::NUM, "10th_percentile_feerate", "The 10th percentile feerate"},
+                    {RPCResult::Type::NUM, "25th_percentile_feerate", "The 25th percentile feerate"},
+                    {RPCResult::Type::NUM, "50th_percentile_feerate", "The 50th percentile feerate"},
+                    {RPCResult::Type::NUM, "75th_percentile_feerate", "The 75th percentile feerate"},
+                    {RPCResult::Type::NUM, "90th_percentile_feerate", "The 90th percentile feerate"},
+                }},
+                {RPCResult::Type::NUM, "height", "The height of the block"},
+                {RPCResult::Type::NUM, "ins", "The number of inputs (excluding coinbase)"},
+                {RPCResult::Type::NUM, "maxfee", "Maximum fee in the block"},
+                {RPCResult::Type::NUM, "maxfeerate", "Maximum feerate (in satoshis per virtual byte)"},
+                {RPCResult::Type::NUM, "maxtxsize", "Maximum transaction size"},
+                {RPCResult::Type::NUM, "medianfee", "Truncated median fee in the block"},
+                {RPCResult::Type::NUM, "mediantime", "The block median time past"},
+                {RPCResult::Type::NUM, "mediantxsize", "Truncated median transaction size"},
+                {RPCResult::Type::NUM, "minfee", "Minimum fee in the block"},
+                {RPCResult::Type::NUM, "minfeerate", "Minimum feerate (in satoshis per virtual byte)"},
+                {RPCResult::Type::NUM, "mintxsize", "Minimum transaction size"},
+                {RPCResult::Type::NUM, "outs", "The number of outputs"},
+                {RPCResult::Type::NUM, "subsidy", "The block subsidy"},
+                {RPCResult::Type::NUM, "swtotal_size", "Total size of all segwit transactions"},
+                {RPCResult::Type::NUM, "swtotal_weight", "Total weight of all segwit transactions divided by segwit scale factor (4)"},
+                {RPCResult::Type::NUM, "swtxs", "The number of segwit transactions"},
+                {RPCResult::Type::NUM, "time", "The block time"},
+                {RPCResult::Type::NUM, "total_out", "Total amount in all outputs (excluding coinbase and thus reward [ie subsidy + totalfee])"},
+                {RPCResult::Type::NUM, "total_size", "Total size of all non-coinbase transactions"},
+                {RPCResult::Type::NUM, "total_weight", "Total weight of all non-coinbase transactions divided by segwit scale factor (4)"},
+                {RPCResult::Type::NUM, "totalfee", "The fee total"},
+                {RPCResult::Type::NUM, "txs", "The number of transactions (including coinbase)"},
+                {RPCResult::Type::NUM, "utxo_increase", "The increase/decrease in the number of unspent outputs"},
+                {RPCResult::Type::NUM, "utxo_size_inc", "The increase/decrease in size for the utxo index (not discounting op_return and similar)"},
+            }},
+                RPCExamples{
+                    HelpExampleCli("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
+            + HelpExampleRpc("getblockstats", "1000 '[\"minfeerate\",\"avgfeerate\"]'")
+                },
+    }.Check(request);
+
+    std::set<std::string> stats;
+    if (!request.params[1].isNull()) {
+        const UniValue stats_univalue = request.params[1].get_array();
+        for (unsigned int i = 0; i < stats_univalue.size(); i++) {
+            const std::string stat = stats_univalue[i].get_str();
+            stats.insert(stat);
+        }
+    }
+
+    std::shared_ptr<const UniValue> ret_all;
+    CBlockIndex* pindex = nullptr;
+    CBlock block;
+    CBlockUndo blockUndo;
+    {
+        LOCK(cs_main);
+        if (request.params[0].isNum()) {
+            const int height = request.params[0].get_int();
+            const int current_tip = ::ChainActive().Height();
+            if (height < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d is negative", height));
+            }
+            if (height > current_tip) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Target block height %d after current tip %d", height, current_tip));
+            }
+
+            pindex = ::ChainActive()[height];
+        } else {
+            const uint256 hash(ParseHashV(request.params[0], "hash_or_height"));
+            pindex = LookupBlockIndex(hash);
+            if (!pindex) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+            }
+            if (!::ChainActive().Contains(pindex)) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Block is not in chain %s", Params().NetworkIDString()));
+            }
+        }
+
+        CHECK_NONFATAL(pindex != nullptr);
+
+        if (g_block_json_cache && !IsBlockPruned(pindex)) {
+            ret_all = g_block_json_cache->Get(pindex->GetBlockHash(), BlockJSONCache::Kind::BLOCK_STATS);
+        }
+        if (!ret_all) {
+            block = GetBlockChecked(pindex);
+            blockUndo = GetUndoChecked(pindex);
+        }
+    }
+
+    if (!ret_all) {
+        if (g_block_json_cache) {
+            // Calculate everything, so later calls can select any statistic
+            ret_all = g_block_json_cache->Put(pindex->GetBlockHash(), BlockJSONCache::Kind::BLOCK_STATS, BlockStatsToJSON(pindex, block, blockUndo, {}));
+        } else {
+            ret_all = std::make_shared<const UniValue>(BlockStatsToJSON(pindex, block, blockUndo, stats));
+        }
+    }
+
+    if (stats.empty()) {
+        return *ret_all;
     }
 
     UniValue ret(UniValue::VOBJ);
     for (const std::string& stat : stats) {
-        const UniValue& value = ret_all[stat];
+        const UniValue& value = (*ret_all)[stat];
         if (value.isNull()) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid selected statistic %s", stat));
         }
@@ -1948,14 +2142,19 @@ static UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
-//! Search for a given set of pubkey scripts
-bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results) {
+//! Search for a given set of pubkey scripts among the coins whose txid starts with a byte in [begin_byte, end_byte)
+bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results, unsigned int begin_byte = 0, unsigned int end_byte = 0x100) {
     scan_progress = 0;
     count = 0;
+    const uint32_t range_begin = 0x100 * begin_byte;
+    const uint32_t range_size = 0x100 * (end_byte - begin_byte);
     while (cursor->Valid()) {
         COutPoint key;
         Coin coin;
-        if (!cursor->GetKey(key) || !cursor->GetValue(coin)) return false;
+        if (!cursor->GetKey(key)) return false;
+        // coins are ordered by txid, so the rest belongs to the next range
+        if (*key.hash.begin() >= end_byte) break;
+        if (!cursor->GetValue(coin)) return false;
         if (++count % 8192 == 0) {
             if (should_abort) {
                 // allow to abort the scan via the abort reference
@@ -1965,7 +2164,7 @@ bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>&
         if (count % 256 == 0) {
             // update progress reference every 256 item
             uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
-            scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
+            scan_progress = (int)((high - range_begin) * 100.0 / range_size + 0.5);
         }
         if (needles.count(coin.out.scriptPubKey)) {
             out_results.emplace(key, coin);
@@ -1976,6 +2175,64 @@ bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>&
     return true;
 }
 
+/** Maximum number of threads a scan of the UTXO set is split across */
+static const int MAX_SCANTXOUTSET_THREADS = 8;
+
+/** The part of the UTXO set scanned by one thread: the coins whose txid starts with a byte in [begin_byte, end_byte) */
+struct ScanShard {
+    std::unique_ptr<CCoinsViewCursor> cursor;
+    unsigned int begin_byte{0};
+    unsigned int end_byte{0x100};
+    std::atomic<int> progress{0};
+    int64_t count{0};
+    std::map<COutPoint, Coin> results;
+    bool success{false};
+};
+
+/** Scan all shards on their own threads, reporting the overall progress in scan_progress. Returns whether all scans completed. */
+static bool FindScriptPubKeyParallel(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, std::vector<ScanShard>& shards, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results)
+{
+    Mutex done_mutex;
+    std::condition_variable done_cond;
+    size_t done = 0;
+
+    std::vector<std::thread> threads;
+    for (ScanShard& shard : shards) {
+        ScanShard* const pshard = &shard;
+        threads.emplace_back([pshard, &should_abort, &needles, &done_mutex, &done_cond, &done] {
+            pshard->success = FindScriptPubKey(pshard->progress, should_abort, pshard->count, pshard->cursor.get(), needles, pshard->results, pshard->begin_byte, pshard->end_byte);
+            LOCK(done_mutex);
+            ++done;
+            done_cond.notify_one();
+        });
+    }
+
+    {
+        WAIT_LOCK(done_mutex, lock);
+        while (done < shards.size()) {
+            done_cond.wait_for(lock, std::chrono::milliseconds(100));
+            int progress = 0;
+            for (const ScanShard& shard : shards) {
+                progress += shard.progress;
+            }
+            scan_progress = progress / (int)shards.size();
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    bool success = true;
+    count = 0;
+    for (ScanShard& shard : shards) {
+        success &= shard.success;
+        count += shard.count;
+        out_results.insert(shard.results.begin(), shard.results.end());
+    }
+    scan_progress = 100;
+    return success;
+}
+
 /** RAII object to prevent concurrency issue when scanning the txout set */
 static std::mutex g_utxosetscan;
 static std::atomic<int> g_scan_progress;
@@ -2022,7 +2279,8 @@ UniValue scantxoutset(const JSONRPCRequest& request)
                 "or more path elements separated by \"/\", and optionally ending in \"/*\" (unhardened), or \"/*'\" or \"/*h\" (hardened) to specify all\n"
                 "unhardened or hardened child keys.\n"
                 "In the latter case, a range needs to be specified by below if different from 1000.\n"
-                "For more information on output descriptors, see the documentation in the doc/descriptors.md file.\n",
+                "For more information on output descriptors, see the documentation in the doc/descriptors.md file.\n"
+                "With -scriptindex enabled and synced, the matching outputs are looked up in the index instead of scanning the whole set.\n",
                 {
                     {"action", RPCArg::Type::STR, RPCArg::Optional::NO, "The action to execute\n"
             "                                      \"start\" for starting a scan\n"
@@ -2045,7 +2303,7 @@ UniValue scantxoutset(const JSONRPCRequest& request)
                     RPCResult::Type::OBJ, "", "",
                     {
                         {RPCResult::Type::BOOL, "success", "Whether the scan was completed"},
-                        {RPCResult::Type::NUM, "txouts", "The number of unspent transaction outputs scanned"},
+                        {RPCResult::Type::NUM, "txouts", "The number of unspent transaction outputs scanned (or read from the script index)"},
                         {RPCResult::Type::NUM, "height", "The current block height (index)"},
                         {RPCResult::Type::STR_HEX, "bestblock", "The hash of the block at the tip of the chain"},
                         {RPCResult::Type::ARR, "unspents", "",
@@ -2117,17 +2375,43 @@ UniValue scantxoutset(const JSONRPCRequest& request)
         g_should_abort_scan = false;
         g_scan_progress = 0;
         int64_t count = 0;
-        std::unique_ptr<CCoinsViewCursor> pcursor;
-        CBlockIndex* tip;
-        {
+        CBlockIndex* tip = nullptr;
+        bool res = false;
+        uint256 index_block_hash;
+        if (g_scriptindex && g_scriptindex->BlockUntilSyncedToCurrentChain() &&
+            g_scriptindex->FindCoins(needles, coins, count, index_block_hash)) {
+            // The index reflects the UTXO set as of the block it is synced to.
+            // It is only rewound once a block connects on top of a reorg, so
+            // it may still include blocks disconnected since.
             LOCK(cs_main);
-            ::ChainstateActive().ForceFlushStateToDisk();
-            pcursor = std::unique_ptr<CCoinsViewCursor>(::ChainstateActive().CoinsDB().Cursor());
-            CHECK_NONFATAL(pcursor);
-            tip = ::ChainActive().Tip();
-            CHECK_NONFATAL(tip);
+            tip = LookupBlockIndex(index_block_hash);
+            res = tip && ::ChainActive().Contains(tip);
+        }
+        if (res) {
+            g_scan_progress = 100;
+        } else {
+            coins.clear();
+            // Split the scan into ranges of the txid's first byte, which the
+            // coins database is ordered by, and scan them concurrently
+            const int num_shards = std::max(1, std::min(GetNumCores(), MAX_SCANTXOUTSET_THREADS));
+            std::vector<ScanShard> shards(num_shards);
+            {
+                LOCK(cs_main);
+                ::ChainstateActive().ForceFlushStateToDisk();
+                for (int i = 0; i < num_shards; ++i) {
+                    ScanShard& shard = shards[i];
+                    shard.begin_byte = 0x100 * i / num_shards;
+                    shard.end_byte = 0x100 * (i + 1) / num_shards;
+                    uint256 start;
+                    *start.begin() = shard.begin_byte;
+                    shard.cursor = std::unique_ptr<CCoinsViewCursor>(::ChainstateActive().CoinsDB().Cursor(COutPoint(start, 0)));
+                    CHECK_NONFATAL(shard.cursor);
+                }
+                tip = ::ChainActive().Tip();
+                CHECK_NONFATAL(tip);
+            }
+            res = FindScriptPubKeyParallel(g_scan_progress, g_should_abort_scan, count, shards, needles, coins);
         }
-        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, pcursor.get(), needles, coins);
         result.pushKV("success", res);
         result.pushKV("txouts", count);
         result.pushKV("height", tip->nHeight);
@@ -2158,6 +2442,264 @@ UniValue scantxoutset(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue AddrIndexEntriesToJSON(const std::vector<AddrIndexEntry>& entries)
+{
+    UniValue result(UniValue::VARR);
+    for (const AddrIndexEntry& entry : entries) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("type", entry.spending ? "spending" : "funding");
+        obj.pushKV("txid", entry.txid.GetHex());
+        obj.pushKV(entry.spending ? "vin" : "vout", (int64_t)entry.index);
+        obj.pushKV("height", entry.height);
+        obj.pushKV("amount", ValueFromAmount(entry.value));
+        if (entry.spending) {
+            obj.pushKV("spent_txid", entry.prevout.hash.GetHex());
+            obj.pushKV("spent_vout", (int64_t)entry.prevout.n);
+        }
+        result.push_back(obj);
+    }
+    return result;
+}
+
+/**
+ * The tip an index is queried at, once the index is in sync with it.
+ * Entries past the tip are ignored, so that blocks disconnected since the
+ * index was last updated don't show up.
+ */
+static const CBlockIndex* SyncedIndexTip(const BaseIndex& index, const std::string& name)
+{
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    if (!index.BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, name + " is still in the process of being built");
+    }
+    return tip;
+}
+
+static const CBlockIndex* AddrIndexQueryTip()
+{
+    if (!g_addrindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled (use -addrindex)");
+    }
+    return SyncedIndexTip(*g_addrindex, "Address index");
+}
+
+/** Decode an address or a hex-encoded scriptPubKey */
+static CScript ParseAddressOrScript(const UniValue& param)
+{
+    const std::string& str = param.get_str();
+    const CTxDestination dest = DecodeDestination(str);
+    if (IsValidDestination(dest)) {
+        return GetScriptForDestination(dest);
+    }
+    if (str.empty() || !IsHex(str)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address or script: " + str);
+    }
+    const std::vector<unsigned char> data(ParseHex(str));
+    return CScript(data.begin(), data.end());
+}
+
+static std::vector<RPCResult> AddrIndexEntryResult()
+{
+    return {
+        {RPCResult::Type::STR, "type", "\"funding\" for an output paying to the script, \"spending\" for an input spending one"},
+        {RPCResult::Type::STR_HEX, "txid", "The transaction id"},
+        {RPCResult::Type::NUM, "vout", /* optional */ true, "The output index, if funding"},
+        {RPCResult::Type::NUM, "vin", /* optional */ true, "The input index, if spending"},
+        {RPCResult::Type::NUM, "height", "The height of the block the transaction is in"},
+        {RPCResult::Type::STR_AMOUNT, "amount", "The amount in " + CURRENCY_UNIT + " of the output paid to or spent"},
+        {RPCResult::Type::STR_HEX, "spent_txid", /* optional */ true, "The transaction id of the output spent, if spending"},
+        {RPCResult::Type::NUM, "spent_vout", /* optional */ true, "The output index of the output spent, if spending"},
+    };
+}
+
+UniValue getaddresshistory(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddresshistory",
+                "\nReturns the transaction outputs paying to an address or scriptPubKey and the inputs spending them, in block order.\n"
+                "Requires -addrindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address, or the hex-encoded scriptPubKey"},
+                    {"start_height", RPCArg::Type::NUM, /* default */ "0", "The height of the first block to include"},
+                    {"end_height", RPCArg::Type::NUM, /* default */ "the tip", "The height of the last block to include"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "height", "The height of the tip the history was looked up at"},
+                        {RPCResult::Type::STR_HEX, "bestblock", "The hash of the tip the history was looked up at"},
+                        {RPCResult::Type::ARR, "history", "",
+                            {
+                                {RPCResult::Type::OBJ, "", "", AddrIndexEntryResult()},
+                            }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleCli("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\" 1000 2000") +
+                    HelpExampleRpc("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\", 1000, 2000")
+                },
+            }.Check(request);
+
+    const CScript script = ParseAddressOrScript(request.params[0]);
+    const int start_height = request.params[1].isNull() ? 0 : request.params[1].get_int();
+    if (start_height < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative start_height");
+    }
+    const CBlockIndex* tip = AddrIndexQueryTip();
+    const int end_height = request.params[2].isNull() ? tip->nHeight : std::min(request.params[2].get_int(), tip->nHeight);
+
+    std::vector<AddrIndexEntry> entries;
+    if (!g_addrindex->FindHistory(script, start_height, end_height, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("height", tip->nHeight);
+    result.pushKV("bestblock", tip->GetBlockHash().GetHex());
+    result.pushKV("history", AddrIndexEntriesToJSON(entries));
+    return result;
+}
+
+UniValue getaddressutxos(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getaddressutxos",
+                "\nReturns the unspent transaction outputs paying to an address or scriptPubKey, in block order.\n"
+                "Requires -addrindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address, or the hex-encoded scriptPubKey"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "height", "The height of the tip the outputs were looked up at"},
+                        {RPCResult::Type::STR_HEX, "bestblock", "The hash of the tip the outputs were looked up at"},
+                        {RPCResult::Type::ARR, "unspents", "",
+                            {
+                                {RPCResult::Type::OBJ, "", "", AddrIndexEntryResult()},
+                            }},
+                        {RPCResult::Type::STR_AMOUNT, "total_amount", "The total amount of all unspent outputs in " + CURRENCY_UNIT},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleRpc("getaddressutxos", "\"" + EXAMPLE_ADDRESS[0] + "\"")
+                },
+            }.Check(request);
+
+    const CScript script = ParseAddressOrScript(request.params[0]);
+    const CBlockIndex* tip = AddrIndexQueryTip();
+
+    std::vector<AddrIndexEntry> entries;
+    if (!g_addrindex->FindUnspent(script, tip->nHeight, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read the address index");
+    }
+    CAmount total = 0;
+    for (const AddrIndexEntry& entry : entries) {
+        total += entry.value;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("height", tip->nHeight);
+    result.pushKV("bestblock", tip->GetBlockHash().GetHex());
+    result.pushKV("unspents", AddrIndexEntriesToJSON(entries));
+    result.pushKV("total_amount", ValueFromAmount(total));
+    return result;
+}
+
+UniValue gettxspendingprevout(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"gettxspendingprevout",
+                "\nReturns the transactions spending the given outputs, in the mempool or, with -spentindex, in the active chain.\n",
+                {
+                    {"outputs", RPCArg::Type::ARR, RPCArg::Optional::NO, "The transaction outputs to look up",
+                        {
+                            {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                                {
+                                    {"txid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "The transaction id"},
+                                    {"vout", RPCArg::Type::NUM, RPCArg::Optional::NO, "The output number"},
+                                },
+                            },
+                        },
+                    },
+                },
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR_HEX, "txid", "The transaction id of the output"},
+                            {RPCResult::Type::NUM, "vout", "The output number"},
+                            {RPCResult::Type::STR_HEX, "spendingtxid", /* optional */ true, "The transaction id of the transaction spending the output, if any"},
+                            {RPCResult::Type::NUM, "spendingvin", /* optional */ true, "The input number of the transaction spending the output, if any"},
+                            {RPCResult::Type::NUM, "height", /* optional */ true, "The height of the block the spending transaction is in, if it isn't in the mempool"},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("gettxspendingprevout", "\"[{\\\"txid\\\":\\\"a08e6907dbbd3d809776dbfc5d82e371b764ed838b5655e72f463568df1aadf0\\\",\\\"vout\\\":3}]\"")
+            + HelpExampleRpc("gettxspendingprevout", "\"[{\\\"txid\\\":\\\"a08e6907dbbd3d809776dbfc5d82e371b764ed838b5655e72f463568df1aadf0\\\",\\\"vout\\\":3}]\"")
+                },
+            }.Check(request);
+
+    RPCTypeCheck(request.params, {UniValue::VARR});
+    const UniValue& output_params = request.params[0].get_array();
+    if (output_params.empty()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, outputs are missing");
+    }
+
+    std::vector<COutPoint> prevouts;
+    prevouts.reserve(output_params.size());
+    for (unsigned int idx = 0; idx < output_params.size(); idx++) {
+        const UniValue& o = output_params[idx].get_obj();
+        RPCTypeCheckObj(o,
+            {
+                {"txid", UniValueType(UniValue::VSTR)},
+                {"vout", UniValueType(UniValue::VNUM)},
+            }, /* fAllowNull */ false, /* fStrict */ true);
+
+        const uint256 txid(ParseHashO(o, "txid"));
+        const int nOutput = find_value(o, "vout").get_int();
+        if (nOutput < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, vout cannot be negative");
+        }
+        prevouts.emplace_back(txid, nOutput);
+    }
+
+    std::vector<SpentIndexEntry> entries(prevouts.size());
+    std::vector<bool> found(prevouts.size(), false);
+    if (g_spentindex) {
+        const CBlockIndex* tip = SyncedIndexTip(*g_spentindex, "Spent index");
+        for (size_t i = 0; i < prevouts.size(); ++i) {
+            found[i] = g_spentindex->FindSpender(prevouts[i], entries[i]) && entries[i].height <= tip->nHeight;
+        }
+    }
+
+    const CTxMemPool& mempool = EnsureMemPool();
+    LOCK(mempool.cs);
+    UniValue result{UniValue::VARR};
+    for (size_t i = 0; i < prevouts.size(); ++i) {
+        const COutPoint& prevout = prevouts[i];
+        UniValue o(UniValue::VOBJ);
+        o.pushKV("txid", prevout.hash.GetHex());
+        o.pushKV("vout", (uint64_t)prevout.n);
+
+        if (found[i]) {
+            o.pushKV("spendingtxid", entries[i].txid.GetHex());
+            o.pushKV("spendingvin", (uint64_t)entries[i].input_index);
+            o.pushKV("height", entries[i].height);
+        } else if (const CTransaction* spending_tx = mempool.GetConflictTx(prevout)) {
+            for (size_t j = 0; j < spending_tx->vin.size(); ++j) {
+                if (spending_tx->vin[j].prevout == prevout) {
+                    o.pushKV("spendingtxid", spending_tx->GetHash().GetHex());
+                    o.pushKV("spendingvin", (uint64_t)j);
+                    break;
+                }
+            }
+        }
+
+        result.push_back(o);
+    }
+    return result;
+}
+
 static UniValue getblockfilter(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblockfilter",
@@ -2371,6 +2913,9 @@ static const CRPCCommand commands[] =
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
     { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "getaddresshistory",      &getaddresshistory,      {"address", "start_height", "end_height"} },
+    { "blockchain",         "getaddressutxos",        &getaddressutxos,        {"address"} },
+    { "blockchain",         "gettxspendingprevout",   &gettxspendingprevout,   {"outputs"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -73,6 +73,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "sendmany", 6 , "conf_target" },
     { "deriveaddresses", 1, "range" },
     { "scantxoutset", 1, "scanobjects" },
+    { "getaddresshistory", 1, "start_height" },
+    { "getaddresshistory", 2, "end_height" },
+    { "gettxspendingprevout", 0, "outputs" },
     { "addmultisigaddress", 0, "nrequired" },
     { "addmultisigaddress", 1, "keys" },
     { "createmultisig", 0, "nrequired" },
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <univalue.h>
+
+#include <cassert>
+#include <utility>
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t flush_size)
+    : m_sink(std::move(sink)), m_flush_size(flush_size)
+{
+    m_buffer.reserve(m_flush_size);
+}
+
+void JSONStreamWriter::Separate()
+{
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+    if (m_empty.empty()) return;
+    if (!m_empty.back()) m_buffer += ',';
+    m_empty.back() = false;
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    m_buffer += '{';
+    m_empty.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_empty.empty() && !m_after_key);
+    m_buffer += '}';
+    m_empty.pop_back();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    m_buffer += '[';
+    m_empty.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_empty.empty() && !m_after_key);
+    m_buffer += ']';
+    m_empty.pop_back();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_empty.empty() && !m_after_key);
+    Separate();
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separate();
+    m_buffer += value.write();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+    m_sink(m_buffer);
+    m_buffer.clear();
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/** Writes JSON piece by piece, for results too large to build as a single
+ * UniValue tree first. Only the values passed to Value() are ever held as
+ * UniValue, so callers can produce e.g. one transaction at a time.
+ *
+ * The text is the same as UniValue::write() without indentation would give
+ * for the whole result. It is handed to the sink in pieces of about
+ * flush_size bytes, and whatever is left by Flush().
+ */
+class JSONStreamWriter
+{
+public:
+    using Sink = std::function<void(const std::string& text)>;
+
+    static constexpr size_t DEFAULT_FLUSH_SIZE = 64 * 1024;
+
+    explicit JSONStreamWriter(Sink sink, size_t flush_size = DEFAULT_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next member of the current object */
+    void Key(const std::string& key);
+    /** Write a complete value: an element of the current array, or the
+     *  value of the member whose key was just written */
+    void Value(const UniValue& value);
+    void KeyValue(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    /** Hand everything written so far to the sink */
+    void Flush();
+
+private:
+    /** Write the separator needed before a new value or key */
+    void Separate();
+    void MaybeFlush()
+    {
+        if (m_buffer.size() >= m_flush_size) Flush();
+    }
+
+    const Sink m_sink;
+    const size_t m_flush_size;
+    std::string m_buffer;
+    /** For each open object or array, whether nothing was written in it yet */
+    std::vector<bool> m_empty;
+    /** Whether a key was just written, so its value needs no separator */
+    bool m_after_key{false};
+};
+
+/** Writes a result to a JSON stream, see JSONRPCRequest::result_writer */
+using RPCResultWriter = std::function<void(JSONStreamWriter& writer)>;
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
@@ -34,6 +34,8 @@
 #include <versionbitsinfo.h>
 #include <warnings.h>
 
+#include <algorithm>
+#include <deque>
 #include <memory>
 #include <stdint.h>
 
@@ -332,6 +334,69 @@ static std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     return s;
 }
 
+/** Number of recent block templates whose transactions are kept for getblocktemplatediff */
+static const size_t BLOCK_TEMPLATE_HISTORY_SIZE = 10;
+
+namespace {
+/** The block template shared by getblocktemplate and getblocktemplatediff */
+struct BlockTemplateState
+{
+    unsigned int nTransactionsUpdatedLast{0};
+    CBlockIndex* pindexPrev{nullptr};
+    int64_t nStart{0};
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    //! longpollid of the current template and its transactions
+    std::string longpollid;
+    //! (longpollid, txids) of the most recent templates, oldest first
+    std::deque<std::pair<std::string, std::vector<uint256>>> history;
+};
+BlockTemplateState g_block_template GUARDED_BY(cs_main);
+} // namespace
+
+/** Rebuild the shared block template if the tip changed, or if the mempool changed and it is more than 5 seconds old */
+static CBlockTemplate& UpdateBlockTemplate(const CTxMemPool& mempool) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    BlockTemplateState& state = g_block_template;
+    if (state.pindexPrev != ::ChainActive().Tip() ||
+        (mempool.GetTransactionsUpdated() != state.nTransactionsUpdatedLast && GetTime() - state.nStart > 5))
+    {
+        // Clear pindexPrev so future calls make a new block, despite any failures from here on
+        state.pindexPrev = nullptr;
+
+        // Store the pindexBest used before CreateNewBlock, to avoid races
+        state.nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+        CBlockIndex* pindexPrevNew = ::ChainActive().Tip();
+        state.nStart = GetTime();
+
+        // Create new block
+        CScript scriptDummy = CScript() << OP_TRUE;
+        state.pblocktemplate = BlockAssembler(mempool, Params()).CreateNewBlock(scriptDummy);
+        if (!state.pblocktemplate)
+            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+
+        // Need to update only after we know CreateNewBlock succeeded
+        state.pindexPrev = pindexPrevNew;
+        state.longpollid = pindexPrevNew->GetBlockHash().GetHex() + ToString(state.nTransactionsUpdatedLast);
+        state.history.emplace_back(state.longpollid, GetBlockTemplateTxids(state.pblocktemplate->block));
+        if (state.history.size() > BLOCK_TEMPLATE_HISTORY_SIZE) state.history.pop_front();
+    }
+    CHECK_NONFATAL(state.pindexPrev);
+    return *state.pblocktemplate;
+}
+
+/** Throw if the node is not in a state to hand out block templates */
+static void EnsureBlockTemplateAvailable() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if(!g_rpc_node->connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    if (g_rpc_node->connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
+        throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, PACKAGE_NAME " is not connected!");
+
+    if (::ChainstateActive().IsInitialBlockDownload())
+        throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, PACKAGE_NAME " is in initial sync and waiting for blocks...");
+}
+
 static UniValue getblocktemplate(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getblocktemplate",
@@ -485,16 +550,9 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
     if (strMode != "template")
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid mode");
 
-    if(!g_rpc_node->connman)
-        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
-
-    if (g_rpc_node->connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
-        throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, PACKAGE_NAME " is not connected!");
-
-    if (::ChainstateActive().IsInitialBlockDownload())
-        throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, PACKAGE_NAME " is in initial sync and waiting for blocks...");
+    EnsureBlockTemplateAvailable();
 
-    static unsigned int nTransactionsUpdatedLast;
+    const unsigned int& nTransactionsUpdatedLast = g_block_template.nTransactionsUpdatedLast;
     const CTxMemPool& mempool = EnsureMemPool();
 
     if (!lpval.isNull())
@@ -550,30 +608,8 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
     }
 
     // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t nStart;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != ::ChainActive().Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
-    {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
-
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = ::ChainActive().Tip();
-        nStart = GetTime();
-
-        // Create new block
-        CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(mempool, Params()).CreateNewBlock(scriptDummy);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
-
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
-    }
-    CHECK_NONFATAL(pindexPrev);
+    CBlockTemplate* pblocktemplate = &UpdateBlockTemplate(mempool);
+    const CBlockIndex* pindexPrev = g_block_template.pindexPrev;
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
     const Consensus::Params& consensusParams = Params().GetConsensus();
 
@@ -697,7 +733,7 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
     result.pushKV("transactions", transactions);
     result.pushKV("coinbaseaux", aux);
     result.pushKV("coinbasevalue", (int64_t)pblock->vtx[0]->vout[0].nValue);
-    result.pushKV("longpollid", ::ChainActive().Tip()->GetBlockHash().GetHex() + ToString(nTransactionsUpdatedLast));
+    result.pushKV("longpollid", g_block_template.longpollid);
     result.pushKV("target", hashTarget.GetHex());
     result.pushKV("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1);
     result.pushKV("mutable", aMutable);
@@ -726,6 +762,114 @@ static UniValue getblocktemplate(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue getblocktemplatediff(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getblocktemplatediff",
+                "\nReturns the changes between the current block template and an earlier one returned by getblocktemplate\n"
+                "or getblocktemplatediff, identified by its longpollid.\n"
+                "Removing the transactions listed in 'removed' from the earlier template and appending those in 'added',\n"
+                "in order, yields the transactions of the current template in a valid order.\n"
+                "Only the last " + ToString(BLOCK_TEMPLATE_HISTORY_SIZE) + " templates are remembered; for older ones getblocktemplate must be called again.\n",
+                {
+                    {"longpollid", RPCArg::Type::STR, RPCArg::Optional::NO, "The longpollid of the earlier template"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::STR, "longpollid", "The longpollid of the current template"},
+                        {RPCResult::Type::STR, "previousblockhash", "The hash of current highest block"},
+                        {RPCResult::Type::NUM, "height", "The height of the next block"},
+                        {RPCResult::Type::STR, "bits", "compressed target of next block"},
+                        {RPCResult::Type::NUM_TIME, "mintime", "The minimum timestamp appropriate for the next block time, expressed in " + UNIX_EPOCH_TIME},
+                        {RPCResult::Type::NUM_TIME, "curtime", "current timestamp in " + UNIX_EPOCH_TIME},
+                        {RPCResult::Type::NUM, "coinbasevalue", "maximum allowable input to coinbase transaction, including the generation award and transaction fees (in satoshis)"},
+                        {RPCResult::Type::STR_HEX, "default_witness_commitment", /* optional */ true, "Witness commitment for the current set of transactions"},
+                        {RPCResult::Type::ARR, "added", "transactions that were not in the earlier template, in template order",
+                            {
+                                {RPCResult::Type::OBJ, "", "",
+                                    {
+                                        {RPCResult::Type::STR_HEX, "data", "transaction data encoded in hexadecimal (byte-for-byte)"},
+                                        {RPCResult::Type::STR_HEX, "txid", "transaction id encoded in little-endian hexadecimal"},
+                                        {RPCResult::Type::STR_HEX, "hash", "hash encoded in little-endian hexadecimal (including witness data)"},
+                                        {RPCResult::Type::NUM, "fee", "difference in value between transaction inputs and outputs (in satoshis)"},
+                                        {RPCResult::Type::NUM, "sigops", "total SigOps cost, as counted for purposes of block limits"},
+                                        {RPCResult::Type::NUM, "weight", "total transaction weight, as counted for purposes of block limits"},
+                                    }},
+                            }},
+                        {RPCResult::Type::ARR, "removed", "transactions of the earlier template that are no longer included",
+                            {
+                                {RPCResult::Type::STR_HEX, "", "transaction id"},
+                            }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getblocktemplatediff", "\"longpollid\"")
+            + HelpExampleRpc("getblocktemplatediff", "\"longpollid\"")
+                },
+            }.Check(request);
+
+    LOCK(cs_main);
+
+    const std::string& base_id = request.params[0].get_str();
+
+    EnsureBlockTemplateAvailable();
+
+    const CTxMemPool& mempool = EnsureMemPool();
+    CBlockTemplate& blocktemplate = UpdateBlockTemplate(mempool);
+    const CBlockIndex* pindexPrev = g_block_template.pindexPrev;
+    CBlock& block = blocktemplate.block;
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    auto base = std::find_if(g_block_template.history.begin(), g_block_template.history.end(),
+        [&](const std::pair<std::string, std::vector<uint256>>& entry) { return entry.first == base_id; });
+    if (base == g_block_template.history.end()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown or expired longpollid, call getblocktemplate for a full template");
+    }
+
+    UpdateTime(&block, consensusParams, pindexPrev);
+    block.nNonce = 0;
+
+    const bool fPreSegWit = (pindexPrev->nHeight + 1 < consensusParams.SegwitHeight);
+
+    const BlockTemplateDiff diff = GetBlockTemplateDiff(base->second, block);
+    UniValue added(UniValue::VARR);
+    for (const size_t index_in_template : diff.added) {
+        const CTransaction& tx = *block.vtx[index_in_template];
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("data", EncodeHexTx(tx));
+        entry.pushKV("txid", tx.GetHash().GetHex());
+        entry.pushKV("hash", tx.GetWitnessHash().GetHex());
+        entry.pushKV("fee", blocktemplate.vTxFees[index_in_template]);
+        int64_t nTxSigOps = blocktemplate.vTxSigOpsCost[index_in_template];
+        if (fPreSegWit) {
+            CHECK_NONFATAL(nTxSigOps % WITNESS_SCALE_FACTOR == 0);
+            nTxSigOps /= WITNESS_SCALE_FACTOR;
+        }
+        entry.pushKV("sigops", nTxSigOps);
+        entry.pushKV("weight", GetTransactionWeight(tx));
+        added.push_back(entry);
+    }
+    UniValue removed(UniValue::VARR);
+    for (const uint256& txid : diff.removed) {
+        removed.push_back(txid.GetHex());
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("longpollid", g_block_template.longpollid);
+    result.pushKV("previousblockhash", block.hashPrevBlock.GetHex());
+    result.pushKV("height", (int64_t)(pindexPrev->nHeight+1));
+    result.pushKV("bits", strprintf("%08x", block.nBits));
+    result.pushKV("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1);
+    result.pushKV("curtime", block.GetBlockTime());
+    result.pushKV("coinbasevalue", (int64_t)block.vtx[0]->vout[0].nValue);
+    if (!blocktemplate.vchCoinbaseCommitment.empty()) {
+        result.pushKV("default_witness_commitment", HexStr(blocktemplate.vchCoinbaseCommitment.begin(), blocktemplate.vchCoinbaseCommitment.end()));
+    }
+    result.pushKV("added", added);
+    result.pushKV("removed", removed);
+    return result;
+}
+
 class submitblock_StateCatcher final : public CValidationInterface
 {
 public:
@@ -1034,6 +1178,7 @@ static const CRPCCommand commands[] =
     { "mining",             "getmininginfo",          &getmininginfo,          {} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  {"txid","dummy","fee_delta"} },
     { "mining",             "getblocktemplate",       &getblocktemplate,       {"template_request"} },
+    { "mining",             "getblocktemplatediff",   &getblocktemplatediff,   {"longpollid"} },
     { "mining",             "submitblock",            &submitblock,            {"hexdata","dummy"} },
     { "mining",             "submitheader",           &submitheader,           {"hexdata"} },
 
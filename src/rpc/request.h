@@ -6,6 +6,8 @@
 #ifndef BITCOIN_RPC_REQUEST_H
 #define BITCOIN_RPC_REQUEST_H
 
+#include <rpc/jsonstream.h>
+
 #include <string>
 
 #include <univalue.h>
@@ -34,8 +36,12 @@ public:
     std::string URI;
     std::string authUser;
     std::string peerAddr;
+    /** Only set by callers that can stream the reply. Handlers of calls with
+     * very large results may then store there a function writing the result,
+     * and return NullUniValue instead of building it. */
+    RPCResultWriter* result_writer;
 
-    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false) {}
+    JSONRPCRequest() : id(NullUniValue), params(NullUniValue), fHelp(false), result_writer(nullptr) {}
     void parse(const UniValue& valRequest);
 };
 
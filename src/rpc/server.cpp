@@ -5,6 +5,7 @@
 
 #include <rpc/server.h>
 
+#include <httpserver.h>
 #include <rpc/util.h>
 #include <shutdown.h>
 #include <sync.h>
@@ -15,6 +16,8 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 
+#include <atomic>
+#include <condition_variable>
 #include <memory> // for unique_ptr
 #include <unordered_map>
 
@@ -210,6 +213,19 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
                             }},
                         }},
                         {RPCResult::Type::STR, "logpath", "The complete file path to the debug log"},
+                        {RPCResult::Type::OBJ, "work_queue", "Requests waiting for an RPC thread (only when the HTTP server runs)",
+                        {
+                            {RPCResult::Type::NUM, "depth", "The number of waiting requests, other than priority ones"},
+                            {RPCResult::Type::NUM, "priority_depth", "The number of waiting cheap read-only calls, which are served first"},
+                            {RPCResult::Type::NUM, "clients", "The number of clients with waiting requests, which take turns"},
+                            {RPCResult::Type::NUM, "served", "The number of requests handed to an RPC thread, other than priority ones"},
+                            {RPCResult::Type::NUM, "priority_served", "The number of priority requests handed to an RPC thread"},
+                            {RPCResult::Type::NUM, "helpers_served", "The number of calls of batch requests handed to an idle RPC thread"},
+                            {RPCResult::Type::NUM, "average_wait", "The average time served requests waited, in microseconds"},
+                            {RPCResult::Type::NUM, "max_wait", "The longest time a served request waited, in microseconds"},
+                            {RPCResult::Type::NUM, "rejected", "The number of requests refused because the queue was full"},
+                            {RPCResult::Type::NUM, "dropped", "The number of queued requests refused to make room for another client's"},
+                        }},
                     }
                 },
                 RPCExamples{
@@ -233,6 +249,23 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
     UniValue log_path(UniValue::VSTR, path);
     result.pushKV("logpath", log_path);
 
+    HTTPWorkQueueStats stats;
+    if (GetHTTPWorkQueueStats(stats)) {
+        const uint64_t served = stats.served + stats.priority_served;
+        UniValue work_queue(UniValue::VOBJ);
+        work_queue.pushKV("depth", (uint64_t)stats.depth);
+        work_queue.pushKV("priority_depth", (uint64_t)stats.priority_depth);
+        work_queue.pushKV("clients", (uint64_t)stats.clients);
+        work_queue.pushKV("served", stats.served);
+        work_queue.pushKV("priority_served", stats.priority_served);
+        work_queue.pushKV("helpers_served", stats.helpers_served);
+        work_queue.pushKV("average_wait", served ? stats.total_wait / (int64_t)served : 0);
+        work_queue.pushKV("max_wait", stats.max_wait);
+        work_queue.pushKV("rejected", stats.rejected);
+        work_queue.pushKV("dropped", stats.dropped);
+        result.pushKV("work_queue", work_queue);
+    }
+
     return result;
 }
 
@@ -360,12 +393,60 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+namespace {
+/** The calls of a batch being executed by several threads */
+struct ParallelBatch {
+    ParallelBatch(const JSONRPCRequest& jreq_in, const UniValue& requests_in)
+        : jreq(jreq_in), requests(requests_in), results(requests_in.size()) {}
+
+    const JSONRPCRequest jreq;
+    /** Only used while calls are left: tasks started after all calls were
+     *  taken don't touch it, so it needs to live as long as the batch call */
+    const UniValue& requests;
+    std::vector<UniValue> results;
+    /** Index of the next call to execute */
+    std::atomic<size_t> next{0};
+    Mutex mutex;
+    std::condition_variable cond;
+    size_t done GUARDED_BY(mutex){0};
+
+    /** Execute calls until there are none left */
+    void Run()
+    {
+        size_t index;
+        while ((index = next++) < results.size()) {
+            UniValue result = JSONRPCExecOne(jreq, requests[index]);
+            LOCK(mutex);
+            results[index] = std::move(result);
+            if (++done == results.size()) cond.notify_all();
+        }
+    }
+};
+} // namespace
+
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCTaskRunner& run_task, int max_threads)
 {
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    if (!run_task || max_threads <= 1 || vReq.size() <= 1) {
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+
+        return ret.write() + "\n";
+    }
 
+    // Tasks may start after the batch is complete, so they share ownership
+    // of its state. This thread executes calls too, so the batch completes
+    // even if no task ever runs.
+    auto batch = std::make_shared<ParallelBatch>(jreq, vReq);
+    for (int i = 1; i < max_threads && (size_t)i < vReq.size(); ++i) {
+        if (!run_task([batch] { batch->Run(); })) break;
+    }
+    batch->Run();
+    {
+        WAIT_LOCK(batch->mutex, lock);
+        while (batch->done < vReq.size()) batch->cond.wait(lock);
+    }
+    ret.push_backV(batch->results);
     return ret.write() + "\n";
 }
 
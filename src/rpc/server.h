@@ -162,7 +162,15 @@ extern CRPCTable tableRPC;
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Starts a task on another thread, returning false if it can't right now */
+typedef std::function<bool(std::function<void()> task)> RPCTaskRunner;
+/**
+ * Execute a JSON-RPC batch and return the array of replies, in the order of
+ * the calls. With a run_task function and max_threads above one, calls are
+ * spread over up to max_threads threads (this one included): they may then
+ * run in any order and concurrently.
+ */
+std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCTaskRunner& run_task = nullptr, int max_threads = 1);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
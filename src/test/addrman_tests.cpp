@@ -780,6 +780,35 @@ BOOST_AUTO_TEST_CASE(addrman_serialization)
 }
 
 
+BOOST_AUTO_TEST_CASE(addrman_set_asmap)
+{
+    std::vector<bool> asmap1 = FromBytes(asmap_raw, sizeof(asmap_raw) * 8);
+    // An asmap mapping everything to AS2000: a RETURN instruction (0b00)
+    // followed by the ASN minus one in 15 bits.
+    std::vector<bool> asmap2{false, false};
+    for (int bit = 14; bit >= 0; --bit) asmap2.push_back((1999 >> bit) & 1);
+
+    CAddrManTest addrman(true, asmap1);
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+
+    CAddress addr = CAddress(ResolveService("250.1.1.1"), NODE_NONE);
+    CNetAddr source = ResolveIP("252.2.2.2");
+    CAddrInfo info(addr, source);
+    BOOST_CHECK(info.GetNewBucket(uint256(), asmap1) != info.GetNewBucket(uint256(), asmap2));
+
+    // Buckets computed by the addrman, with asmap lookups cached, match
+    // those computed from the asmap directly.
+    addrman.Add(addr, source);
+    BOOST_CHECK_EQUAL(addrman.GetBucketAndEntry(addr).first, info.GetNewBucket(uint256(), asmap1));
+
+    // Loading with another asmap rebuckets with it, not with the lookups
+    // cached for the previous one.
+    stream << addrman;
+    addrman.SetAsmap(asmap2);
+    stream >> addrman;
+    BOOST_CHECK_EQUAL(addrman.GetBucketAndEntry(addr).first, info.GetNewBucket(uint256(), asmap2));
+}
+
 BOOST_AUTO_TEST_CASE(addrman_selecttriedcollision)
 {
     CAddrManTest addrman;
@@ -0,0 +1,175 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bantrie.h>
+#include <netbase.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+
+#include <map>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(bantrie_tests, BasicTestingSetup)
+
+static CNetAddr ResolveIP(const std::string& ip)
+{
+    CNetAddr addr;
+    LookupHost(ip, addr, false);
+    return addr;
+}
+
+static CSubNet ResolveSubNet(const std::string& subnet)
+{
+    CSubNet ret;
+    LookupSubNet(subnet, ret);
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(prefix_length)
+{
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.0/24").GetPrefixLength(), 120);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.4").GetPrefixLength(), 128);
+    BOOST_CHECK_EQUAL(ResolveSubNet("0.0.0.0/0").GetPrefixLength(), 96);
+    BOOST_CHECK_EQUAL(ResolveSubNet("2001:db8::/33").GetPrefixLength(), 33);
+    BOOST_CHECK_EQUAL(ResolveSubNet("::/0").GetPrefixLength(), 0);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.4/255.0.255.0").GetPrefixLength(), -1);
+}
+
+BOOST_AUTO_TEST_CASE(ban_lookup)
+{
+    BanTrie trie;
+    const int64_t now = 1000;
+
+    trie.Insert(ResolveSubNet("1.2.3.0/24"), now + 10);
+    BOOST_CHECK(trie.IsBanned(ResolveIP("1.2.3.4"), now));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("1.2.4.4"), now));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("::ffff:1.2.4.4"), now));
+    BOOST_CHECK(trie.IsBanned(ResolveIP("::ffff:1.2.3.4"), now));
+    // Expired bans don't match.
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("1.2.3.4"), now + 10));
+
+    // Nested subnets
+    trie.Insert(ResolveSubNet("1.2.0.0/16"), now + 20);
+    trie.Insert(ResolveSubNet("1.2.3.4"), now + 30);
+    BOOST_CHECK_EQUAL(trie.Size(), 3U);
+    BOOST_CHECK(trie.IsBanned(ResolveIP("1.2.4.4"), now + 15));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("1.2.3.5"), now + 25));
+    BOOST_CHECK(trie.IsBanned(ResolveIP("1.2.3.4"), now + 25));
+    trie.Erase(ResolveSubNet("1.2.0.0/16"));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("1.2.4.4"), now));
+    BOOST_CHECK(trie.IsBanned(ResolveIP("1.2.3.5"), now));
+    // Updating the ban time doesn't add an entry.
+    trie.Insert(ResolveSubNet("1.2.3.0/24"), now + 40);
+    BOOST_CHECK_EQUAL(trie.Size(), 2U);
+    BOOST_CHECK(trie.IsBanned(ResolveIP("1.2.3.5"), now + 35));
+
+    // IPv6 and Tor
+    trie.Insert(ResolveSubNet("2001:470::/32"), now + 10);
+    trie.Insert(CSubNet(ResolveIP("5wyqrzbvrdsumnok.onion")), now + 10);
+    BOOST_CHECK(trie.IsBanned(ResolveIP("2001:470:1::1"), now));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("2001:471::1"), now));
+    BOOST_CHECK(trie.IsBanned(ResolveIP("5wyqrzbvrdsumnok.onion"), now));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("5wyqrzbvrdsumnol.onion"), now));
+
+    // Netmasks that are not a prefix
+    trie.Insert(ResolveSubNet("5.6.7.8/255.0.255.0"), now + 10);
+    BOOST_CHECK(trie.IsBanned(ResolveIP("5.1.7.1"), now));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("5.1.8.1"), now));
+    BOOST_CHECK_EQUAL(trie.Size(), 5U);
+    trie.Erase(ResolveSubNet("5.6.7.8/255.0.255.0"));
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("5.1.7.1"), now));
+
+    // Invalid subnets and addresses never match.
+    trie.Insert(CSubNet(), now + 10);
+    BOOST_CHECK_EQUAL(trie.Size(), 4U);
+    BOOST_CHECK(!trie.IsBanned(CNetAddr(), now));
+
+    // Everything
+    trie.Insert(ResolveSubNet("::/0"), now + 10);
+    BOOST_CHECK(trie.IsBanned(ResolveIP("8.8.8.8"), now));
+    BOOST_CHECK(trie.IsBanned(ResolveIP("2002::1"), now));
+
+    trie.Clear();
+    BOOST_CHECK_EQUAL(trie.Size(), 0U);
+    BOOST_CHECK(!trie.IsBanned(ResolveIP("1.2.3.4"), now));
+}
+
+static CNetAddr RandomAddress(FastRandomContext& rng)
+{
+    CNetAddr addr;
+    if (rng.randbool()) {
+        uint8_t ip[4];
+        ip[0] = 10 + rng.randbits(1);
+        ip[1] = rng.randbits(2);
+        ip[2] = rng.randbits(8);
+        ip[3] = rng.randbits(8);
+        addr.SetRaw(NET_IPV4, ip);
+    } else {
+        uint8_t ip[16];
+        ip[0] = 0x20;
+        ip[1] = 0x01;
+        ip[2] = rng.randbits(2);
+        for (int i = 3; i < 16; ++i) ip[i] = rng.randbits(i < 6 ? 8 : 1);
+        addr.SetRaw(NET_IPV6, ip);
+    }
+    return addr;
+}
+
+BOOST_AUTO_TEST_CASE(ban_lookup_random)
+{
+    FastRandomContext rng(true);
+    BanTrie trie;
+    std::map<CSubNet, int64_t> banned;
+    const int64_t now = 1000;
+
+    const auto check = [&] {
+        BOOST_CHECK_EQUAL(trie.Size(), banned.size());
+        for (int i = 0; i < 2000; ++i) {
+            const CNetAddr addr = RandomAddress(rng);
+            bool expected = false;
+            for (const auto& entry : banned) {
+                if (now < entry.second && entry.first.Match(addr)) expected = true;
+            }
+            BOOST_CHECK_EQUAL(trie.IsBanned(addr, now), expected);
+        }
+    };
+
+    for (int i = 0; i < 500; ++i) {
+        const CNetAddr addr = RandomAddress(rng);
+        CSubNet sub_net;
+        if (rng.randrange(50) == 0) {
+            CNetAddr mask;
+            const uint8_t mask_bytes[4] = {255, 0, 255, 0};
+            mask.SetRaw(NET_IPV4, mask_bytes);
+            sub_net = CSubNet(addr, mask);
+        } else {
+            sub_net = CSubNet(addr, addr.IsIPv4() ? 8 + rng.randrange(25) : 16 + rng.randrange(113));
+        }
+        const int64_t ban_until = now - 5 + rng.randrange(20);
+        trie.Insert(sub_net, ban_until);
+        banned[sub_net] = ban_until;
+    }
+    check();
+
+    // Unban about half of them
+    for (auto it = banned.begin(); it != banned.end();) {
+        if (rng.randbool()) {
+            trie.Erase(it->first);
+            it = banned.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    check();
+
+    for (const auto& entry : banned) {
+        trie.Erase(entry.first);
+    }
+    banned.clear();
+    check();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,100 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/blockcache.h>
+#include <test/util/setup_common.h>
+
+#include <univalue.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static UniValue TxidsJSON(size_t count)
+{
+    UniValue txids(UniValue::VARR);
+    for (size_t i = 0; i < count; ++i) {
+        txids.push_back(InsecureRand256().GetHex());
+    }
+    return txids;
+}
+
+BOOST_AUTO_TEST_CASE(usage)
+{
+    BOOST_CHECK(UniValueDynamicUsage(UniValue(1)) < UniValueDynamicUsage(UniValue(std::string(100, 'a'))));
+    const size_t usage = UniValueDynamicUsage(TxidsJSON(100));
+    // The hex strings alone
+    BOOST_CHECK(usage > 100 * 64);
+    BOOST_CHECK(usage < 100 * (sizeof(UniValue) + 200));
+}
+
+BOOST_AUTO_TEST_CASE(lookup_and_erase)
+{
+    BlockJSONCache cache(1 << 20);
+    const uint256 hash1 = InsecureRand256();
+    const uint256 hash2 = InsecureRand256();
+
+    BOOST_CHECK(!cache.Get(hash1, BlockJSONCache::Kind::BLOCK_TXIDS));
+    auto value = cache.Put(hash1, BlockJSONCache::Kind::BLOCK_TXIDS, UniValue("txids"));
+    BOOST_CHECK_EQUAL(value->get_str(), "txids");
+    cache.Put(hash1, BlockJSONCache::Kind::BLOCK_STATS, UniValue("stats"));
+    cache.Put(hash2, BlockJSONCache::Kind::BLOCK_TXIDS, UniValue("other"));
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+    BOOST_CHECK_EQUAL(cache.Get(hash1, BlockJSONCache::Kind::BLOCK_TXIDS)->get_str(), "txids");
+    BOOST_CHECK_EQUAL(cache.Get(hash1, BlockJSONCache::Kind::BLOCK_STATS)->get_str(), "stats");
+    BOOST_CHECK(!cache.Get(hash1, BlockJSONCache::Kind::BLOCK_TXS));
+
+    // Replacing a value doesn't add an entry
+    const size_t usage = cache.DynamicMemoryUsage();
+    cache.Put(hash2, BlockJSONCache::Kind::BLOCK_TXIDS, UniValue("again"));
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), usage);
+    BOOST_CHECK_EQUAL(cache.Get(hash2, BlockJSONCache::Kind::BLOCK_TXIDS)->get_str(), "again");
+
+    // Erasing a block drops all its values, but values handed out stay valid
+    cache.Erase(hash1);
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+    BOOST_CHECK(!cache.Get(hash1, BlockJSONCache::Kind::BLOCK_TXIDS));
+    BOOST_CHECK(!cache.Get(hash1, BlockJSONCache::Kind::BLOCK_STATS));
+    BOOST_CHECK_EQUAL(value->get_str(), "txids");
+    cache.Erase(hash2);
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(eviction)
+{
+    const size_t entry_usage = [] {
+        BlockJSONCache cache(1 << 20);
+        cache.Put(uint256(), BlockJSONCache::Kind::BLOCK_TXIDS, TxidsJSON(10));
+        return cache.DynamicMemoryUsage();
+    }();
+    BlockJSONCache cache(entry_usage * 3);
+
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 4; ++i) {
+        hashes.push_back(InsecureRand256());
+    }
+    for (int i = 0; i < 3; ++i) {
+        cache.Put(hashes[i], BlockJSONCache::Kind::BLOCK_TXIDS, TxidsJSON(10));
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+
+    // Using the oldest entry makes the second one the least recently used
+    BOOST_CHECK(cache.Get(hashes[0], BlockJSONCache::Kind::BLOCK_TXIDS));
+    cache.Put(hashes[3], BlockJSONCache::Kind::BLOCK_TXIDS, TxidsJSON(10));
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() <= entry_usage * 3);
+    BOOST_CHECK(cache.Get(hashes[0], BlockJSONCache::Kind::BLOCK_TXIDS));
+    BOOST_CHECK(!cache.Get(hashes[1], BlockJSONCache::Kind::BLOCK_TXIDS));
+    BOOST_CHECK(cache.Get(hashes[2], BlockJSONCache::Kind::BLOCK_TXIDS));
+    BOOST_CHECK(cache.Get(hashes[3], BlockJSONCache::Kind::BLOCK_TXIDS));
+
+    // A value larger than the whole cache is returned but not kept
+    auto value = cache.Put(InsecureRand256(), BlockJSONCache::Kind::BLOCK_TXS, TxidsJSON(100));
+    BOOST_CHECK_EQUAL(value->size(), 100U);
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -317,6 +317,50 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(LargeMempoolRoundTripTest)
+{
+    // Enough transactions for the mempool to be scanned on the short ID scan threads
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig.resize(10);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 42;
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(tx));
+    block.nVersion = 42;
+    block.hashPrevBlock = InsecureRand256();
+    block.nBits = 0x207fffff;
+
+    LOCK2(cs_main, pool.cs);
+    for (size_t i = 0; i < MIN_PARALLEL_SHORTID_SCAN * 2; i++) {
+        tx.vin[0].prevout.hash = InsecureRand256();
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        pool.addUnchecked(entry.FromTx(ptx));
+        // Pick transactions from all over the mempool, which is scanned in the order of vTxHashes
+        if (i % 97 == 0) block.vtx.push_back(ptx);
+    }
+    bool mutated;
+    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    assert(!mutated);
+    // FillBlock checks the proof of work of a block whose parent is unknown, i.e. at height 0
+    const bool lyra2rev2 = 0 >= Params().SwitchLyra2REv2_DGWblock();
+    while (!CheckProofOfWork(block.GetPoWHash(lyra2rev2), block.nBits, Params().GetConsensus())) ++block.nNonce;
+
+    CBlockHeaderAndShortTxIDs shortIDs(block, true);
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(shortIDs, extra_txn) == READ_STATUS_OK);
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        BOOST_CHECK(partialBlock.IsTxAvailable(i));
+    }
+    CBlock block2;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+    BOOST_CHECK_EQUAL(block.hashMerkleRoot.ToString(), BlockMerkleRoot(block2, &mutated).ToString());
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
@@ -531,4 +531,51 @@ BOOST_AUTO_TEST_CASE(rolling_bloom)
     g_mock_deterministic_tests = false;
 }
 
+BOOST_AUTO_TEST_CASE(blocked_rolling_bloom)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    g_mock_deterministic_tests = true;
+
+    // Same guarantees as CRollingBloomFilter: the last 100 entries are
+    // always remembered, with at most 1% false positives.
+    CBlockedRollingBloomFilter rb1(100, 0.01);
+    static const int DATASIZE=399;
+    std::vector<unsigned char> data[DATASIZE];
+    for (int i = 0; i < DATASIZE; i++) {
+        data[i] = RandomData();
+        if (i >= 100) BOOST_CHECK(rb1.contains(data[i-100]));
+        rb1.insert(data[i]);
+        BOOST_CHECK(rb1.contains(data[i]));
+    }
+    // Worst case: the filter holds three full generations.
+    unsigned int nHits = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (rb1.contains(RandomData()))
+            ++nHits;
+    }
+    BOOST_CHECK(nHits < 1000);
+
+    BOOST_CHECK(rb1.contains(data[DATASIZE-1]));
+    rb1.reset();
+    BOOST_CHECK(!rb1.contains(data[DATASIZE-1]));
+
+    // uint256 keys, at the rate used for per-peer inventory filters.
+    CBlockedRollingBloomFilter rb2(5000, 0.000001);
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 7499; i++) {
+        hashes.push_back(InsecureRand256());
+        rb2.insert(hashes.back());
+    }
+    for (int i = 7499 - 5000; i < 7499; i++) {
+        BOOST_CHECK(rb2.contains(hashes[i]));
+    }
+    nHits = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (rb2.contains(InsecureRand256()))
+            ++nHits;
+    }
+    BOOST_CHECK(nHits <= 1);
+    g_mock_deterministic_tests = false;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
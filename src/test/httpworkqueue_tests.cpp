@@ -0,0 +1,191 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <httpworkqueue.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(httpworkqueue_tests, BasicTestingSetup)
+
+namespace {
+
+struct TestItem {
+    std::function<void()> func;
+    void operator()() { func(); }
+};
+
+/** Records the order work items run in, and interrupts the queue after the last one */
+class Recorder
+{
+public:
+    Recorder(WorkQueue<TestItem>& queue, size_t expected) : m_queue(queue), m_expected(expected) {}
+
+    TestItem* Item(const std::string& name, std::function<void()> before = nullptr, std::function<void()> after = nullptr)
+    {
+        return new TestItem{[this, name, before, after] {
+            if (before) before();
+            {
+                LOCK(m_mutex);
+                m_order.push_back(name);
+                if (m_order.size() == m_expected) m_queue.Interrupt();
+            }
+            if (after) after();
+        }};
+    }
+
+    std::vector<std::string> Order()
+    {
+        LOCK(m_mutex);
+        return m_order;
+    }
+
+private:
+    WorkQueue<TestItem>& m_queue;
+    const size_t m_expected;
+    Mutex m_mutex;
+    std::vector<std::string> m_order GUARDED_BY(m_mutex);
+};
+
+bool Enqueue(WorkQueue<TestItem>& queue, TestItem* item, const std::string& client, bool priority, std::unique_ptr<TestItem>& dropped)
+{
+    std::unique_ptr<TestItem> owned(item);
+    if (!queue.Enqueue(owned.get(), client, priority, dropped)) return false;
+    owned.release();
+    return true;
+}
+
+bool Enqueue(WorkQueue<TestItem>& queue, TestItem* item, const std::string& client, bool priority = false)
+{
+    std::unique_ptr<TestItem> dropped;
+    const bool res = Enqueue(queue, item, client, priority, dropped);
+    BOOST_CHECK(!dropped);
+    return res;
+}
+
+void RunWorkers(WorkQueue<TestItem>& queue, int count)
+{
+    std::vector<std::thread> workers;
+    for (int i = 0; i < count; ++i) {
+        workers.emplace_back([&queue] { queue.Run(); });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(clients_take_turns)
+{
+    WorkQueue<TestItem> queue(10, 1);
+    Recorder recorder(queue, 6);
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a1"), "a"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a2"), "a"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a3"), "a"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("b1"), "b"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("c1"), "c"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("c2"), "c"));
+
+    const HTTPWorkQueueStats stats = queue.GetStats();
+    BOOST_CHECK_EQUAL(stats.depth, 6U);
+    BOOST_CHECK_EQUAL(stats.clients, 3U);
+
+    RunWorkers(queue, 1);
+    BOOST_CHECK(recorder.Order() == std::vector<std::string>({"a1", "b1", "c1", "a2", "c2", "a3"}));
+    BOOST_CHECK_EQUAL(queue.GetStats().served, 6U);
+}
+
+BOOST_AUTO_TEST_CASE(full_queue_drops_from_longest_client)
+{
+    WorkQueue<TestItem> queue(3, 1);
+    Recorder recorder(queue, 4);
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a1"), "a"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a2"), "a"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a3"), "a"));
+
+    // b has fewer items than a would have after dropping one: a's newest makes room
+    std::unique_ptr<TestItem> dropped;
+    BOOST_CHECK(Enqueue(queue, recorder.Item("b1"), "b", false, dropped));
+    BOOST_CHECK(dropped);
+
+    // Neither client can take the place of the other any more
+    BOOST_CHECK(!Enqueue(queue, recorder.Item("b2"), "b"));
+    BOOST_CHECK(!Enqueue(queue, recorder.Item("a4"), "a"));
+
+    // Priority items have a queue of their own
+    BOOST_CHECK(Enqueue(queue, recorder.Item("p1"), "c", true));
+
+    HTTPWorkQueueStats stats = queue.GetStats();
+    BOOST_CHECK_EQUAL(stats.depth, 3U);
+    BOOST_CHECK_EQUAL(stats.priority_depth, 1U);
+    BOOST_CHECK_EQUAL(stats.dropped, 1U);
+
+    RunWorkers(queue, 1);
+    BOOST_CHECK(recorder.Order() == std::vector<std::string>({"p1", "a1", "b1", "a2"}));
+}
+
+BOOST_AUTO_TEST_CASE(priority_items_first)
+{
+    WorkQueue<TestItem> queue(2, 1);
+    Recorder recorder(queue, 4);
+    BOOST_CHECK(Enqueue(queue, recorder.Item("a1"), "a"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("b1"), "b"));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("p1"), "b", true));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("p2"), "a", true));
+    BOOST_CHECK(!Enqueue(queue, recorder.Item("p3"), "a", true));
+    BOOST_CHECK_EQUAL(queue.GetStats().rejected, 1U);
+
+    RunWorkers(queue, 1);
+    BOOST_CHECK(recorder.Order() == std::vector<std::string>({"p1", "p2", "a1", "b1"}));
+    const HTTPWorkQueueStats stats = queue.GetStats();
+    BOOST_CHECK_EQUAL(stats.priority_served, 2U);
+    BOOST_CHECK_EQUAL(stats.served, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(priority_items_share_of_workers)
+{
+    // With two workers and one allowed to run priority items, a blocked
+    // priority item leaves the other worker to the other items.
+    WorkQueue<TestItem> queue(10, 1);
+    Recorder recorder(queue, 3);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    BOOST_CHECK(Enqueue(queue, recorder.Item("p1", [released] { released.wait(); }), "a", true));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("p2"), "a", true));
+    BOOST_CHECK(Enqueue(queue, recorder.Item("b1", nullptr, [&release] { release.set_value(); }), "b"));
+
+    RunWorkers(queue, 2);
+    BOOST_CHECK(recorder.Order() == std::vector<std::string>({"b1", "p1", "p2"}));
+}
+
+BOOST_AUTO_TEST_CASE(helper_items_only_when_idle)
+{
+    WorkQueue<TestItem> queue(10, 1);
+    Recorder recorder(queue, 1);
+    std::unique_ptr<TestItem> item(recorder.Item("h1"));
+    BOOST_CHECK(!queue.EnqueueIfIdle(item.get()));
+
+    std::thread worker([&queue] { queue.Run(); });
+    while (!queue.EnqueueIfIdle(item.get())) {
+        std::this_thread::yield();
+    }
+    item.release();
+    worker.join();
+
+    BOOST_CHECK(recorder.Order() == std::vector<std::string>({"h1"}));
+    const HTTPWorkQueueStats stats = queue.GetStats();
+    BOOST_CHECK_EQUAL(stats.helpers_served, 1U);
+    BOOST_CHECK_EQUAL(stats.priority_served, 0U);
+    BOOST_CHECK_EQUAL(stats.served, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
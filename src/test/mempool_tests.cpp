@@ -10,6 +10,7 @@
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -575,6 +576,49 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolSizeLimitManyPackagesTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // 100 independent transactions of equal size and increasing feerate
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < 100; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(1);
+        tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        tx.vout[0].nValue = 10 * COIN;
+        txs.push_back(MakeTransactionRef(tx));
+        pool.addUnchecked(entry.Fee(1000 * (i + 1)).FromTx(txs.back()));
+    }
+
+    const size_t limit = pool.DynamicMemoryUsage() / 2;
+    std::vector<COutPoint> no_spends_remaining;
+    pool.TrimToSize(limit, &no_spends_remaining);
+    BOOST_CHECK(pool.DynamicMemoryUsage() <= limit);
+
+    // Exactly the lowest feerate transactions were evicted
+    size_t evicted = 0;
+    while (evicted < txs.size() && !pool.exists(txs[evicted]->GetHash())) evicted++;
+    BOOST_CHECK(evicted > 0);
+    BOOST_CHECK_EQUAL(pool.size(), txs.size() - evicted);
+    BOOST_CHECK_EQUAL(no_spends_remaining.size(), evicted);
+    for (size_t i = 0; i < evicted; i++) {
+        BOOST_CHECK(std::find(no_spends_remaining.begin(), no_spends_remaining.end(), txs[i]->vin[0].prevout) != no_spends_remaining.end());
+    }
+
+    // Evicting the last of them was necessary to get within the limit
+    pool.addUnchecked(entry.Fee(1000 * evicted).FromTx(txs[evicted - 1]));
+    BOOST_CHECK(pool.DynamicMemoryUsage() > limit);
+
+    CFeeRate maxFeeRateRemoved(1000 * evicted, GetVirtualTransactionSize(*txs[evicted - 1]));
+    BOOST_CHECK_EQUAL(pool.GetMinFee(1).GetFeePerK(), maxFeeRateRemoved.GetFeePerK() + 1000);
+}
+
 inline CTransactionRef make_tx(std::vector<CAmount>&& output_values, std::vector<CTransactionRef>&& inputs=std::vector<CTransactionRef>(), std::vector<uint32_t>&& input_indices=std::vector<uint32_t>())
 {
     CMutableTransaction tx = CMutableTransaction();
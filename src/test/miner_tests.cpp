@@ -386,8 +386,8 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     }
     BOOST_CHECK(pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey));
     // Extend to a 210000-long block chain.
-    while (chainActive.Tip()->nHeight < 105120000) {
-        CBlockIndex* prev = chainActive.Tip();
+    while (::ChainActive().Tip()->nHeight < 105120000) {
+        CBlockIndex* prev = ::ChainActive().Tip();
         CBlockIndex* next = new CBlockIndex();
         next->phashBlock = new uint256(InsecureRand256());
         ::ChainstateActive().CoinsTip().SetBestBlock(next->GetBlockHash());
@@ -526,4 +526,45 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(GetBlockTemplateDiff_changes)
+{
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+    coinbase.vout[0].nValue = 50 * COIN;
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < 5; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = COIN;
+        txs.push_back(MakeTransactionRef(tx));
+    }
+
+    CBlock block;
+    block.vtx = {MakeTransactionRef(coinbase), txs[0], txs[1], txs[2]};
+    const std::vector<uint256> old_txids = GetBlockTemplateTxids(block);
+    BOOST_CHECK(old_txids == std::vector<uint256>({txs[0]->GetHash(), txs[1]->GetHash(), txs[2]->GetHash()}));
+
+    BlockTemplateDiff diff = GetBlockTemplateDiff(old_txids, block);
+    BOOST_CHECK(diff.added.empty());
+    BOOST_CHECK(diff.removed.empty());
+
+    // A transaction replaced by another one, which is reported by its position in the block
+    block.vtx = {MakeTransactionRef(coinbase), txs[1], txs[3], txs[2]};
+    diff = GetBlockTemplateDiff(old_txids, block);
+    BOOST_CHECK(diff.added == std::vector<size_t>({2}));
+    BOOST_CHECK(diff.removed == std::vector<uint256>({txs[0]->GetHash()}));
+
+    // On a new tip, the transactions mined in its block are gone from the template
+    block.hashPrevBlock = InsecureRand256();
+    coinbase.vout[0].nValue = 25 * COIN;
+    block.vtx = {MakeTransactionRef(coinbase), txs[4]};
+    diff = GetBlockTemplateDiff(old_txids, block);
+    BOOST_CHECK(diff.added == std::vector<size_t>({1}));
+    BOOST_CHECK(diff.removed == old_txids);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,12 +12,22 @@
 #include <streams.h>
 #include <net.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
 #include <chainparams.h>
 #include <util/memory.h>
 #include <util/system.h>
 #include <util/string.h>
+#include <test/util/net.h>
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -319,4 +329,229 @@ BOOST_AUTO_TEST_CASE(PoissonNextSend)
     g_mock_deterministic_tests = false;
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(socket_events_route_to_node)
+{
+    std::vector<SocketEventsMode> modes{SocketEventsMode::SELECT};
+#ifdef USE_POLL
+    modes.push_back(SocketEventsMode::POLL);
+#endif
+#ifdef USE_EPOLL
+    modes.push_back(SocketEventsMode::EPOLL);
+#endif
+    for (const SocketEventsMode mode : modes) {
+        ConnmanTestMsg connman(0x1337, 0x1337);
+        connman.SetSocketEventsMode(mode);
+        BOOST_CHECK(connman.GetSocketEventsMode() == mode);
+
+        std::vector<CNode*> nodes;
+        std::vector<int> remotes;
+        for (NodeId id = 0; id < 3; ++id) {
+            int fds[2];
+            BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+            CNode* node = new CNode(id, NODE_NETWORK, 0, fds[0], CAddress(), 0, 0, CAddress(), "", false);
+            connman.AddTestNode(*node);
+            nodes.push_back(node);
+            remotes.push_back(fds[1]);
+        }
+
+        const CNetMsgMaker msg_maker(INIT_PROTO_VERSION);
+        auto send_ping = [&](size_t i) {
+            CSerializedNetMsg msg = msg_maker.Make(NetMsgType::PING, uint64_t{i});
+            const std::vector<unsigned char> wire = connman.SerializeForWire(*nodes[i], msg);
+            BOOST_REQUIRE(write(remotes[i], wire.data(), wire.size()) == (ssize_t)wire.size());
+        };
+
+        // Data reaches the node it was written to, and only that one; later
+        // writes to the same socket are reported again (edge-triggered
+        // registrations must be re-armed by draining the socket).
+        for (int round = 0; round < 2; ++round) {
+            send_ping(1);
+            connman.SocketHandlerOnce();
+            BOOST_CHECK_EQUAL(connman.PopReceivedMsgs(*nodes[0]), 0U);
+            BOOST_CHECK_EQUAL(connman.PopReceivedMsgs(*nodes[1]), 1U);
+            BOOST_CHECK_EQUAL(connman.PopReceivedMsgs(*nodes[2]), 0U);
+        }
+
+        // Data arriving while receiving is paused (the default flood size of
+        // zero pauses after every message) is read once it resumes.
+        send_ping(2);
+        connman.SocketHandlerOnce();
+        send_ping(2);
+        connman.SocketHandlerOnce();
+        BOOST_CHECK_EQUAL(connman.PopReceivedMsgs(*nodes[2]), 1U);
+        connman.SocketHandlerOnce();
+        BOOST_CHECK_EQUAL(connman.PopReceivedMsgs(*nodes[2]), 1U);
+
+        // A remote hangup disconnects the node.
+        close(remotes[0]);
+        remotes[0] = -1;
+        connman.SocketHandlerOnce();
+        BOOST_CHECK(nodes[0]->fDisconnect);
+        BOOST_CHECK(!nodes[1]->fDisconnect);
+
+        connman.ClearTestNodes();
+        for (int fd : remotes) {
+            if (fd != -1) close(fd);
+        }
+    }
+}
+#endif
+
+namespace {
+/** Records how message processing calls for each node overlap */
+class ConcurrencyTracker : public NetEventsInterface
+{
+public:
+    std::mutex m_mutex;
+    std::map<NodeId, int> m_active;
+    std::map<NodeId, int> m_calls;
+    int m_running{0};
+    int m_max_running{0};
+    bool m_overlap{false};
+
+    bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_active[pnode->GetId()]++ > 0) m_overlap = true;
+            ++m_calls[pnode->GetId()];
+            m_max_running = std::max(m_max_running, ++m_running);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active[pnode->GetId()];
+            --m_running;
+        }
+        return true;
+    }
+    bool SendMessages(CNode* pnode) override { return true; }
+    void InitializeNode(CNode* pnode) override {}
+    void FinalizeNode(NodeId id, bool& update_connection_time) override {}
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(message_handler_threads)
+{
+    ConcurrencyTracker tracker;
+    ConnmanTestMsg connman(0x1337, 0x1337);
+    CConnman::Options options;
+    options.m_msgproc = &tracker;
+    connman.Init(options);
+    connman.StartMessageHandlerWorkers(4);
+
+    const int NUM_NODES = 12;
+    for (NodeId id = 0; id < NUM_NODES; ++id) {
+        connman.AddTestNode(*new CNode(id, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(), 0, 0, CAddress(), "", false));
+    }
+
+    const int NUM_ROUNDS = 3;
+    for (int round = 0; round < NUM_ROUNDS; ++round) {
+        BOOST_CHECK(connman.ProcessMessagesRoundOnce());
+    }
+
+    // Every node is processed once per round, never by two threads at once,
+    // while different nodes are processed in parallel.
+    {
+        std::lock_guard<std::mutex> lock(tracker.m_mutex);
+        for (NodeId id = 0; id < NUM_NODES; ++id) {
+            BOOST_CHECK_EQUAL(tracker.m_calls[id], NUM_ROUNDS);
+        }
+        BOOST_CHECK(!tracker.m_overlap);
+        BOOST_CHECK_EQUAL(tracker.m_running, 0);
+        BOOST_CHECK(tracker.m_max_running > 1);
+    }
+
+    connman.Interrupt();
+    connman.StopThreads();
+    connman.ClearTestNodes();
+}
+
+BOOST_AUTO_TEST_CASE(send_buffer)
+{
+    SendBufferPool pool(2);
+    const size_t SEGMENT_SIZE = SendBufferPool::SEGMENT_SIZE;
+    std::vector<unsigned char> expected;
+    {
+        SendBuffer buffer(pool);
+        BOOST_CHECK(buffer.empty());
+
+        // Small messages are packed into shared segments.
+        for (int i = 0; i < 1000; ++i) {
+            std::vector<unsigned char> msg(61, (unsigned char)i);
+            expected.insert(expected.end(), msg.begin(), msg.end());
+            buffer.Append(std::move(msg));
+        }
+        BOOST_CHECK_EQUAL(buffer.size(), expected.size());
+        BOOST_CHECK_EQUAL(buffer.ChunkCount(), (expected.size() + SEGMENT_SIZE - 1) / SEGMENT_SIZE);
+
+        // Large payloads are queued without copying.
+        std::vector<unsigned char> large(SEGMENT_SIZE * 3, 0xab);
+        const unsigned char* large_data = large.data();
+        expected.insert(expected.end(), large.begin(), large.end());
+        buffer.Append(std::move(large));
+        BOOST_CHECK_EQUAL(buffer.size(), expected.size());
+
+        std::vector<Span<const unsigned char>> chunks(buffer.ChunkCount());
+        BOOST_CHECK_EQUAL(buffer.Peek(chunks.data(), chunks.size()), chunks.size());
+        BOOST_CHECK(chunks.back().data() == large_data);
+
+        // Consume in uneven steps, checking the remaining data each time.
+        size_t consumed = 0;
+        while (!buffer.empty()) {
+            const size_t n = std::min<size_t>(buffer.size(), 7000);
+            buffer.Consume(n);
+            consumed += n;
+            std::vector<unsigned char> remaining;
+            BOOST_REQUIRE(buffer.Peek(chunks.data(), chunks.size()) == buffer.ChunkCount());
+            for (size_t i = 0; i < buffer.ChunkCount(); ++i) {
+                remaining.insert(remaining.end(), chunks[i].begin(), chunks[i].end());
+            }
+            BOOST_CHECK(remaining == std::vector<unsigned char>(expected.begin() + consumed, expected.end()));
+        }
+        // Drained segments went back to the (capped) pool.
+        BOOST_CHECK_EQUAL(pool.FreeCount(), 2U);
+
+        buffer.Append(std::vector<unsigned char>(10, 1));
+        BOOST_CHECK_EQUAL(pool.FreeCount(), 1U);
+    }
+    // Destroying a buffer returns its segments too.
+    BOOST_CHECK_EQUAL(pool.FreeCount(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(recv_buffer_pool)
+{
+    RecvBufferPool pool(64 * 1024);
+    {
+        // Buffers are rounded up to their size class and reused.
+        CDataStream stream = pool.Get(3000, SER_NETWORK, PROTOCOL_VERSION);
+        BOOST_CHECK(stream.empty());
+        BOOST_CHECK(stream.capacity() >= 4096);
+        stream << std::vector<unsigned char>(3000, 1);
+        const char* data = stream.data();
+        pool.Put(std::move(stream));
+        BOOST_CHECK_EQUAL(pool.FreeCount(), 1U);
+        CDataStream reused = pool.Get(2500, SER_DISK, 1);
+        BOOST_CHECK(reused.empty());
+        BOOST_CHECK(reused.data() == data);
+        BOOST_CHECK_EQUAL(reused.GetType(), SER_DISK);
+        BOOST_CHECK_EQUAL(pool.FreeCount(), 0U);
+    }
+    // Tiny and oversized buffers aren't pooled.
+    pool.Put(pool.Get(10, SER_NETWORK, PROTOCOL_VERSION));
+    pool.Put(pool.Get(RecvBufferPool::MAX_POOLED_SIZE + 1, SER_NETWORK, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(pool.FreeCount(), 0U);
+    // Each class keeps at most 64 KiB, but always one buffer.
+    for (int i = 0; i < 20; ++i) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream.reserve(4096);
+        pool.Put(std::move(stream));
+    }
+    BOOST_CHECK_EQUAL(pool.FreeCount(), 16U);
+    pool.Put(pool.Get(1024 * 1024, SER_NETWORK, PROTOCOL_VERSION));
+    pool.Put(pool.Get(1024 * 1024, SER_NETWORK, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(pool.FreeCount(), 17U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <uint256.h>
+#include <util/system.h>
 #include <util/time.h>
 
 #include <test/util/setup_common.h>
@@ -178,6 +181,29 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     for (int i = 2; i < 9; i++) { // At 9, the original estimate was already at the bottom (b/c scale = 2)
         BOOST_CHECK(feeEst.estimateFee(i).GetFeePerK() < origFeeEst[i-1] - deltaFee);
     }
+
+    // Repeated smart fee queries are answered consistently, and the estimates
+    // survive a round trip through the estimates file
+    const fs::path est_path = GetDataDir() / "fee_estimates_test.dat";
+    {
+        CAutoFile est_file(fsbridge::fopen(est_path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEst.Write(est_file));
+    }
+    CBlockPolicyEstimator feeEstRead;
+    {
+        CAutoFile est_file(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEstRead.Read(est_file));
+    }
+    for (int i = 1; i <= 48; i++) {
+        for (bool conservative : {false, true}) {
+            FeeCalculation calc1, calc2;
+            const CFeeRate est = feeEst.estimateSmartFee(i, &calc1, conservative);
+            BOOST_CHECK(est == feeEst.estimateSmartFee(i, &calc2, conservative));
+            BOOST_CHECK(calc1.returnedTarget == calc2.returnedTarget);
+            BOOST_CHECK(calc1.reason == calc2.reason);
+            BOOST_CHECK(est == feeEstRead.estimateSmartFee(i, nullptr, conservative));
+        }
+    }
 }
 
 BOOST_AUTO_TEST_SUITE_END()
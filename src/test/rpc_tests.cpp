@@ -4,17 +4,22 @@
 
 #include <rpc/server.h>
 #include <rpc/client.h>
+#include <rpc/jsonstream.h>
 #include <rpc/util.h>
 
+#include <chainparams.h>
 #include <core_io.h>
 #include <interfaces/chain.h>
 #include <node/context.h>
 #include <test/util/setup_common.h>
+#include <txmempool.h>
 #include <util/time.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <thread>
+
 #include <univalue.h>
 
 #include <rpc/blockchain.h>
@@ -413,4 +418,133 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_AUTO_TEST_CASE(json_stream_writer)
+{
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("a", 1);
+    expected.pushKV("escaped \"key\"\n", "value\twith\\escapes");
+    expected.pushKV("empty_array", UniValue(UniValue::VARR));
+    expected.pushKV("empty_object", UniValue(UniValue::VOBJ));
+    UniValue array(UniValue::VARR);
+    array.push_back(NullUniValue);
+    array.push_back(true);
+    array.push_back(ValueFromAmount(123456789));
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("x", "y");
+    array.push_back(inner);
+    array.push_back(UniValue(UniValue::VARR));
+    expected.pushKV("array", array);
+
+    // Flushing after every value hands out many pieces, which must add up
+    // to the same text.
+    std::string text;
+    int pieces = 0;
+    JSONStreamWriter writer([&](const std::string& piece) {
+        BOOST_CHECK(!piece.empty());
+        text += piece;
+        ++pieces;
+    }, 1);
+    writer.BeginObject();
+    writer.KeyValue("a", 1);
+    writer.KeyValue("escaped \"key\"\n", "value\twith\\escapes");
+    writer.Key("empty_array");
+    writer.BeginArray();
+    writer.EndArray();
+    writer.Key("empty_object");
+    writer.BeginObject();
+    writer.EndObject();
+    writer.Key("array");
+    writer.BeginArray();
+    for (const UniValue& value : array.getValues()) {
+        writer.Value(value);
+    }
+    writer.EndArray();
+    writer.EndObject();
+    writer.Flush();
+    BOOST_CHECK_EQUAL(text, expected.write());
+    BOOST_CHECK(pieces > 1);
+}
+
+static std::string CallStreamingRPC(const std::string& args)
+{
+    std::vector<std::string> vArgs;
+    boost::split(vArgs, args, boost::is_any_of(" \t"));
+    JSONRPCRequest request;
+    request.strMethod = vArgs[0];
+    vArgs.erase(vArgs.begin());
+    request.params = RPCConvertValues(request.strMethod, vArgs);
+    RPCResultWriter result_writer;
+    request.result_writer = &result_writer;
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    const UniValue result = tableRPC.execute(request);
+    if (!result_writer) return result.write();
+    BOOST_CHECK(result.isNull());
+    std::string text;
+    JSONStreamWriter writer([&](const std::string& piece) { text += piece; }, 100);
+    result_writer(writer);
+    writer.Flush();
+    return text;
+}
+
+BOOST_AUTO_TEST_CASE(rpc_stream_results)
+{
+    const std::string hash = Params().GenesisBlock().GetHash().GetHex();
+    for (const std::string& verbosity : {"0", "1", "2"}) {
+        BOOST_CHECK_EQUAL(CallStreamingRPC("getblock " + hash + " " + verbosity), CallRPC("getblock " + hash + " " + verbosity).write());
+    }
+    BOOST_CHECK_THROW(CallStreamingRPC("getblock 0000000000000000000000000000000000000000000000000000000000000000 2"), UniValue);
+
+    {
+        LOCK2(cs_main, m_node.mempool->cs);
+        TestMemPoolEntryHelper entry;
+        for (int i = 0; i < 3; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].scriptSig = CScript() << i;
+            tx.vout.resize(1);
+            tx.vout[0].nValue = i;
+            m_node.mempool->addUnchecked(entry.Fee(1000 + i).FromTx(tx));
+        }
+    }
+    BOOST_CHECK_EQUAL(CallStreamingRPC("getrawmempool true"), CallRPC("getrawmempool true").write());
+    LOCK(m_node.mempool->cs);
+    m_node.mempool->clear();
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_threads)
+{
+    if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 50; ++i) {
+        UniValue call(UniValue::VOBJ);
+        UniValue params(UniValue::VARR);
+        call.pushKV("id", i);
+        if (i % 3 == 0) {
+            call.pushKV("method", "getblockcount");
+        } else if (i % 3 == 1) {
+            call.pushKV("method", "getblockhash");
+            params.push_back(0);
+        } else {
+            call.pushKV("method", "nosuchmethod");
+        }
+        call.pushKV("params", params);
+        batch.push_back(call);
+    }
+    const JSONRPCRequest jreq;
+    const std::string sequential = JSONRPCExecBatch(jreq, batch);
+
+    // Replies come back in the order of the calls.
+    std::vector<std::thread> threads;
+    const RPCTaskRunner run_task = [&](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+        return true;
+    };
+    BOOST_CHECK_EQUAL(JSONRPCExecBatch(jreq, batch, run_task, 4), sequential);
+    for (std::thread& thread : threads) thread.join();
+    BOOST_CHECK_EQUAL(threads.size(), 3U);
+
+    // The batch completes even if no other thread can be used.
+    BOOST_CHECK_EQUAL(JSONRPCExecBatch(jreq, batch, [](std::function<void()>) { return false; }, 4), sequential);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
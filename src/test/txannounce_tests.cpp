@@ -0,0 +1,138 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <test/util/setup_common.h>
+#include <txannounce.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txannounce_tests, BasicTestingSetup)
+
+static uint256 TxId(uint64_t n)
+{
+    return ArithToUint256(arith_uint256(n));
+}
+
+static std::vector<uint256> TxIds(const std::vector<TxAnnouncementQueue::Entry>& entries)
+{
+    std::vector<uint256> txids;
+    for (const auto& entry : entries) txids.push_back(entry.txid);
+    return txids;
+}
+
+BOOST_AUTO_TEST_CASE(rank_order)
+{
+    using Entry = TxAnnouncementQueue::Entry;
+    std::vector<Entry> entries{
+        {TxId(1), 2, 10000, 100, 0}, // child, high feerate
+        {TxId(2), 1, 1000, 100, 1},  // low feerate
+        {TxId(3), 1, 5000, 250, 2},  // 20 sat/vB
+        {TxId(4), 1, 2000, 100, 3},  // same feerate as 3, queued later
+    };
+    std::make_heap(entries.begin(), entries.end(), TxAnnouncementWorse());
+    std::vector<uint256> order;
+    while (!entries.empty()) {
+        std::pop_heap(entries.begin(), entries.end(), TxAnnouncementWorse());
+        order.push_back(entries.back().txid);
+        entries.pop_back();
+    }
+    BOOST_CHECK(order == std::vector<uint256>({TxId(3), TxId(4), TxId(2), TxId(1)}));
+}
+
+BOOST_AUTO_TEST_CASE(peer_cursors)
+{
+    TxAnnouncementQueue queue(100);
+    std::vector<TxAnnouncementQueue::Entry> taken;
+
+    // Nothing is queued without peers.
+    queue.Push(TxId(1), 1, 1000, 100);
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+
+    queue.AddPeer(0);
+    queue.Push(TxId(2), 1, 1000, 100);
+    queue.AddPeer(1);
+    queue.Push(TxId(3), 1, 1000, 100);
+    BOOST_CHECK_EQUAL(queue.Size(), 2U);
+
+    // Peers only get what was queued after they were added.
+    queue.Take(1, taken);
+    BOOST_CHECK(TxIds(taken) == std::vector<uint256>({TxId(3)}));
+    BOOST_CHECK_EQUAL(queue.Size(), 2U);
+    taken.clear();
+    queue.Take(0, taken);
+    BOOST_CHECK(TxIds(taken) == std::vector<uint256>({TxId(2), TxId(3)}));
+    // Both peers are past everything queued.
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+
+    // Entries given back are offered again, before newer ones.
+    queue.GiveBack(0, std::move(taken));
+    queue.Push(TxId(4), 1, 1000, 100);
+    taken.clear();
+    queue.Take(0, taken);
+    BOOST_CHECK(TxIds(taken) == std::vector<uint256>({TxId(2), TxId(3), TxId(4)}));
+    taken.clear();
+    queue.Take(0, taken);
+    BOOST_CHECK(taken.empty());
+
+    // A removed peer doesn't hold back the queue.
+    BOOST_CHECK_EQUAL(queue.Size(), 1U);
+    queue.RemovePeer(1);
+    BOOST_CHECK_EQUAL(queue.Size(), 0U);
+    queue.Take(1, taken);
+    BOOST_CHECK(taken.empty());
+}
+
+BOOST_AUTO_TEST_CASE(queue_limit)
+{
+    TxAnnouncementQueue queue(10);
+    queue.AddPeer(0);
+    queue.AddPeer(1);
+    for (uint64_t n = 0; n < 25; ++n) {
+        queue.Push(TxId(n), 1, 1000, 100);
+        if (n == 4) {
+            std::vector<TxAnnouncementQueue::Entry> taken;
+            queue.Take(1, taken);
+            BOOST_CHECK_EQUAL(taken.size(), 5U);
+        }
+    }
+    BOOST_CHECK_EQUAL(queue.Size(), 10U);
+
+    // Both peers fell behind and only get the newest entries.
+    for (NodeId peer = 0; peer < 2; ++peer) {
+        std::vector<TxAnnouncementQueue::Entry> taken;
+        queue.Take(peer, taken);
+        BOOST_REQUIRE_EQUAL(taken.size(), 10U);
+        BOOST_CHECK(taken.front().txid == TxId(15));
+        BOOST_CHECK(taken.back().txid == TxId(24));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unsent_limit)
+{
+    TxAnnouncementQueue queue(10);
+    queue.AddPeer(0);
+    std::vector<TxAnnouncementQueue::Entry> taken;
+    for (uint64_t n = 0; n < 10; ++n) queue.Push(TxId(n), 1, 1000, 100);
+    queue.Take(0, taken);
+    BOOST_CHECK_EQUAL(taken.size(), 10U);
+    queue.GiveBack(0, std::move(taken));
+
+    // Give back more than the limit: only the newest entries are kept.
+    for (uint64_t n = 10; n < 25; ++n) queue.Push(TxId(n), 1, 1000, 100);
+    taken.clear();
+    queue.Take(0, taken);
+    BOOST_CHECK_EQUAL(taken.size(), 20U);
+    queue.GiveBack(0, std::move(taken));
+    taken.clear();
+    queue.Take(0, taken);
+    BOOST_REQUIRE_EQUAL(taken.size(), 10U);
+    BOOST_CHECK(taken.front().txid == TxId(15));
+    BOOST_CHECK(taken.back().txid == TxId(24));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -37,3 +37,38 @@ bool ConnmanTestMsg::ReceiveMsgFrom(CNode& node, CSerializedNetMsg& ser_msg) con
     NodeReceiveMsgBytes(node, (const char*)ser_msg.data.data(), ser_msg.data.size(), complete);
     return complete;
 }
+
+size_t ConnmanTestMsg::PopReceivedMsgs(CNode& node) const
+{
+    LOCK(node.cs_vProcessMsg);
+    size_t count = node.vProcessMsg.size();
+    node.vProcessMsg.clear();
+    node.nProcessQueueSize = 0;
+    node.fPauseRecv = false;
+    return count;
+}
+
+std::vector<unsigned char> ConnmanTestMsg::SerializeForWire(CNode& node, CSerializedNetMsg& ser_msg) const
+{
+    std::vector<unsigned char> wire;
+    node.m_serializer->prepareForTransport(ser_msg, wire);
+    wire.insert(wire.end(), ser_msg.data.begin(), ser_msg.data.end());
+    return wire;
+}
+
+void ConnmanTestMsg::StartMessageHandlerWorkers(int threads)
+{
+    for (int i = 1; i < threads; ++i) {
+        m_message_handler_workers.emplace_back(&CConnman::ThreadMessageHandlerWorker, this);
+    }
+}
+
+bool ConnmanTestMsg::ProcessMessagesRoundOnce()
+{
+    std::vector<CNode*> nodes;
+    {
+        LOCK(cs_vNodes);
+        nodes = vNodes;
+    }
+    return ProcessMessagesRound(nodes);
+}
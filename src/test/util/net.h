@@ -13,11 +13,13 @@ struct ConnmanTestMsg : public CConnman {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(&node);
+        RegisterSocketEvents(&node);
     }
     void ClearTestNodes()
     {
         LOCK(cs_vNodes);
         for (CNode* node : vNodes) {
+            UnregisterSocketEvents(node);
             delete node;
         }
         vNodes.clear();
@@ -25,6 +27,34 @@ struct ConnmanTestMsg : public CConnman {
 
     void ProcessMessagesOnce(CNode& node) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
 
+    /** Select the socket events backend, as Start() would. Call before adding nodes. */
+    void SetSocketEventsMode(SocketEventsMode mode)
+    {
+        m_socket_events_mode = mode;
+        InitSocketEvents();
+    }
+    SocketEventsMode GetSocketEventsMode() const { return m_socket_events_mode; }
+
+    void SocketHandlerOnce() { SocketHandler(); }
+
+    /** Send as much of node's queued data as its socket accepts */
+    size_t FlushSendBuffer(CNode& node) const
+    {
+        LOCK(node.cs_vSend);
+        return SocketSendData(&node);
+    }
+
+    /** Start the extra message handler threads Start() would for -msghandlerthreads=threads */
+    void StartMessageHandlerWorkers(int threads);
+    /** Run one round of message processing over all test nodes */
+    bool ProcessMessagesRoundOnce();
+
+    /** Remove and count the messages the socket handler queued for processing */
+    size_t PopReceivedMsgs(CNode& node) const;
+
+    /** Serialize a message the way it is written to node's socket */
+    std::vector<unsigned char> SerializeForWire(CNode& node, CSerializedNetMsg& ser_msg) const;
+
     void NodeReceiveMsgBytes(CNode& node, const char* pch, unsigned int nBytes, bool& complete) const;
 
     bool ReceiveMsgFrom(CNode& node, CSerializedNetMsg& ser_msg) const;
@@ -5,6 +5,7 @@
 #include <test/util/setup_common.h>
 
 #include <banman.h>
+#include <blockencodings.h>
 #include <chainparams.h>
 #include <consensus/consensus.h>
 #include <consensus/params.h>
@@ -134,6 +135,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     }
     g_parallel_script_checks = true;
 
+    for (int i = 0; i < MAX_SHORTID_SCAN_THREADS - 1; ++i) {
+        threadGroup.create_thread([i]() { return ThreadShortIDScan(i); });
+    }
+
     m_node.mempool = &::mempool;
     m_node.mempool->setSanityCheck(1.0);
     m_node.banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
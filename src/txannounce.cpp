@@ -0,0 +1,103 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txannounce.h>
+
+#include <algorithm>
+
+bool TxAnnouncementQueue::Entry::IsBetterThan(const Entry& other) const
+{
+    if (ancestor_count != other.ancestor_count) return ancestor_count < other.ancestor_count;
+    // Compare feerates without dividing, as CompareTxMemPoolEntryByScore does.
+    const double f1 = (double)fee * other.vsize;
+    const double f2 = (double)other.fee * vsize;
+    if (f1 != f2) return f1 > f2;
+    return sequence < other.sequence;
+}
+
+void TxAnnouncementQueue::AddPeer(NodeId peer)
+{
+    LOCK(m_mutex);
+    if (m_peers.emplace(peer, PeerState{m_next_sequence, {}}).second) {
+        m_cursor_positions.insert(m_next_sequence);
+    }
+}
+
+void TxAnnouncementQueue::RemovePeer(NodeId peer)
+{
+    LOCK(m_mutex);
+    auto it = m_peers.find(peer);
+    if (it == m_peers.end()) return;
+    m_cursor_positions.erase(m_cursor_positions.find(it->second.cursor));
+    m_peers.erase(it);
+    Trim();
+}
+
+void TxAnnouncementQueue::Push(const uint256& txid, uint64_t ancestor_count, CAmount fee, int64_t vsize)
+{
+    LOCK(m_mutex);
+    // Nobody to announce to
+    if (m_peers.empty()) return;
+    m_entries.push_back(Entry{txid, ancestor_count, fee, vsize, m_next_sequence++});
+    // Peers that fell this far behind miss the oldest announcements.
+    if (m_entries.size() > m_max_entries) m_entries.pop_front();
+}
+
+void TxAnnouncementQueue::Take(NodeId peer, std::vector<Entry>& out)
+{
+    LOCK(m_mutex);
+    auto it = m_peers.find(peer);
+    if (it == m_peers.end()) return;
+    PeerState& state = it->second;
+    if (out.empty()) {
+        out.swap(state.unsent);
+    } else {
+        out.insert(out.end(), state.unsent.begin(), state.unsent.end());
+        state.unsent.clear();
+    }
+    if (state.cursor == m_next_sequence) return;
+
+    const uint64_t first_sequence = m_entries.empty() ? m_next_sequence : m_entries.front().sequence;
+    const uint64_t start = std::max(state.cursor, first_sequence);
+    out.insert(out.end(), m_entries.begin() + (start - first_sequence), m_entries.end());
+
+    m_cursor_positions.erase(m_cursor_positions.find(state.cursor));
+    state.cursor = m_next_sequence;
+    m_cursor_positions.insert(m_next_sequence);
+    Trim();
+}
+
+void TxAnnouncementQueue::GiveBack(NodeId peer, std::vector<Entry>&& entries)
+{
+    LOCK(m_mutex);
+    auto it = m_peers.find(peer);
+    if (it == m_peers.end()) return;
+    std::vector<Entry>& unsent = it->second.unsent;
+    if (unsent.empty()) {
+        unsent = std::move(entries);
+    } else {
+        unsent.insert(unsent.end(), entries.begin(), entries.end());
+    }
+    // Like the queue itself, a peer that falls this far behind misses the
+    // oldest announcements.
+    if (unsent.size() > m_max_entries) {
+        std::sort(unsent.begin(), unsent.end(), [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+        unsent.erase(unsent.begin(), unsent.end() - m_max_entries);
+    }
+}
+
+size_t TxAnnouncementQueue::Size() const
+{
+    LOCK(m_mutex);
+    return m_entries.size();
+}
+
+void TxAnnouncementQueue::Trim()
+{
+    AssertLockHeld(m_mutex);
+    const uint64_t oldest_cursor = m_cursor_positions.empty() ? m_next_sequence : *m_cursor_positions.begin();
+    while (!m_entries.empty() && m_entries.front().sequence < oldest_cursor) {
+        m_entries.pop_front();
+    }
+}
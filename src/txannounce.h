@@ -0,0 +1,89 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXANNOUNCE_H
+#define BITCOIN_TXANNOUNCE_H
+
+#include <amount.h>
+#include <net.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+/** Transactions to announce, shared by all peers we relay transactions to.
+ *
+ * Every relayed transaction is queued once, together with the rank it had
+ * in the mempool at that time (ancestor count, then feerate). Each peer
+ * only keeps a cursor into the queue, plus the entries it was offered but
+ * not sent because of the per-trickle limit. Relaying a transaction thus
+ * costs the same whatever the number of peers, and no mempool lookups are
+ * needed to order what a peer is sent. Entries are dropped once every
+ * peer's cursor has passed them, or when the queue grows beyond its limit.
+ */
+class TxAnnouncementQueue
+{
+public:
+    struct Entry {
+        uint256 txid;
+        uint64_t ancestor_count;
+        /** Modified fee and virtual size, as they were when queued */
+        CAmount fee;
+        int64_t vsize;
+        uint64_t sequence;
+
+        /** Whether this entry should be announced before other: fewer
+         *  ancestors first, then higher feerate, then queue order. */
+        bool IsBetterThan(const Entry& other) const;
+    };
+
+    explicit TxAnnouncementQueue(size_t max_entries) : m_max_entries(max_entries) {}
+
+    /** Start tracking a peer; it will be given what is queued from now on */
+    void AddPeer(NodeId peer);
+    void RemovePeer(NodeId peer);
+
+    /** Queue a transaction for announcement to all peers */
+    void Push(const uint256& txid, uint64_t ancestor_count, CAmount fee, int64_t vsize);
+
+    /** Append the entries the peer gave back last time and everything
+     *  queued since to out, and move its cursor to the end of the queue. */
+    void Take(NodeId peer, std::vector<Entry>& out);
+    /** Keep entries taken but not announced, to be offered again by the next
+     *  Take(). At most max_entries are kept per peer, dropping the oldest. */
+    void GiveBack(NodeId peer, std::vector<Entry>&& entries);
+
+    size_t Size() const;
+
+private:
+    void Trim() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    mutable Mutex m_mutex;
+    std::deque<Entry> m_entries GUARDED_BY(m_mutex);
+    /** Sequence number the next queued entry will get */
+    uint64_t m_next_sequence GUARDED_BY(m_mutex){0};
+    struct PeerState {
+        /** Sequence number of the next entry to give to the peer */
+        uint64_t cursor;
+        /** Entries given back, at most m_max_entries */
+        std::vector<Entry> unsent;
+    };
+    std::map<NodeId, PeerState> m_peers GUARDED_BY(m_mutex);
+    /** The cursors of all peers, sorted */
+    std::multiset<uint64_t> m_cursor_positions GUARDED_BY(m_mutex);
+    const size_t m_max_entries;
+};
+
+/** Heap comparator for TxAnnouncementQueue entries: the best entry is on top */
+struct TxAnnouncementWorse {
+    bool operator()(const TxAnnouncementQueue::Entry& a, const TxAnnouncementQueue::Entry& b) const
+    {
+        return b.IsBetterThan(a);
+    }
+};
+
+#endif // BITCOIN_TXANNOUNCE_H
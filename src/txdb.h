@@ -36,6 +36,12 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
+//! Max memory allocated to the script index cache in MiB.
+static const int64_t max_script_index_cache = 1024;
+//! Max memory allocated to the address index cache in MiB.
+static const int64_t max_addr_index_cache = 1024;
+//! Max memory allocated to the spent index cache in MiB.
+static const int64_t max_spent_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -56,6 +62,8 @@ public:
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
+    //! Cursor starting at the first coin not ordered before start
+    CCoinsViewCursor *Cursor(const COutPoint& start) const;
 
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
@@ -1021,41 +1021,84 @@ void CTxMemPool::trackPackageRemoved(const CFeeRate& rate) {
     }
 }
 
+size_t CTxMemPool::RemovalUsageUpperBound(txiter it) const
+{
+    // Matches the per-entry terms of DynamicMemoryUsage(); all containers
+    // involved account their usage linearly in the number of elements.
+    txlinksMap::const_iterator links = mapLinks.find(it);
+    assert(links != mapLinks.end());
+    size_t usage = memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) + it->DynamicMemoryUsage();
+    usage += memusage::DynamicUsage(links->second.parents) + memusage::DynamicUsage(links->second.children);
+    usage += memusage::DynamicUsage(mapLinks) / mapLinks.size();
+    if (!mapNextTx.empty()) {
+        usage += memusage::DynamicUsage(mapNextTx) / mapNextTx.size() * it->GetTx().vin.size();
+    }
+    return usage;
+}
+
 void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining) {
     AssertLockHeld(cs);
 
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
-    while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
-
-        // We set the new mempool min fee to the feerate of the removed set, plus the
-        // "minimum reasonable fee rate" (ie some value under which we consider txn
-        // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
-        // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
-        removed += incrementalRelayFee;
-        trackPackageRemoved(removed);
-        maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
-
+    size_t usage;
+    while (!mapTx.empty() && (usage = DynamicMemoryUsage()) > sizelimit) {
+        // Stage the lowest descendant score packages in a single pass over the
+        // index, and remove them together. This evicts exactly what removing
+        // them one at a time would, as long as:
+        // - no staged package has in-mempool ancestors outside the stage, as
+        //   removing it would change those ancestors' descendant scores, and
+        // - the memory released by the packages staged so far, which is
+        //   bounded from above by RemovalUsageUpperBound, cannot already bring
+        //   the mempool within sizelimit.
+        // A package violating the first condition is still evicted, but ends
+        // the pass.
         setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
-        nTxnRemoved += stage.size();
-
-        std::vector<CTransaction> txn;
-        if (pvNoSpendsRemaining) {
-            txn.reserve(stage.size());
-            for (txiter iter : stage)
-                txn.push_back(iter->GetTx());
+        std::vector<COutPoint> vNoSpendsRemaining;
+        size_t freed = 0;
+        bool stage_complete = false;
+        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        for (; !stage_complete && it != mapTx.get<descendant_score>().end() && usage > sizelimit + freed; ++it) {
+            txiter candidate = mapTx.project<0>(it);
+            if (stage.count(candidate)) continue;
+
+            // We set the new mempool min fee to the feerate of the removed set, plus the
+            // "minimum reasonable fee rate" (ie some value under which we consider txn
+            // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
+            // equal to txn which were removed with no block in between.
+            CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+            removed += incrementalRelayFee;
+            trackPackageRemoved(removed);
+            maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
+
+            setEntries package;
+            CalculateDescendants(candidate, package);
+            nTxnRemoved += package.size();
+            stage.insert(package.begin(), package.end());
+
+            for (txiter pit : package) {
+                freed += RemovalUsageUpperBound(pit);
+                for (txiter parent : GetMemPoolParents(pit)) {
+                    if (!stage.count(parent)) stage_complete = true;
+                }
+            }
+            // Removals may shrink vTxHashes, releasing more memory than accounted for
+            if ((vTxHashes.size() - stage.size()) * 2 < vTxHashes.capacity()) stage_complete = true;
+
+            if (pvNoSpendsRemaining) {
+                for (txiter pit : package) {
+                    for (const CTxIn& txin : pit->GetTx().vin) {
+                        txiter prev = mapTx.find(txin.prevout.hash);
+                        if (prev != mapTx.end() && !stage.count(prev)) continue;
+                        vNoSpendsRemaining.push_back(txin.prevout);
+                    }
+                }
+            }
         }
+
         RemoveStaged(stage, false, MemPoolRemovalReason::SIZELIMIT);
         if (pvNoSpendsRemaining) {
-            for (const CTransaction& tx : txn) {
-                for (const CTxIn& txin : tx.vin) {
-                    if (exists(txin.prevout.hash)) continue;
-                    pvNoSpendsRemaining->push_back(txin.prevout);
-                }
-            }
+            pvNoSpendsRemaining->insert(pvNoSpendsRemaining->end(), vNoSpendsRemaining.begin(), vNoSpendsRemaining.end());
         }
     }
 
@@ -549,6 +549,10 @@ private:
 
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** Upper bound on the DynamicMemoryUsage() released by removing this
+     *  entry, provided that its in-mempool parents are removed along with it. */
+    size_t RemovalUsageUpperBound(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
 public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
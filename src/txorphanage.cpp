@@ -0,0 +1,224 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txorphanage.h>
+
+#include <consensus/validation.h>
+#include <logging.h>
+#include <policy/policy.h>
+#include <random.h>
+#include <util/time.h>
+
+#include <algorithm>
+#include <cassert>
+
+RecursiveMutex g_cs_orphans;
+
+bool TxOrphanage::AddTx(const CTransactionRef& tx, NodeId peer)
+{
+    AssertLockHeld(g_cs_orphans);
+
+    const uint256& hash = tx->GetHash();
+    if (m_orphans.count(hash))
+        return false;
+
+    // Ignore big transactions, to avoid a
+    // send-big-orphans memory exhaustion attack. If a peer has a legitimate
+    // large transaction with a missing parent then we assume
+    // it will rebroadcast it later, after the parent transaction(s)
+    // have been mined or received.
+    // 100 orphans, each of which is at most 100,000 bytes big is
+    // at most 10 megabytes of orphans and somewhat more byprev index (in the worst case):
+    unsigned int sz = GetTransactionWeight(*tx);
+    if (sz > MAX_STANDARD_TX_WEIGHT)
+    {
+        LogPrint(BCLog::MEMPOOL, "ignoring large orphan tx (size: %u, hash: %s)\n", sz, hash.ToString());
+        return false;
+    }
+
+    std::vector<OrphanMap::iterator>& peer_orphans = m_peer_orphans[peer];
+    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, m_orphan_list.size(), peer_orphans.size()});
+    assert(ret.second);
+    m_orphan_list.push_back(ret.first);
+    peer_orphans.push_back(ret.first);
+    for (const CTxIn& txin : tx->vin) {
+        m_outpoint_to_orphan_it[txin.prevout].insert(ret.first);
+    }
+
+    LogPrint(BCLog::MEMPOOL, "stored orphan tx %s (mapsz %u outsz %u)\n", hash.ToString(),
+             m_orphans.size(), m_outpoint_to_orphan_it.size());
+    return true;
+}
+
+int TxOrphanage::EraseTx(const uint256& txid)
+{
+    AssertLockHeld(g_cs_orphans);
+
+    std::map<uint256, OrphanTx>::iterator it = m_orphans.find(txid);
+    if (it == m_orphans.end())
+        return 0;
+    for (const CTxIn& txin : it->second.tx->vin)
+    {
+        auto itPrev = m_outpoint_to_orphan_it.find(txin.prevout);
+        if (itPrev == m_outpoint_to_orphan_it.end())
+            continue;
+        itPrev->second.erase(it);
+        if (itPrev->second.empty())
+            m_outpoint_to_orphan_it.erase(itPrev);
+    }
+
+    size_t old_pos = it->second.list_pos;
+    assert(m_orphan_list[old_pos] == it);
+    if (old_pos + 1 != m_orphan_list.size()) {
+        // Unless we're deleting the last entry in m_orphan_list, move the last
+        // entry to the position we're deleting.
+        auto it_last = m_orphan_list.back();
+        m_orphan_list[old_pos] = it_last;
+        it_last->second.list_pos = old_pos;
+    }
+    m_orphan_list.pop_back();
+
+    // Same swap-and-pop for the announcing peer's list.
+    auto it_peer = m_peer_orphans.find(it->second.fromPeer);
+    assert(it_peer != m_peer_orphans.end());
+    std::vector<OrphanMap::iterator>& peer_orphans = it_peer->second;
+    size_t old_peer_pos = it->second.peer_pos;
+    assert(peer_orphans[old_peer_pos] == it);
+    if (old_peer_pos + 1 != peer_orphans.size()) {
+        auto it_last = peer_orphans.back();
+        peer_orphans[old_peer_pos] = it_last;
+        it_last->second.peer_pos = old_peer_pos;
+    }
+    peer_orphans.pop_back();
+    if (peer_orphans.empty()) m_peer_orphans.erase(it_peer);
+
+    m_orphans.erase(it);
+    return 1;
+}
+
+void TxOrphanage::EraseForPeer(NodeId peer)
+{
+    AssertLockHeld(g_cs_orphans);
+
+    auto it_peer = m_peer_orphans.find(peer);
+    if (it_peer == m_peer_orphans.end()) return;
+
+    // EraseTx() removes entries from the peer's list (and the list itself
+    // once it is empty), so work on a copy of the txids.
+    std::vector<uint256> txids;
+    txids.reserve(it_peer->second.size());
+    for (const auto& it : it_peer->second) {
+        txids.push_back(it->first);
+    }
+    int nErased = 0;
+    for (const uint256& txid : txids) {
+        nErased += EraseTx(txid);
+    }
+    if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
+}
+
+unsigned int TxOrphanage::LimitOrphans(unsigned int max_orphans)
+{
+    AssertLockHeld(g_cs_orphans);
+
+    unsigned int nEvicted = 0;
+    int64_t nNow = GetTime();
+    if (m_next_sweep <= nNow) {
+        // Sweep out expired orphan pool entries:
+        int nErased = 0;
+        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
+        std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
+        while (iter != m_orphans.end())
+        {
+            std::map<uint256, OrphanTx>::iterator maybeErase = iter++;
+            if (maybeErase->second.nTimeExpire <= nNow) {
+                nErased += EraseTx(maybeErase->first);
+            } else {
+                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
+            }
+        }
+        // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
+        m_next_sweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
+        if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx due to expiration\n", nErased);
+    }
+    FastRandomContext rng;
+    while (m_orphans.size() > max_orphans)
+    {
+        // Evict a random orphan:
+        size_t randompos = rng.randrange(m_orphan_list.size());
+        EraseTx(m_orphan_list[randompos]->first);
+        ++nEvicted;
+    }
+    return nEvicted;
+}
+
+void TxOrphanage::AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>& orphan_work_set) const
+{
+    AssertLockHeld(g_cs_orphans);
+
+    // Outpoints are ordered by txid first, so all outpoints spending this
+    // transaction form one contiguous range of the index, whatever the
+    // number of outputs it has.
+    const uint256& txid = tx.GetHash();
+    for (auto it_by_prev = m_outpoint_to_orphan_it.lower_bound(COutPoint(txid, 0));
+         it_by_prev != m_outpoint_to_orphan_it.end() && it_by_prev->first.hash == txid; ++it_by_prev) {
+        for (const auto& elem : it_by_prev->second) {
+            orphan_work_set.insert(elem->first);
+        }
+    }
+}
+
+bool TxOrphanage::HaveTx(const uint256& txid) const
+{
+    AssertLockHeld(g_cs_orphans);
+    return m_orphans.count(txid);
+}
+
+std::pair<CTransactionRef, NodeId> TxOrphanage::GetTx(const uint256& txid) const
+{
+    AssertLockHeld(g_cs_orphans);
+
+    const auto it = m_orphans.find(txid);
+    if (it == m_orphans.end()) return {nullptr, -1};
+    return {it->second.tx, it->second.fromPeer};
+}
+
+size_t TxOrphanage::PeerSize(NodeId peer) const
+{
+    AssertLockHeld(g_cs_orphans);
+
+    const auto it = m_peer_orphans.find(peer);
+    return it == m_peer_orphans.end() ? 0 : it->second.size();
+}
+
+void TxOrphanage::EraseForBlock(const CBlock& block)
+{
+    AssertLockHeld(g_cs_orphans);
+
+    std::vector<uint256> vOrphanErase;
+
+    for (const CTransactionRef& ptx : block.vtx) {
+        const CTransaction& tx = *ptx;
+
+        // Which orphan pool entries must we evict?
+        for (const auto& txin : tx.vin) {
+            auto itByPrev = m_outpoint_to_orphan_it.find(txin.prevout);
+            if (itByPrev == m_outpoint_to_orphan_it.end()) continue;
+            for (auto mi = itByPrev->second.begin(); mi != itByPrev->second.end(); ++mi) {
+                const CTransaction& orphanTx = *(*mi)->second.tx;
+                const uint256& orphanHash = orphanTx.GetHash();
+                vOrphanErase.push_back(orphanHash);
+            }
+        }
+    }
+
+    // Erase orphan transactions included or precluded by this block
+    if (vOrphanErase.size()) {
+        int nErased = 0;
+        for (const uint256& orphanHash : vOrphanErase) {
+            nErased += EraseTx(orphanHash);
+        }
+        LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx included or conflicted by block\n", nErased);
+    }
+}
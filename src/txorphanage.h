@@ -0,0 +1,109 @@
+// Copyright (c) 2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXORPHANAGE_H
+#define BITCOIN_TXORPHANAGE_H
+
+#include <net.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/** Guards orphan transactions and extra txs for compact blocks */
+extern RecursiveMutex g_cs_orphans;
+
+/** Expiration time for orphan transactions in seconds */
+static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
+/** Minimum time between orphan transactions expire time checks in seconds */
+static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
+
+/** A class to track orphan transactions (failed on TX_MISSING_INPUTS)
+ * Since we cannot distinguish orphans from bad transactions with
+ * non-existent inputs, we heavily limit the number of orphans
+ * we keep and the duration we keep them for.
+ *
+ * Orphans are indexed by txid, by the outpoints they spend (which, as
+ * outpoints sort by txid first, also finds all children of a parent txid
+ * with a single range lookup) and by the peer that announced them, so
+ * that none of the per-event operations need to scan the whole pool.
+ */
+class TxOrphanage {
+public:
+    /** Add a new orphan transaction. Returns false if it was already present or is too large. */
+    bool AddTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Check if we already have an orphan transaction with the given txid */
+    bool HaveTx(const uint256& txid) const EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Get an orphan transaction and its originating peer
+     * (Transaction ref will be nullptr if not found)
+     */
+    std::pair<CTransactionRef, NodeId> GetTx(const uint256& txid) const EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Erase an orphan by txid. Returns the number of entries removed (0 or 1). */
+    int EraseTx(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Erase all orphans announced by a peer, in time proportional to their number */
+    void EraseForPeer(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Erase all orphans included in or invalidated by a new block */
+    void EraseForBlock(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Expire old orphans and randomly evict down to max_orphans. Returns the number evicted by the size limit. */
+    unsigned int LimitOrphans(unsigned int max_orphans) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Add the txids of all orphans spending outputs of tx to orphan_work_set */
+    void AddChildrenToWorkSet(const CTransaction& tx, std::set<uint256>& orphan_work_set) const EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+    /** Return how many entries exist in the orphanage */
+    size_t Size() const EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans) { return m_orphans.size(); }
+
+    /** Return how many orphans a given peer has in the orphanage */
+    size_t PeerSize(NodeId peer) const EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
+protected:
+    struct OrphanTx {
+        CTransactionRef tx;
+        NodeId fromPeer;
+        int64_t nTimeExpire;
+        size_t list_pos;
+        size_t peer_pos;
+    };
+
+    /** Map from txid to orphan transaction record. Limited by
+     *  -maxorphantx/DEFAULT_MAX_ORPHAN_TRANSACTIONS */
+    std::map<uint256, OrphanTx> m_orphans GUARDED_BY(g_cs_orphans);
+
+    using OrphanMap = decltype(m_orphans);
+
+    struct IteratorComparator
+    {
+        template<typename I>
+        bool operator()(const I& a, const I& b) const
+        {
+            return &(*a) < &(*b);
+        }
+    };
+
+    /** Index from the parents' COutPoint into the m_orphans. Used
+     *  to remove orphan transactions from the m_orphans and to find
+     *  the children of a parent txid */
+    std::map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>> m_outpoint_to_orphan_it GUARDED_BY(g_cs_orphans);
+
+    /** Orphan transactions in vector for quick random eviction */
+    std::vector<OrphanMap::iterator> m_orphan_list GUARDED_BY(g_cs_orphans);
+
+    /** Orphan transactions per announcing peer, for quick removal on disconnect */
+    std::map<NodeId, std::vector<OrphanMap::iterator>> m_peer_orphans GUARDED_BY(g_cs_orphans);
+
+    /** Time at which the next expiration sweep should run */
+    int64_t m_next_sweep GUARDED_BY(g_cs_orphans){0};
+};
+
+#endif // BITCOIN_TXORPHANAGE_H
@@ -1624,6 +1624,58 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     return true;
 }
 
+bool ReadRawUndoFromDisk(std::vector<uint8_t>& blockundo, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    FlatFilePos pos;
+    uint256 prev_hash;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetUndoPos();
+        if (pos.IsNull()) {
+            return error("%s: no undo data available", __func__);
+        }
+        prev_hash = pindex->pprev->GetBlockHash();
+    }
+
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenUndoFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return error("%s: OpenUndoFile failed for %s", __func__, pos.ToString());
+    }
+
+    uint256 hashChecksum;
+    try {
+        CMessageHeader::MessageStartChars undo_start;
+        unsigned int undo_size;
+
+        filein >> undo_start >> undo_size;
+
+        if (memcmp(undo_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Undo magic mismatch for %s", __func__, pos.ToString());
+        }
+
+        if (undo_size > MAX_SIZE) {
+            return error("%s: Undo data is larger than maximum deserialization size for %s", __func__, pos.ToString());
+        }
+
+        blockundo.resize(undo_size);
+        filein.read((char*)blockundo.data(), undo_size);
+        filein >> hashChecksum;
+    } catch (const std::exception& e) {
+        return error("%s: Read from undo file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << prev_hash;
+    hasher.write((const char*)blockundo.data(), blockundo.size());
+    if (hashChecksum != hasher.GetHash()) {
+        return error("%s: Checksum mismatch for %s", __func__, pos.ToString());
+    }
+
+    return true;
+}
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage = "", unsigned int prefix = 0)
 {
@@ -4957,6 +5009,55 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+//! Number of mempool.dat entries that are deserialized and pre-verified together
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+namespace {
+struct MempoolDumpEntry {
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+};
+} // namespace
+
+/**
+ * Run the script checks of a batch of transactions read from mempool.dat on
+ * the script check threads, so that the signature cache is warm by the time
+ * the transactions are passed one by one through AcceptToMemoryPool.
+ *
+ * Transactions whose inputs cannot be found (yet) are skipped, and results are
+ * discarded: acceptance remains entirely up to AcceptToMemoryPool.
+ */
+static void PreverifyMempoolBatch(const CTxMemPool& pool, const std::vector<MempoolDumpEntry>& batch)
+{
+    if (!g_parallel_script_checks) return;
+
+    std::vector<PrecomputedTransactionData> txdata;
+    txdata.reserve(batch.size()); // Required so that CScriptCheck pointers into txdata stay valid
+    std::vector<CScriptCheck> vChecks;
+    {
+        LOCK2(cs_main, pool.cs);
+        CCoinsViewMemPool view_mempool(&::ChainstateActive().CoinsTip(), pool);
+        CCoinsViewCache view(&view_mempool);
+        for (const MempoolDumpEntry& entry : batch) {
+            const CTransaction& tx = *entry.tx;
+            if (tx.IsCoinBase()) continue;
+            if (view.HaveInputs(tx)) {
+                txdata.emplace_back(tx);
+                TxValidationState state_dummy;
+                CheckInputScripts(tx, state_dummy, view, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata.back(), &vChecks);
+            }
+            // Make the outputs visible to descendants later in the same batch
+            AddCoins(view, tx, MEMPOOL_HEIGHT, true);
+        }
+    }
+
+    // The results are cached by the checks themselves; a failing check only
+    // stops the remaining checks of this batch from warming the cache.
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -4983,22 +5084,36 @@ bool LoadMempool(CTxMemPool& pool)
         }
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        std::vector<MempoolDumpEntry> batch;
+        batch.reserve(std::min<uint64_t>(num, MEMPOOL_LOAD_BATCH_SIZE));
+        while (num) {
+            batch.clear();
+            while (num && batch.size() < MEMPOOL_LOAD_BATCH_SIZE) {
+                MempoolDumpEntry entry;
+                file >> entry.tx;
+                file >> entry.nTime;
+                file >> entry.nFeeDelta;
+                --num;
+
+                CAmount amountdelta = entry.nFeeDelta;
+                if (amountdelta) {
+                    pool.PrioritiseTransaction(entry.tx->GetHash(), amountdelta);
+                }
+                if (entry.nTime + nExpiryTimeout > nNow) {
+                    batch.push_back(std::move(entry));
+                } else {
+                    ++expired;
+                }
             }
-            TxValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+
+            PreverifyMempoolBatch(pool, batch);
+            if (ShutdownRequested())
+                return false;
+
+            for (const MempoolDumpEntry& entry : batch) {
+                TxValidationState state;
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nTime,
+                AcceptToMemoryPoolWithTime(chainparams, pool, state, entry.tx, entry.nTime,
                                            nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
                                            false /* test_accept */);
                 if (state.IsValid()) {
@@ -5008,17 +5123,15 @@ bool LoadMempool(CTxMemPool& pool)
                     // wallet(s) having loaded it while we were processing
                     // mempool transactions; consider these as valid, instead of
                     // failed, but mark them as 'already there'
-                    if (pool.exists(tx->GetHash())) {
+                    if (pool.exists(entry.tx->GetHash())) {
                         ++already_there;
                     } else {
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested())
+                    return false;
             }
-            if (ShutdownRequested())
-                return false;
         }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
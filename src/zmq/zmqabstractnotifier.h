@@ -7,6 +7,9 @@
 
 #include <zmq/zmqconfig.h>
 
+#include <memory>
+
+class CBlock;
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
@@ -40,9 +43,22 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
+    /** Notifies of a new tip. pblock is the tip block if it is still in
+     *  memory, so that it doesn't need to be read from disk again */
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock);
     virtual bool NotifyTransaction(const CTransaction &transaction);
 
+    /** Notifies of a transaction being added to the mempool */
+    virtual bool NotifyTransactionAcceptance(const CTransaction &transaction);
+    /** Notifies of a transaction leaving the mempool other than by being mined */
+    virtual bool NotifyTransactionRemoval(const CTransaction &transaction);
+    /** Notifies of any block being connected to or disconnected from the active chain */
+    virtual bool NotifyBlockConnect(const CBlockIndex *pindex);
+    virtual bool NotifyBlockDisconnect(const CBlockIndex *pindex);
+    /** Called regularly while there is nothing else to publish, to send what
+     *  a notifier held back to rate-limit it */
+    virtual bool NotifyPending();
+
 protected:
     void *psocket;
     std::string type;
@@ -21,6 +21,7 @@ CZMQNotificationInterface::~CZMQNotificationInterface()
 {
     Shutdown();
 
+    LOCK(m_notifiers_mutex);
     for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
     {
         delete *i;
@@ -29,6 +30,7 @@ CZMQNotificationInterface::~CZMQNotificationInterface()
 
 std::list<const CZMQAbstractNotifier*> CZMQNotificationInterface::GetActiveNotifiers() const
 {
+    LOCK(m_notifiers_mutex);
     std::list<const CZMQAbstractNotifier*> result;
     for (const auto* n : notifiers) {
         result.push_back(n);
@@ -46,6 +48,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubtemplatediff"] = CZMQAbstractNotifier::Create<CZMQPublishTemplateDiffNotifier>;
+    factories["pubsequence"] = CZMQAbstractNotifier::Create<CZMQPublishSequenceNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -65,7 +69,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     if (!notifiers.empty())
     {
         notificationInterface = new CZMQNotificationInterface();
-        notificationInterface->notifiers = notifiers;
+        WITH_LOCK(notificationInterface->m_notifiers_mutex, notificationInterface->notifiers = notifiers);
 
         if (!notificationInterface->Initialize())
         {
@@ -95,26 +99,30 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
-    std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin();
-    for (; i!=notifiers.end(); ++i)
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->Initialize(pcontext))
+        LOCK(m_notifiers_mutex);
+        std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin();
+        for (; i!=notifiers.end(); ++i)
         {
-            LogPrint(BCLog::ZMQ, "zmq: Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+            CZMQAbstractNotifier *notifier = *i;
+            if (notifier->Initialize(pcontext))
+            {
+                LogPrint(BCLog::ZMQ, "zmq: Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+            }
+            else
+            {
+                LogPrint(BCLog::ZMQ, "zmq: Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+                break;
+            }
         }
-        else
+
+        if (i!=notifiers.end())
         {
-            LogPrint(BCLog::ZMQ, "zmq: Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
-            break;
+            return false;
         }
     }
 
-    if (i!=notifiers.end())
-    {
-        return false;
-    }
-
+    m_thread_publish = std::thread(&TraceThread<std::function<void()>>, "zmqpub", std::bind(&CZMQNotificationInterface::ThreadPublish, this));
     return true;
 }
 
@@ -122,8 +130,15 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
+    if (m_thread_publish.joinable()) {
+        // Let the publisher thread send what is queued, then stop
+        WITH_LOCK(m_queue_mutex, m_stop = true);
+        m_queue_cond.notify_all();
+        m_thread_publish.join();
+    }
     if (pcontext)
     {
+        LOCK(m_notifiers_mutex);
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -136,61 +151,110 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+void CZMQNotificationInterface::Enqueue(Notification notification)
 {
-    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
-        return;
+    WAIT_LOCK(m_queue_mutex, lock);
+    if (m_queue.size() >= MAX_ZMQ_QUEUED_NOTIFICATIONS) {
+        // Apply back pressure rather than drop notifications, so subscribers
+        // never miss one that the PUB socket would have delivered
+        LogPrint(BCLog::ZMQ, "zmq: Notification queue full, waiting for the publisher thread\n");
+        m_queue_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_queue_mutex) { return m_stop || m_queue.size() < MAX_ZMQ_QUEUED_NOTIFICATIONS; });
+    }
+    if (m_stop) return;
+    m_queue.push_back(std::move(notification));
+    m_queue_cond.notify_all();
+}
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
+void CZMQNotificationInterface::ThreadPublish()
+{
+    while (true) {
+        Notification notification;
         {
-            i++;
+            WAIT_LOCK(m_queue_mutex, lock);
+            m_queue_cond.wait_for(lock, std::chrono::seconds{ZMQ_PENDING_INTERVAL}, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_queue_mutex) { return m_stop || !m_queue.empty(); });
+            if (!m_queue.empty()) {
+                notification = std::move(m_queue.front());
+                m_queue.pop_front();
+            } else if (m_stop) {
+                return;
+            } else {
+                notification = [](CZMQAbstractNotifier* notifier) { return notifier->NotifyPending(); };
+            }
         }
-        else
+        m_queue_cond.notify_all();
+
+        LOCK(m_notifiers_mutex);
+        for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+            CZMQAbstractNotifier *notifier = *i;
+            if (notification(notifier))
+            {
+                i++;
+            }
+            else
+            {
+                notifier->Shutdown();
+                i = notifiers.erase(i);
+            }
         }
     }
 }
 
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    // The tip is normally the block connected last, which is still in memory
+    std::shared_ptr<const CBlock> pblock;
+    if (m_last_connected_index == pindexNew) pblock = m_last_connected_block;
+    m_last_connected_block.reset();
+    m_last_connected_index = nullptr;
+
+    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+        return;
+
+    Enqueue([pindexNew, pblock](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyBlock(pindexNew, pblock);
+    });
+}
+
 void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
 {
-    // Used by BlockConnected and BlockDisconnected as well, because they're
-    // all the same external callback.
-    const CTransaction& tx = *ptx;
+    Enqueue([ptx](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyTransaction(*ptx) && notifier->NotifyTransactionAcceptance(*ptx);
+    });
+}
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
+void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason /*reason*/)
+{
+    // Transactions included in a block don't get here, subscribers learn
+    // about those from the block connection
+    Enqueue([ptx](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyTransactionRemoval(*ptx);
+    });
 }
 
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        // Do a normal notify for each transaction added in the block
-        TransactionAddedToMempool(ptx);
-    }
+    m_last_connected_block = pblock;
+    m_last_connected_index = pindexConnected;
+
+    Enqueue([pblock, pindexConnected](CZMQAbstractNotifier* notifier) {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            // Do a normal notify for each transaction added in the block
+            if (!notifier->NotifyTransaction(*ptx)) return false;
+        }
+        return notifier->NotifyBlockConnect(pindexConnected);
+    });
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        // Do a normal notify for each transaction removed in block disconnection
-        TransactionAddedToMempool(ptx);
-    }
+    Enqueue([pblock, pindexDisconnected](CZMQAbstractNotifier* notifier) {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            // Do a normal notify for each transaction removed in block disconnection
+            if (!notifier->NotifyTransaction(*ptx)) return false;
+        }
+        return notifier->NotifyBlockDisconnect(pindexDisconnected);
+    });
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
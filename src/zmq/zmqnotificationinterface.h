@@ -5,12 +5,24 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include <sync.h>
 #include <validationinterface.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <list>
+#include <memory>
+#include <thread>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+/** Maximum number of notifications waiting to be published before validation callbacks block */
+static const size_t MAX_ZMQ_QUEUED_NOTIFICATIONS = 10000;
+/** Number of seconds the publisher thread waits for a notification before calling NotifyPending() */
+static const int64_t ZMQ_PENDING_INTERVAL = 1;
+
 class CZMQNotificationInterface final : public CValidationInterface
 {
 public:
@@ -26,15 +38,36 @@ protected:
 
     // CValidationInterface
     void TransactionAddedToMempool(const CTransactionRef& tx) override;
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason) override;
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
 
 private:
+    /** Calls one notifier, returning false if the notifier failed */
+    using Notification = std::function<bool(CZMQAbstractNotifier*)>;
+
     CZMQNotificationInterface();
 
+    /** Queue a notification for all notifiers, to be sent by the publisher thread */
+    void Enqueue(Notification notification);
+    /** Publisher thread: send queued notifications until stopped and drained */
+    void ThreadPublish();
+
     void *pcontext;
-    std::list<CZMQAbstractNotifier*> notifiers;
+
+    mutable Mutex m_notifiers_mutex;
+    std::list<CZMQAbstractNotifier*> notifiers GUARDED_BY(m_notifiers_mutex);
+
+    Mutex m_queue_mutex;
+    std::condition_variable m_queue_cond;
+    std::deque<Notification> m_queue GUARDED_BY(m_queue_mutex);
+    bool m_stop GUARDED_BY(m_queue_mutex){false};
+    std::thread m_thread_publish;
+
+    /** The most recently connected block, reused when it becomes the tip */
+    std::shared_ptr<const CBlock> m_last_connected_block;
+    const CBlockIndex* m_last_connected_index{nullptr};
 };
 
 extern CZMQNotificationInterface* g_zmq_notification_interface;
@@ -4,10 +4,12 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <miner.h>
 #include <streams.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <rpc/server.h>
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
@@ -16,6 +18,8 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_TEMPLATEDIFF = "templatediff";
+static const char *MSG_SEQUENCE = "sequence";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -158,7 +162,7 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& /*pblock*/)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint(BCLog::ZMQ, "zmq: Publish hashblock %s\n", hash.GetHex());
@@ -178,13 +182,15 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock)
 {
     LogPrint(BCLog::ZMQ, "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    {
+    if (pblock) {
+        ss << *pblock;
+    } else {
         LOCK(cs_main);
         CBlock block;
         if(!ReadBlockFromDisk(block, pindex, consensusParams))
@@ -207,3 +213,105 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishTemplateDiffNotifier::NotifyBlock(const CBlockIndex * /*pindex*/, const std::shared_ptr<const CBlock>& /*pblock*/)
+{
+    return PublishTemplateDiff(true);
+}
+
+bool CZMQPublishTemplateDiffNotifier::NotifyTransaction(const CTransaction & /*transaction*/)
+{
+    // Rate-limit rebuilding the template on mempool churn, like getblocktemplate
+    // does. What is held back is published by NotifyPending() later.
+    if (GetTime() - m_last_time < ZMQ_TEMPLATE_MIN_INTERVAL) {
+        m_pending = true;
+        return true;
+    }
+    return PublishTemplateDiff(false);
+}
+
+bool CZMQPublishTemplateDiffNotifier::NotifyPending()
+{
+    if (!m_pending || GetTime() - m_last_time < ZMQ_TEMPLATE_MIN_INTERVAL) return true;
+    return PublishTemplateDiff(false);
+}
+
+bool CZMQPublishTemplateDiffNotifier::PublishTemplateDiff(bool tip_changed)
+{
+    m_pending = false;
+    const unsigned int transactions_updated = mempool.GetTransactionsUpdated();
+    if (!tip_changed && transactions_updated == m_transactions_updated) return true;
+
+    m_last_time = GetTime();
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    try {
+        LOCK(cs_main);
+        if (::ChainstateActive().IsInitialBlockDownload()) return true;
+        pblocktemplate = BlockAssembler(mempool, Params()).CreateNewBlock(CScript() << OP_TRUE);
+    } catch (const std::runtime_error& e) {
+        // Not fatal for the notifier; try again on the next update
+        zmqError(strprintf("Can't create block template: %s", e.what()).c_str());
+        return true;
+    }
+    if (!pblocktemplate) {
+        zmqError("Can't create block template");
+        return true;
+    }
+    m_transactions_updated = transactions_updated;
+    const CBlock& block = pblocktemplate->block;
+    const int64_t coinbase_value = block.vtx[0]->vout[0].nValue;
+
+    const BlockTemplateDiff diff = GetBlockTemplateDiff(m_txids, block);
+    if (block.hashPrevBlock == m_prev_block_hash && coinbase_value == m_coinbase_value &&
+        diff.added.empty() && diff.removed.empty()) {
+        return true;
+    }
+
+    std::vector<uint256> added;
+    added.reserve(diff.added.size());
+    for (const size_t index_in_template : diff.added) {
+        added.push_back(block.vtx[index_in_template]->GetHash());
+    }
+
+    LogPrint(BCLog::ZMQ, "zmq: Publish templatediff on %s (+%u -%u)\n", block.hashPrevBlock.GetHex(), added.size(), diff.removed.size());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block.hashPrevBlock << coinbase_value << diff.removed << added;
+
+    m_prev_block_hash = block.hashPrevBlock;
+    m_coinbase_value = coinbase_value;
+    m_txids = GetBlockTemplateTxids(block);
+    return SendMessage(MSG_TEMPLATEDIFF, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishSequenceNotifier::SendSequenceMsg(const uint256& hash, char label)
+{
+    unsigned char data[sizeof(uint256) + 1];
+    for (unsigned int i = 0; i < sizeof(uint256); i++)
+        data[sizeof(uint256) - 1 - i] = hash.begin()[i];
+    data[sizeof(uint256)] = label;
+    return SendMessage(MSG_SEQUENCE, data, sizeof(data));
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockConnect(const CBlockIndex *pindex)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence block connect %s\n", pindex->GetBlockHash().GetHex());
+    return SendSequenceMsg(pindex->GetBlockHash(), 'C');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockDisconnect(const CBlockIndex *pindex)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence block disconnect %s\n", pindex->GetBlockHash().GetHex());
+    return SendSequenceMsg(pindex->GetBlockHash(), 'D');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const CTransaction &transaction)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence mempool acceptance %s\n", transaction.GetHash().GetHex());
+    return SendSequenceMsg(transaction.GetHash(), 'A');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &transaction)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish sequence mempool removal %s\n", transaction.GetHash().GetHex());
+    return SendSequenceMsg(transaction.GetHash(), 'R');
+}
@@ -7,6 +7,10 @@
 
 #include <zmq/zmqabstractnotifier.h>
 
+#include <uint256.h>
+
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
@@ -31,7 +35,7 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -43,7 +47,7 @@ public:
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
@@ -52,4 +56,40 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/** Minimum number of seconds between block templates published because of mempool changes */
+static const int64_t ZMQ_TEMPLATE_MIN_INTERVAL = 5;
+
+/** Publishes how the block template changes when the tip or the mempool changes */
+class CZMQPublishTemplateDiffNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    uint256 m_prev_block_hash;
+    std::vector<uint256> m_txids;
+    int64_t m_coinbase_value{-1};
+    unsigned int m_transactions_updated{0};
+    int64_t m_last_time{0};
+    //! Whether mempool changes were held back by ZMQ_TEMPLATE_MIN_INTERVAL
+    bool m_pending{false};
+
+    bool PublishTemplateDiff(bool tip_changed);
+
+public:
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
+    bool NotifyTransaction(const CTransaction &transaction) override;
+    bool NotifyPending() override;
+};
+
+/** Publishes every block (dis)connection and mempool addition and removal, in order */
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    bool SendSequenceMsg(const uint256& hash, char label);
+
+public:
+    bool NotifyBlockConnect(const CBlockIndex *pindex) override;
+    bool NotifyBlockDisconnect(const CBlockIndex *pindex) override;
+    bool NotifyTransactionAcceptance(const CTransaction &transaction) override;
+    bool NotifyTransactionRemoval(const CTransaction &transaction) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -43,13 +43,13 @@ class RESTTest (BitcoinTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 2
-        self.extra_args = [["-rest"], []]
+        self.extra_args = [["-rest", "-addrindex", "-spentindex"], ["-rest"]]
         self.supports_cli = False
 
     def skip_test_if_missing_module(self):
         self.skip_if_no_wallet()
 
-    def test_rest_request(self, uri, http_method='GET', req_type=ReqType.JSON, body='', status=200, ret_type=RetType.JSON):
+    def test_rest_request(self, uri, http_method='GET', req_type=ReqType.JSON, body='', status=200, ret_type=RetType.JSON, url=None):
         rest_uri = '/rest' + uri
         if req_type == ReqType.JSON:
             rest_uri += '.json'
@@ -58,7 +58,8 @@ class RESTTest (BitcoinTestFramework):
         elif req_type == ReqType.HEX:
             rest_uri += '.hex'
 
-        conn = http.client.HTTPConnection(self.url.hostname, self.url.port)
+        url = url or self.url
+        conn = http.client.HTTPConnection(url.hostname, url.port)
         self.log.debug('%s %s %s', http_method, rest_uri, body)
         if http_method == 'GET':
             conn.request('GET', rest_uri)
@@ -281,6 +282,31 @@ class RESTTest (BitcoinTestFramework):
         json_obj = self.test_rest_request("/headers/5/{}".format(bb_hash))
         assert_equal(len(json_obj), 5)  # now we should have 5 header objects
 
+        self.log.info("Test the /blockrange URI")
+
+        start_height = block_json_obj['height']
+        tip_height = self.nodes[0].getblockcount()
+        expected = b''.join(hex_str_to_bytes(self.nodes[0].getblock(self.nodes[0].getblockhash(h), 0))
+                            for h in range(start_height, tip_height + 1))
+        # The range stops at the tip
+        response = self.test_rest_request("/blockrange/{}/10".format(start_height), req_type=ReqType.BIN, ret_type=RetType.OBJ)
+        assert_equal(response.getheader('transfer-encoding'), 'chunked')
+        assert_equal(response.read(), expected)
+        response_hex = self.test_rest_request("/blockrange/{}/10".format(start_height), req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(response_hex.strip(b'\n'), binascii.hexlify(expected))
+        response_bytes = self.test_rest_request("/blockrange/{}/1".format(start_height), req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(response_bytes, hex_str_to_bytes(self.nodes[0].getblock(bb_hash, 0)))
+
+        # Check invalid blockrange requests
+        resp = self.test_rest_request("/blockrange/{}/1".format(tip_height + 1), req_type=ReqType.BIN, ret_type=RetType.OBJ, status=404)
+        assert_equal(resp.read().decode('utf-8').rstrip(), "Block height out of range")
+        resp = self.test_rest_request("/blockrange/0/1001", req_type=ReqType.BIN, ret_type=RetType.OBJ, status=400)
+        assert_equal(resp.read().decode('utf-8').rstrip(), "Block count out of range: 1001")
+        self.test_rest_request("/blockrange/0/0", req_type=ReqType.BIN, ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/blockrange/-1/1", req_type=ReqType.BIN, ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/blockrange/0", req_type=ReqType.BIN, ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/blockrange/0/1", ret_type=RetType.OBJ, status=404)
+
         self.log.info("Test tx inclusion in the /mempool and /block URIs")
 
         # Make 3 tx and mine them on node 1
@@ -318,6 +344,19 @@ class RESTTest (BitcoinTestFramework):
         for tx in txs:
             assert tx in json_obj['tx']
 
+        self.log.info("Test the /blockundo URI")
+
+        # One entry per non-coinbase transaction
+        undo_bytes = self.test_rest_request("/blockundo/{}".format(newblockhash[0]), req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(undo_bytes[0], len(txs))
+        undo_hex = self.test_rest_request("/blockundo/{}".format(newblockhash[0]), req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(undo_hex.strip(b'\n'), binascii.hexlify(undo_bytes))
+        assert_equal(self.test_rest_request("/blockundo/{}".format(bb_hash), req_type=ReqType.BIN, ret_type=RetType.BYTES), b'\x00')
+
+        self.test_rest_request("/blockundo/{}".format(self.nodes[0].getblockhash(0)), req_type=ReqType.BIN, ret_type=RetType.OBJ, status=404)
+        self.test_rest_request("/blockundo/{}".format('0' * 64), req_type=ReqType.BIN, ret_type=RetType.OBJ, status=404)
+        self.test_rest_request("/blockundo/{}".format(newblockhash[0]), ret_type=RetType.OBJ, status=404)
+
         self.log.info("Test the /chaininfo URI")
 
         bb_hash = self.nodes[0].getbestblockhash()
@@ -325,5 +364,68 @@ class RESTTest (BitcoinTestFramework):
         json_obj = self.test_rest_request("/chaininfo")
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        self.log.info("Test the /addresshistory, /addressutxos and /txspending URIs")
+
+        # Fund an address and spend the output, leaving a second spend in the mempool
+        addr = self.nodes[0].getnewaddress()
+        script = self.nodes[0].getaddressinfo(addr)['scriptPubKey']
+        txid_fund = self.nodes[0].sendtoaddress(addr, 1)
+        vout, = filter_output_indices_by_value(self.nodes[0].getrawtransaction(txid_fund, True)['vout'], Decimal('1'))
+        self.nodes[0].generate(1)
+        raw = self.nodes[0].createrawtransaction([{"txid": txid_fund, "vout": vout}], {addr: Decimal('0.999')})
+        txid_spend = self.nodes[0].sendrawtransaction(self.nodes[0].signrawtransactionwithwallet(raw)['hex'])
+        self.nodes[0].generate(1)
+        self.sync_all()
+        spend_height = self.nodes[0].getblockcount()
+        raw = self.nodes[0].createrawtransaction([{"txid": txid_spend, "vout": 0}], {not_related_address: Decimal('0.998')})
+        txid_mempool = self.nodes[0].sendrawtransaction(self.nodes[0].signrawtransactionwithwallet(raw)['hex'])
+        self.sync_all()
+
+        json_obj = self.test_rest_request("/addresshistory/{}".format(addr))
+        assert_equal(json_obj, self.nodes[0].getaddresshistory(addr))
+        assert_equal([(e['type'], e['txid']) for e in json_obj['history']],
+                     [('funding', txid_fund), ('funding', txid_spend), ('spending', txid_spend)])
+        assert_equal(self.test_rest_request("/addresshistory/{}".format(script)), json_obj)
+
+        json_obj = self.test_rest_request("/addressutxos/{}".format(addr))
+        assert_equal(json_obj, self.nodes[0].getaddressutxos(addr))
+        assert_equal([(u['txid'], u['vout']) for u in json_obj['unspents']], [(txid_spend, 0)])
+        assert_equal(json_obj['total_amount'], Decimal('0.999'))
+
+        json_obj = self.test_rest_request("/txspending/{}-{}/{}-0".format(txid_fund, vout, txid_spend))
+        assert_equal(json_obj, self.nodes[0].gettxspendingprevout([{"txid": txid_fund, "vout": vout}, {"txid": txid_spend, "vout": 0}]))
+        assert_equal(json_obj[0]['spendingtxid'], txid_spend)
+        assert_equal(json_obj[0]['spendingvin'], 0)
+        assert_equal(json_obj[0]['height'], spend_height)
+        assert_equal(json_obj[1]['spendingtxid'], txid_mempool)
+        assert 'height' not in json_obj[1]
+
+        # Check invalid requests
+        resp = self.test_rest_request("/addresshistory/notanaddress", ret_type=RetType.OBJ, status=400)
+        assert_equal(resp.read().decode('utf-8').rstrip(), "Invalid address or script: notanaddress")
+        self.test_rest_request("/addressutxos/notanaddress", ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/addresshistory/{}".format(addr), req_type=ReqType.BIN, ret_type=RetType.OBJ, status=404)
+        self.test_rest_request("/txspending/{}-x".format(txid_fund), ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/txspending/zz-0", ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/txspending/{}--1".format(txid_fund), ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/txspending/", ret_type=RetType.OBJ, status=400)
+        self.test_rest_request("/txspending/{}-{}".format(txid_fund, vout), req_type=ReqType.BIN, ret_type=RetType.OBJ, status=404)
+
+        # Test limits
+        long_uri = '/'.join(["{}-{}".format(txid_fund, n_) for n_ in range(101)])
+        resp = self.test_rest_request("/txspending/{}".format(long_uri), ret_type=RetType.OBJ, status=400)
+        assert_equal(resp.read().decode('utf-8').rstrip(), "Error: max outpoints exceeded (max: 100, tried: 101)")
+        long_uri = '/'.join(["{}-{}".format(txid_fund, n_) for n_ in range(100)])
+        assert_equal(len(self.test_rest_request("/txspending/{}".format(long_uri))), 100)
+
+        # Without the indexes, the address queries fail and only spends in the mempool are found
+        url_no_index = urllib.parse.urlparse(self.nodes[1].url)
+        resp = self.test_rest_request("/addresshistory/{}".format(addr), ret_type=RetType.OBJ, status=404, url=url_no_index)
+        assert_equal(resp.read().decode('utf-8').rstrip(), "Address index is not enabled (use -addrindex)")
+        self.test_rest_request("/addressutxos/{}".format(addr), ret_type=RetType.OBJ, status=404, url=url_no_index)
+        json_obj = self.test_rest_request("/txspending/{}-{}/{}-0".format(txid_fund, vout, txid_spend), url=url_no_index)
+        assert 'spendingtxid' not in json_obj[0]
+        assert_equal(json_obj[1]['spendingtxid'], txid_mempool)
+
 if __name__ == '__main__':
     RESTTest().main()
@@ -4,10 +4,13 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Tests some generic aspects of the RPC interface."""
 
+import http.client
 import os
+import urllib.parse
+
 from test_framework.authproxy import JSONRPCException
 from test_framework.test_framework import BitcoinTestFramework
-from test_framework.util import assert_equal, assert_greater_than_or_equal
+from test_framework.util import assert_equal, assert_greater_than_or_equal, str_to_b64str
 
 def expect_http_status(expected_http_status, expected_rpc_code,
                        fcn, *args):
@@ -35,6 +38,29 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_greater_than_or_equal(command['duration'], 0)
         assert_equal(info['logpath'], os.path.join(self.nodes[0].datadir, self.chain, 'debug.log'))
 
+        # getrpcinfo is served ahead of other queued requests
+        work_queue = info['work_queue']
+        assert_equal(work_queue['depth'], 0)
+        assert_greater_than_or_equal(work_queue['priority_served'], 1)
+        assert_equal(work_queue['rejected'], 0)
+        assert_equal(work_queue['dropped'], 0)
+
+    def test_unauthenticated_request(self):
+        self.log.info("Testing that requests failing to authenticate are not served first...")
+
+        before = self.nodes[0].getrpcinfo()['work_queue']
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        headers = {"Authorization": "Basic " + str_to_b64str(url.username + ":wrong")}
+        conn.request('POST', '/', '{"method": "getblockcount"}', headers)
+        assert_equal(conn.getresponse().status, 401)
+        conn.close()
+
+        # Only the getrpcinfo call below counts as priority
+        after = self.nodes[0].getrpcinfo()['work_queue']
+        assert_equal(after['priority_served'], before['priority_served'] + 1)
+        assert_equal(after['served'], before['served'] + 1)
+
     def test_batch_request(self):
         self.log.info("Testing basic JSON-RPC batch request...")
 
@@ -69,6 +95,7 @@ class RPCInterfaceTest(BitcoinTestFramework):
 
     def run_test(self):
         self.test_getrpcinfo()
+        self.test_unauthenticated_request()
         self.test_batch_request()
         self.test_http_status_codes()
 
@@ -48,6 +48,7 @@ class ZMQTest (BitcoinTestFramework):
         try:
             self.test_basic()
             self.test_reorg()
+            self.test_sequence()
         finally:
             # Destroy the ZMQ context.
             self.log.debug("Destroying ZMQ context")
@@ -156,5 +157,47 @@ class ZMQTest (BitcoinTestFramework):
         # Should receive nodes[1] tip
         assert_equal(self.nodes[1].getbestblockhash(), hashblock.receive().hex())
 
+    def test_sequence(self):
+        import zmq
+        address = 'tcp://127.0.0.1:28334'
+        socket = self.ctx.socket(zmq.SUB)
+        socket.set(zmq.RCVTIMEO, 60000)
+        seq = ZMQSubscriber(socket, b'sequence')
+
+        def receive_sequence():
+            body = seq.receive()
+            assert_equal(len(body), 33)
+            return body[:32].hex(), body[32:].decode()
+
+        self.restart_node(0, ['-zmqpub%s=%s' % (seq.topic.decode(), address)])
+        socket.connect(address)
+        # Relax so that the subscriber is ready before publishing zmq messages
+        sleep(0.2)
+
+        self.log.info("Every connected block is published")
+        hashes = self.nodes[0].generatetoaddress(2, ADDRESS_BCRT1_UNSPENDABLE)
+        for block_hash in hashes:
+            assert_equal((block_hash, 'C'), receive_sequence())
+
+        self.log.info("Disconnected blocks are published during a reorg")
+        old_tip = hashes[-1]
+        old_parent = hashes[-2]
+        new_hashes = self.nodes[1].generatetoaddress(4, ADDRESS_BCRT1_UNSPENDABLE)
+        connect_nodes(self.nodes[0], 1)
+        self.sync_blocks()
+        assert_equal((old_tip, 'D'), receive_sequence())
+        assert_equal((old_parent, 'D'), receive_sequence())
+        for block_hash in new_hashes:
+            assert_equal((block_hash, 'C'), receive_sequence())
+
+        if self.is_wallet_compiled():
+            self.log.info("Mempool additions are published")
+            self.nodes[0].generatetoaddress(1, self.nodes[0].getnewaddress())
+            self.nodes[0].generatetoaddress(100, ADDRESS_BCRT1_UNSPENDABLE)
+            for _ in range(101):
+                assert_equal('C', receive_sequence()[1])
+            txid = self.nodes[0].sendtoaddress(self.nodes[0].getnewaddress(), 1.0)
+            assert_equal((txid, 'A'), receive_sequence())
+
 if __name__ == '__main__':
     ZMQTest().main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test getblocktemplatediff.
+
+Check that applying the changes it reports to an earlier template yields
+the transactions of the current one, after mempool changes and a new tip.
+"""
+
+import time
+
+from test_framework.messages import COIN
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class GetBlockTemplateDiffTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def template_txids(self):
+        return [tx['txid'] for tx in self.nodes[0].getblocktemplate({'rules': ['segwit']})['transactions']]
+
+    def next_template(self):
+        # Templates are only rebuilt for mempool changes once they are 5 seconds old
+        self.mocktime += 6
+        self.nodes[0].setmocktime(self.mocktime)
+
+    def run_test(self):
+        node = self.nodes[0]
+        # Leave initial block download
+        node.generate(1)
+        self.sync_all()
+        self.mocktime = int(time.time())
+        node.setmocktime(self.mocktime)
+
+        template = node.getblocktemplate({'rules': ['segwit']})
+        longpollid = template['longpollid']
+        assert_equal(template['transactions'], [])
+
+        self.log.info("Test that nothing is reported without changes")
+        diff = node.getblocktemplatediff(longpollid)
+        assert_equal(diff['longpollid'], longpollid)
+        assert_equal(diff['previousblockhash'], template['previousblockhash'])
+        assert_equal(diff['added'], [])
+        assert_equal(diff['removed'], [])
+
+        self.log.info("Test transactions added to the mempool")
+        new_txids = [node.sendtoaddress(node.getnewaddress(), 1) for _ in range(3)]
+        self.next_template()
+        diff = node.getblocktemplatediff(longpollid)
+        assert diff['longpollid'] != longpollid
+        assert_equal(diff['removed'], [])
+        assert_equal(sorted(tx['txid'] for tx in diff['added']), sorted(new_txids))
+        assert_equal([tx['txid'] for tx in diff['added']], self.template_txids())
+        for tx in diff['added']:
+            assert_equal(node.decoderawtransaction(tx['data'])['txid'], tx['txid'])
+            assert tx['fee'] > 0
+        assert_equal(diff['coinbasevalue'], node.getblocktemplate({'rules': ['segwit']})['coinbasevalue'])
+        longpollid = diff['longpollid']
+        txids = self.template_txids()
+
+        self.log.info("Test a transaction dropped from the template")
+        # The last transaction has no descendants in the mempool
+        dropped = txids[-1]
+        node.prioritisetransaction(dropped, 0, -COIN)
+        self.next_template()
+        diff = node.getblocktemplatediff(longpollid)
+        assert_equal(diff['added'], [])
+        assert_equal(diff['removed'], [dropped])
+        assert_equal(txids[:-1], self.template_txids())
+
+        self.log.info("Test a new tip")
+        node.generate(1)
+        diff = node.getblocktemplatediff(longpollid)
+        assert_equal(diff['previousblockhash'], node.getbestblockhash())
+        assert_equal(diff['height'], node.getblockcount() + 1)
+        assert_equal(diff['added'], [])
+        assert_equal(diff['removed'], txids)
+        assert_equal(self.template_txids(), [])
+
+        self.log.info("Test an unknown longpollid")
+        assert_raises_rpc_error(-8, "Unknown or expired longpollid", node.getblocktemplatediff, "00" * 32 + "0")
+
+if __name__ == '__main__':
+    GetBlockTemplateDiffTest().main()
@@ -732,6 +732,48 @@ class CompactBlocksTest(BitcoinTestFramework):
         assert int(node.getbestblockhash(), 16) is not block.sha256
         test_node.sync_with_ping()
 
+    # Test that a compact block is relayed to high-bandwidth peers as soon as it
+    # is reconstructed, before it is validated, unless -cmpctblockfastforward=0.
+    def test_fast_forward_before_validation(self, sender, listener, fast_forward):
+        node = self.nodes[0]
+        assert len(self.utxos)
+        utxo = self.utxos[0]
+
+        # A non-final transaction passes the checks done before the block is
+        # relayed, but makes AcceptBlock fail before NewPoWValidBlock would
+        # announce it.
+        block = self.build_block_on_tip(node)
+        tx = CTransaction()
+        tx.vin.append(CTxIn(COutPoint(utxo[0], utxo[1]), b'', 0))
+        tx.vout.append(CTxOut(utxo[2] - 1000, CScript([OP_TRUE])))
+        tx.nLockTime = node.getblockcount() + 10
+        tx.rehash()
+        block.vtx.append(tx)
+        block.hashMerkleRoot = block.calc_merkle_root()
+        block.solve()
+
+        comp_block = HeaderAndShortIDs()
+        comp_block.initialize_from_block(block, prefill_list=[0, 1], use_witness=True)
+        listener.clear_block_announcement()
+        sender.send_and_ping(msg_cmpctblock(comp_block.to_p2p()))
+        listener.sync_with_ping()
+
+        assert int(node.getbestblockhash(), 16) != block.sha256
+        assert sender.is_connected
+        with mininode_lock:
+            assert_equal("cmpctblock" in listener.last_message, fast_forward)
+            if fast_forward:
+                listener.last_message["cmpctblock"].header_and_shortids.header.calc_sha256()
+                assert_equal(listener.last_message["cmpctblock"].header_and_shortids.header.sha256, block.sha256)
+
+        # A valid block is announced either way
+        block = self.build_block_on_tip(node)
+        comp_block = HeaderAndShortIDs()
+        comp_block.initialize_from_block(block, use_witness=True)
+        sender.send_and_ping(msg_cmpctblock(comp_block.to_p2p()))
+        assert_equal(int(node.getbestblockhash(), 16), block.sha256)
+        listener.wait_for_block_announcement(block.sha256)
+
     # Helper for enabling cb announcements
     # Send the sendcmpct request and sync headers
     def request_cb_announcements(self, peer):
@@ -846,9 +888,19 @@ class CompactBlocksTest(BitcoinTestFramework):
         self.test_invalid_tx_in_compactblock(self.segwit_node)
         self.test_invalid_tx_in_compactblock(self.old_node)
 
+        self.log.info("Testing relay of compact blocks before validation...")
+        self.test_fast_forward_before_validation(self.additional_segwit_node, self.segwit_node, fast_forward=True)
+
         self.log.info("Testing invalid index in cmpctblock message...")
         self.test_invalid_cmpctblock_message()
 
+        self.log.info("Testing that compact blocks are relayed after validation with -cmpctblockfastforward=0...")
+        self.restart_node(0, extra_args=self.extra_args[0] + ["-cmpctblockfastforward=0"])
+        self.segwit_node = self.nodes[0].add_p2p_connection(TestP2PConn(cmpct_version=2))
+        self.additional_segwit_node = self.nodes[0].add_p2p_connection(TestP2PConn(cmpct_version=2))
+        self.request_cb_announcements(self.segwit_node)
+        self.test_fast_forward_before_validation(self.additional_segwit_node, self.segwit_node, fast_forward=False)
+
 
 if __name__ == '__main__':
     CompactBlocksTest().main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getaddresshistory and getaddressutxos RPCs and the -addrindex option."""
+
+from decimal import Decimal
+
+from test_framework.authproxy import JSONRPCException
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal, assert_raises_rpc_error,
+    connect_nodes, disconnect_nodes, sync_blocks, wait_until
+    )
+
+
+class AddrIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-addrindex"], []]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def sync_index(self, node):
+        def index_ready():
+            try:
+                node.getaddressutxos(node.getnewaddress())
+                return True
+            except JSONRPCException:
+                return False
+        wait_until(index_ready)
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        self.sync_all()
+        self.sync_index(node)
+
+        self.log.info("Test funding and spending entries")
+        addr = node.getnewaddress()
+        txid_fund = node.sendtoaddress(addr, 1)
+        node.generate(1)
+        fund_height = node.getblockcount()
+        self.sync_all()
+        history = node.getaddresshistory(addr)
+        assert_equal(history['height'], fund_height)
+        assert_equal(len(history['history']), 1)
+        entry = history['history'][0]
+        assert_equal(entry['type'], 'funding')
+        assert_equal(entry['txid'], txid_fund)
+        assert_equal(entry['height'], fund_height)
+        assert_equal(entry['amount'], Decimal('1'))
+        utxos = node.getaddressutxos(addr)
+        assert_equal(len(utxos['unspents']), 1)
+        assert_equal(utxos['total_amount'], Decimal('1'))
+
+        # Mine a longer chain without the spend on node 1, to reorg node 0 onto later
+        disconnect_nodes(node, 1)
+        self.nodes[1].generate(3)
+
+        vout = entry['vout']
+        raw = node.createrawtransaction([{"txid": txid_fund, "vout": vout}], {self.nodes[1].getnewaddress(): Decimal('0.999')})
+        txid_spend = node.sendrawtransaction(node.signrawtransactionwithwallet(raw)['hex'])
+        spend_block = node.generate(1)[0]
+        spend_height = node.getblockcount()
+        history = node.getaddresshistory(addr)['history']
+        assert_equal(len(history), 2)
+        assert_equal(history[1]['type'], 'spending')
+        assert_equal(history[1]['txid'], txid_spend)
+        assert_equal(history[1]['vin'], 0)
+        assert_equal(history[1]['height'], spend_height)
+        assert_equal(history[1]['amount'], Decimal('1'))
+        assert_equal(history[1]['spent_txid'], txid_fund)
+        assert_equal(history[1]['spent_vout'], vout)
+        assert_equal(node.getaddressutxos(addr)['unspents'], [])
+
+        self.log.info("Test height ranges and script arguments")
+        assert_equal(len(node.getaddresshistory(addr, spend_height)['history']), 1)
+        assert_equal(len(node.getaddresshistory(addr, 0, fund_height)['history']), 1)
+        script = node.getaddressinfo(addr)['scriptPubKey']
+        assert_equal(node.getaddresshistory(script), node.getaddresshistory(addr))
+        assert_raises_rpc_error(-5, "Invalid address or script", node.getaddresshistory, "notanaddress")
+        assert_raises_rpc_error(-8, "Negative start_height", node.getaddresshistory, addr, -1)
+        assert_raises_rpc_error(-1, "Address index is not enabled", self.nodes[1].getaddresshistory, addr)
+
+        self.log.info("Test that disconnected blocks are removed")
+        node.invalidateblock(spend_block)
+        assert_equal(len(node.getaddresshistory(addr)['history']), 1)
+        assert_equal(node.getaddressutxos(addr)['total_amount'], Decimal('1'))
+        node.reconsiderblock(spend_block)
+        assert_equal(len(node.getaddresshistory(addr)['history']), 2)
+
+        self.log.info("Test that a reorg removes the entries of the stale chain")
+        connect_nodes(node, 1)
+        sync_blocks(self.nodes)
+        history = node.getaddresshistory(addr)
+        assert_equal(history['height'], fund_height + 3)
+        assert_equal(len(history['history']), 1)
+
+        self.log.info("Test that the index is rebuilt consistently")
+        self.restart_node(0, ["-addrindex", "-reindex"])
+        self.sync_index(self.nodes[0])
+        assert_equal(self.nodes[0].getaddresshistory(addr), history)
+
+
+if __name__ == '__main__':
+    AddrIndexTest().main()
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the gettxspendingprevout RPC and the -spentindex option."""
+
+from decimal import Decimal
+
+from test_framework.authproxy import JSONRPCException
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal, assert_raises_rpc_error,
+    connect_nodes, disconnect_nodes, sync_blocks, wait_until
+    )
+
+
+class GetTxSpendingPrevoutTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-spentindex"], []]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(101)
+        self.sync_all()
+
+        txid_fund = node.sendtoaddress(node.getnewaddress(), 1)
+        node.generate(1)
+        self.sync_all()
+        vout = [o['n'] for o in node.getrawtransaction(txid_fund, True, node.getbestblockhash())['vout'] if o['value'] == Decimal('1')][0]
+        prevout = {"txid": txid_fund, "vout": vout}
+
+        self.log.info("Test unspent outputs")
+        assert_equal(node.gettxspendingprevout([prevout]), [prevout])
+        assert_equal(self.nodes[1].gettxspendingprevout([prevout]), [prevout])
+
+        # Mine a longer chain without the spend on node 1, to reorg node 0 onto later
+        disconnect_nodes(node, 1)
+        self.nodes[1].generate(3)
+
+        self.log.info("Test spends in the mempool")
+        raw = node.createrawtransaction([prevout], {node.getnewaddress(): Decimal('0.999')})
+        txid_spend = node.sendrawtransaction(node.signrawtransactionwithwallet(raw)['hex'])
+        mempool_spend = dict(prevout, spendingtxid=txid_spend, spendingvin=0)
+        assert_equal(node.gettxspendingprevout([prevout]), [mempool_spend])
+
+        self.log.info("Test spends in the chain")
+        spend_block = node.generate(1)[0]
+        spend_height = node.getblockcount()
+        chain_spend = dict(mempool_spend, height=spend_height)
+        other = {"txid": txid_spend, "vout": 0}
+        assert_equal(node.gettxspendingprevout([prevout, other]), [chain_spend, other])
+
+        self.log.info("Test invalid parameters")
+        assert_raises_rpc_error(-8, "Invalid parameter, outputs are missing", node.gettxspendingprevout, [])
+        assert_raises_rpc_error(-8, "Invalid parameter, vout cannot be negative", node.gettxspendingprevout, [{"txid": txid_fund, "vout": -1}])
+        assert_raises_rpc_error(-3, "Unexpected key", node.gettxspendingprevout, [{"txid": txid_fund, "vout": 0, "n": 0}])
+
+        self.log.info("Test that disconnected blocks are removed")
+        node.invalidateblock(spend_block)
+        assert_equal(node.gettxspendingprevout([prevout]), [mempool_spend])
+        node.reconsiderblock(spend_block)
+        assert_equal(node.gettxspendingprevout([prevout]), [chain_spend])
+
+        self.log.info("Test that a reorg removes the entries of the stale chain")
+        connect_nodes(node, 1)
+        sync_blocks(self.nodes)
+        # The spend went back to the mempool
+        assert_equal(node.gettxspendingprevout([prevout]), [mempool_spend])
+
+        self.log.info("Test that the index is rebuilt consistently")
+        node.generate(1)
+        spend_height = node.getblockcount()
+        self.restart_node(0, ["-spentindex", "-reindex"])
+        expected = [dict(chain_spend, height=spend_height)]
+
+        def index_synced():
+            try:
+                return self.nodes[0].gettxspendingprevout([prevout]) == expected
+            except JSONRPCException:
+                return False
+        wait_until(index_synced)
+
+
+if __name__ == '__main__':
+    GetTxSpendingPrevoutTest().main()
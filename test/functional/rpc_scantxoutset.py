@@ -4,7 +4,7 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 """Test the scantxoutset rpc call."""
 from test_framework.test_framework import BitcoinTestFramework
-from test_framework.util import assert_equal, assert_raises_rpc_error
+from test_framework.util import assert_equal, assert_raises_rpc_error, wait_until
 
 from decimal import Decimal
 import shutil
@@ -123,5 +123,29 @@ class ScantxoutsetTest(BitcoinTestFramework):
         # Check that second arg is needed for start
         assert_raises_rpc_error(-1, "scanobjects argument is required for the start action", self.nodes[0].scantxoutset, "start")
 
+        self.log.info("Test that lookups in the script index match the scan")
+        scanobjects = [
+            {"desc": "combo(tpubD6NzVbkrYhZ4WaWSyoBvQwbpLkojyoTZPRsgXELWz3Popb3qkjcJyJUGLnL4qHHoQvao8ESaAstxYSnhyswJ76uZPStJRJCTKvosUCJZL5B/1/1/*)", "range": 1500},
+            "addr(" + addr_LEGACY + ")",
+            "addr(" + addr_BECH32 + ")",
+        ]
+        scan = self.nodes[0].scantxoutset("start", scanobjects)
+        self.restart_node(0, ['-scriptindex'])
+        wait_until(lambda: self.nodes[0].scantxoutset("start", scanobjects)['txouts'] < scan['txouts'])
+        lookup = self.nodes[0].scantxoutset("start", scanobjects)
+        assert_equal(lookup['success'], True)
+        assert_equal(lookup['bestblock'], scan['bestblock'])
+        assert_equal(lookup['unspents'], scan['unspents'])
+        assert_equal(lookup['total_amount'], scan['total_amount'])
+
+        self.log.info("Test that the script index follows new blocks and reorgs")
+        self.nodes[0].sendtoaddress("mkHV1C6JLheLoUSSZYk7x3FH5tnx9bu7yc", 0.5)
+        blockhash = self.nodes[0].generate(1)[0]
+        after_block = self.nodes[0].scantxoutset("start", ["addr(mkHV1C6JLheLoUSSZYk7x3FH5tnx9bu7yc)"])
+        assert_equal(after_block['bestblock'], blockhash)
+        assert_equal(after_block['total_amount'], Decimal("0.508"))
+        self.nodes[0].invalidateblock(blockhash)
+        wait_until(lambda: self.nodes[0].scantxoutset("start", ["addr(mkHV1C6JLheLoUSSZYk7x3FH5tnx9bu7yc)"])['total_amount'] == Decimal("0.008"))
+
 if __name__ == '__main__':
     ScantxoutsetTest().main()
@@ -79,6 +79,7 @@ BASE_SCRIPTS = [
     'wallet_backup.py',
     # vv Tests less than 5m vv
     'mining_getblocktemplate_longpoll.py',
+    'mining_getblocktemplatediff.py',
     'feature_maxuploadtarget.py',
     'feature_block.py',
     'rpc_fundrawtransaction.py',
@@ -164,6 +165,8 @@ BASE_SCRIPTS = [
     'wallet_txn_clone.py --mineblock',
     'feature_notifications.py',
     'rpc_getblockfilter.py',
+    'rpc_addrindex.py',
+    'rpc_gettxspendingprevout.py',
     'rpc_invalidateblock.py',
     'feature_rbf.py',
     'mempool_packages.py',